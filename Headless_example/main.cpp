@@ -0,0 +1,31 @@
+#include "../lfgui/lfgui_wrapper_headless.h"
+#include "../common_sample_code.h"
+
+#include <iostream>
+
+// Renders the sample GUI without a window, clicks and drags around a bit and saves the resulting frame.
+// Usage: lfgui_headless_example [output.qoi|output.ppm] [data directory]
+int main(int argc,char* argv[])
+{
+    std::string output=argc>1?argv[1]:"lfgui_headless_example.qoi";
+    lfgui::ressource_path::set(argc>2?argv[2]:LFGUI_DATA_DIR);
+
+    lfgui::wrapper_headless::gui gui(800,600);
+    lfgui::asset_loader::global().preload_default_font();
+    setup_sample_gui(&gui);
+    lfgui::asset_loader::global().wait();   // the images are loaded in the background, the saved frame should have them
+    gui.update();
+
+    gui.click(60,60);
+    gui.drag(400,300,450,320);
+    gui.mouse_move(200,200);
+    gui.update();
+
+    if(!gui.save_frame(output))
+    {
+        std::cerr<<"Could not save the frame to \""<<output<<"\"."<<std::endl;
+        return 1;
+    }
+    std::cout<<"Rendered "<<gui.frames()<<" frames, saved the last one to \""<<output<<"\"."<<std::endl;
+    return 0;
+}
@@ -14,6 +14,7 @@ INCLUDEPATH +=  ../external/
 DESTDIR = $${PWD}
 
 #DEFINES += LFGUI_SEPARATE_COLOR_CHANNELS
+#DEFINES += LFGUI_PROFILER
 
 SOURCES += main.cpp\
         ../lfgui/lfgui.cpp \
@@ -22,6 +23,18 @@ SOURCES += main.cpp\
         ../lfgui/window.cpp \
         ../lfgui/lineedit.cpp \
         ../lfgui/slider.cpp \
+        ../lfgui/pixel_conversion.cpp \
+        ../lfgui/profiler.cpp \
+        ../lfgui/resample.cpp \
+        ../lfgui/image_pyramid.cpp \
+        ../lfgui/path.cpp \
+        ../lfgui/rasterizer.cpp \
+        ../lfgui/blur.cpp \
+        ../lfgui/asset_loader.cpp \
+        ../lfgui/memory_pool.cpp \
+        ../lfgui/frame_pipeline.cpp \
+        ../lfgui/display_list.cpp \
+        ../lfgui/event_queue.cpp \
         ../common_sample_code.cpp \
 
 HEADERS  += \
@@ -36,6 +49,19 @@ HEADERS  += \
         ../lfgui/radio.h \
         ../lfgui/lfgui_wrapper_qt.h \
         ../lfgui/general.h \
+        ../lfgui/pixel_conversion.h \
+        ../lfgui/profiler.h \
+        ../lfgui/parallel.h \
+        ../lfgui/resample.h \
+        ../lfgui/image_pyramid.h \
+        ../lfgui/path.h \
+        ../lfgui/rasterizer.h \
+        ../lfgui/blur.h \
+        ../lfgui/asset_loader.h \
+        ../lfgui/memory_pool.h \
+        ../lfgui/frame_pipeline.h \
+        ../lfgui/display_list.h \
+        ../lfgui/event_queue.h \
         ../lfgui/label.h \
         ../lfgui/lineedit.h \
         ../lfgui/window.h \
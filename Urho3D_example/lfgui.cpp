@@ -4,4 +4,16 @@
 #include "../lfgui/lineedit.cpp"
 #include "../lfgui/slider.cpp"
 #include "../lfgui/window.cpp"
+#include "../lfgui/pixel_conversion.cpp"
+#include "../lfgui/profiler.cpp"
+#include "../lfgui/resample.cpp"
+#include "../lfgui/image_pyramid.cpp"
+#include "../lfgui/path.cpp"
+#include "../lfgui/rasterizer.cpp"
+#include "../lfgui/blur.cpp"
+#include "../lfgui/asset_loader.cpp"
+#include "../lfgui/memory_pool.cpp"
+#include "../lfgui/frame_pipeline.cpp"
+#include "../lfgui/display_list.cpp"
+#include "../lfgui/event_queue.cpp"
 #include "../common_sample_code.cpp"
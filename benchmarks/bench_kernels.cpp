@@ -0,0 +1,304 @@
+// Micro-benchmark of the image drawing and manipulation functions (the "kernels" every widget is drawn with).
+// The pixel layout and the SIMD level are chosen at compile time, so the build creates one executable per variant
+// (see CMakeLists.txt). Results are written as JSON.
+//
+// Configure with -DLFGUI_PREMULTIPLIED_ALPHA=ON to measure the premultiplied blending paths.
+//
+// Usage: lfgui_bench_kernels_<variant> [--output file.json] [--filter name] [--min-time seconds] [--data dir]
+
+#include "../lfgui/blur.h"
+#include "../lfgui/image.h"
+#include "../lfgui/image_pyramid.h"
+#include "../lfgui/path.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cmath>
+
+namespace
+{
+
+const char* layout_name()
+{
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    return "planar";
+#else
+    return "packed";
+#endif
+}
+
+const char* alpha_name()
+{
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+    return "premultiplied";
+#else
+    return "straight";
+#endif
+}
+
+const char* simd_name()
+{
+#if defined(LFGUI_AVX2)
+    return "avx2";
+#elif defined(LFGUI_SSE4_1)
+    return "sse4.1";
+#elif defined(LFGUI_SSSE3)
+    return "ssse3";
+#elif defined(LFGUI_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/// \brief Returns false if this executable uses instructions the CPU doesn't have.
+bool cpu_supported()
+{
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#if defined(LFGUI_AVX2)
+    return __builtin_cpu_supports("avx2");
+#elif defined(LFGUI_SSE4_1)
+    return __builtin_cpu_supports("sse4.1");
+#elif defined(LFGUI_SSSE3)
+    return __builtin_cpu_supports("ssse3");
+#endif
+#endif
+    return true;
+}
+
+struct result
+{
+    std::string name;
+    int size;
+    double pixels;      // pixels touched per operation
+    long iterations;
+    double ns_per_op;
+    double mpix_per_s;
+};
+
+/// \brief Runs op in growing batches until at least min_time seconds have been measured.
+result measure(const std::string& name,int size,double pixels,double min_time,const std::function<void()>& op)
+{
+    using clock=std::chrono::steady_clock;
+    op();   // warm up caches and lazily initialized data like glyphs
+    long iterations=0;
+    long batch=1;
+    double elapsed=0;
+    while(elapsed<min_time)
+    {
+        auto start=clock::now();
+        for(long i=0;i<batch;i++)
+            op();
+        elapsed+=std::chrono::duration<double>(clock::now()-start).count();
+        iterations+=batch;
+        if(batch<(1<<20))
+            batch*=2;
+    }
+    result r;
+    r.name=name;
+    r.size=size;
+    r.pixels=pixels;
+    r.iterations=iterations;
+    r.ns_per_op=elapsed*1e9/iterations;
+    r.mpix_per_s=pixels*iterations/elapsed/1e6;
+    return r;
+}
+
+/// \brief Creates a test image with a diagonal alpha gradient that contains fully transparent, fully opaque and
+/// translucent areas, like typical widget images.
+lfgui::image make_source(int size)
+{
+    lfgui::image img(size,size);
+    for(int y=0;y<size;y++)
+        for(int x=0;x<size;x++)
+        {
+            int a=(x+y)*400/(size*2)-70;
+            a=a<0?0:a>255?255:a;
+            img.set_pixel(x,y,lfgui::color(x*255/size,y*255/size,128,a));
+        }
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+    img.premultiply();  // set_pixel() stores the raw values
+#endif
+    return img;
+}
+
+std::vector<lfgui::point> make_star(int cx,int cy,int radius)
+{
+    std::vector<lfgui::point> ret;
+    for(int i=0;i<10;i++)
+    {
+        float r=i%2?radius*0.4f:radius;
+        float angle=i*3.14159265f/5;
+        ret.push_back(lfgui::point(cx+std::sin(angle)*r,cy-std::cos(angle)*r));
+    }
+    return ret;
+}
+
+std::string json_escape(const std::string& str)
+{
+    std::string ret;
+    for(char c:str)
+        if(c=='"'||c=='\\')
+            ret+=std::string("\\")+c;
+        else
+            ret+=c;
+    return ret;
+}
+
+}   // namespace
+
+int main(int argc,char* argv[])
+{
+    std::string output;
+    std::string filter;
+    double min_time=0.2;
+#ifdef LFGUI_DATA_DIR
+    std::string data_dir=LFGUI_DATA_DIR;
+#else
+    std::string data_dir="lfgui_data/";
+#endif
+    for(int i=1;i+1<argc;i+=2)
+    {
+        std::string arg=argv[i];
+        if(arg=="--output")
+            output=argv[i+1];
+        else if(arg=="--filter")
+            filter=argv[i+1];
+        else if(arg=="--min-time")
+            min_time=std::stod(argv[i+1]);
+        else if(arg=="--data")
+            data_dir=argv[i+1];
+        else
+        {
+            std::cerr<<"unknown argument "<<arg<<std::endl;
+            return 1;
+        }
+    }
+    lfgui::ressource_path::set(data_dir);
+
+    std::vector<result> results;
+    bool supported=cpu_supported();
+    if(supported)
+    {
+        const int target_size=1024;
+        lfgui::image target(target_size,target_size);
+        auto run=[&](const std::string& name,int size,double pixels,const std::function<void()>& op)
+        {
+            if(!filter.empty()&&name.find(filter)==std::string::npos)
+                return;
+            target.clear(64);
+            results.push_back(measure(name,size,pixels,min_time,op));
+            const result& r=results.back();
+            std::cerr<<layout_name()<<'/'<<simd_name()<<' '<<r.name<<' '<<r.size<<": "<<r.ns_per_op<<" ns/op, "
+                     <<r.mpix_per_s<<" Mpix/s"<<std::endl;
+        };
+
+        for(int s:{32,128,512})
+        {
+            double px=double(s)*s;
+            lfgui::image source=make_source(s);
+            lfgui::image work=source.copy();
+            // offset the destination so that rows are not aligned to 16 byte
+            const int x=13;
+            const int y=7;
+
+            run("draw_rect_opaque",s,px,[&]{target.draw_rect(x,y,s,s,lfgui::color(200,100,50,255));});
+            run("draw_rect_translucent",s,px,[&]{target.draw_rect(x,y,s,s,lfgui::color(200,100,50,128));});
+            run("draw_image",s,px,[&]{target.draw_image(x,y,source);});
+            // mostly opaque with transparent corners like a widget skin, see image::opacity_spans()
+            lfgui::image skin(s,s);
+            skin.clear(0);
+            skin.draw_rounded_rect(0.5f,0.5f,s-1,s-1,s/8.f,lfgui::color(200,100,50,255));
+            run("draw_image_skin",s,px,[&]{target.draw_image(x,y,skin);});
+            run("draw_image_multiplied",s,px,[&]{target.draw_image_multiplied(x,y,source);});
+            run("draw_image_solid",s,px,[&]{target.draw_image_solid(x,y,source);});
+            run("fill",s,px,[&]{work.fill(lfgui::color(10,20,30,40));});
+            run("multiply",s,px,[&]{work.multiply(lfgui::color(250,251,252,255));});
+            run("add",s,px,[&]{work.add(lfgui::color(1,1,1,0));});
+            run("resize_nearest",s,px*9/4,[&]{source.resized_nearest(s*3/2,s*3/2);});
+            run("resize_linear",s,px*9/4,[&]{source.resized_linear(s*3/2,s*3/2);});
+            run("resize_linear_down",s,px/4,[&]{source.resized_linear(s/2,s/2);});
+            run("resize_cubic",s,px*9/4,[&]{source.resized_cubic(s*3/2,s*3/2);});
+            run("resize_lanczos",s,px*9/4,[&]{source.resized_lanczos(s*3/2,s*3/2);});
+            run("pyramid_build",s,px,[&]{lfgui::image_pyramid p(source);});
+            // the size alternates so that the pyramid can't return its cached result
+            lfgui::image_pyramid pyramid(source);
+            int toggle=0;
+            run("downscale_8x_linear",s,px/64,[&]{toggle^=1;source.resized_linear(s/8+1+toggle,s/8+1+toggle);});
+            run("downscale_8x_pyramid",s,px/64,[&]{toggle^=1;pyramid.scaled(s/8+1+toggle,s/8+1+toggle);});
+            run("rotated90",s,px,[&]{source.rotated90();});
+            const lfgui::affine_matrix rotation=lfgui::affine_matrix::rotation(0.3f,x+s/2.0f,y+s/2.0f)*
+                                                lfgui::affine_matrix::translation(x,y);
+            run("draw_transformed_nearest",s,px,[&]{target.draw_image_transformed(source,rotation,lfgui::sampling::nearest);});
+            run("draw_transformed_bilinear",s,px,[&]{target.draw_image_transformed(source,rotation);});
+            run("draw_line_thin",s,s,[&]{target.draw_line(x,y,x+s,y+s*2/3,lfgui::color(255,255,255,200));});
+            run("draw_line_thick",s,s*5.0,[&]{target.draw_line(x,y,x+s,y+s*2/3,lfgui::color(255,255,255,200),5);});
+            run("draw_line_antialiased",s,s,[&]{target.draw_line_antialiased(lfgui::point_float(x,y),
+                                                 lfgui::point_float(x+s,y+s*2/3.f),lfgui::color(255,255,255,200));});
+            std::vector<lfgui::point_float> zigzag;
+            for(int i=0;i<=8;i++)
+                zigzag.push_back(lfgui::point_float(x+s*i/8.f,y+(i%2)*s/4.f));
+            lfgui::path rounded;
+            rounded.add_rounded_rect(x+0.5f,y+0.5f,s,s/2.f,s/8.f);
+            run("fill_path_rounded_rect",s,px/2,[&]{target.fill_path(rounded,lfgui::color(80,120,200,255));});
+            run("stroke_path_rounded_rect",s,s*3*2.0,[&]{target.stroke_path(rounded,lfgui::color(0,0,0,255),2);});
+            run("draw_rounded_rect",s,px/2,[&]{target.draw_rounded_rect(x+0.5f,y+0.5f,s,s/2.f,s/8.f,
+                                                   lfgui::color(80,120,200,255));});
+            const lfgui::gradient vertical=lfgui::gradient::linear(lfgui::point_float(x,y),lfgui::color(255,0,0),
+                                                                  lfgui::point_float(x,y+s/2.f),lfgui::color(0,0,255));
+            run("draw_rounded_rect_gradient",s,px/2,[&]{target.draw_rounded_rect(x+0.5f,y+0.5f,s,s/2.f,s/8.f,vertical);});
+            run("draw_box_shadow",s,px/2,[&]{target.draw_box_shadow(x+0.5f,y+0.5f,s,s/2.f,s/8.f,16,
+                                                 lfgui::color(0,0,0,100));});
+            run("draw_path_stroke",s,s*1.25*5,[&]{target.draw_path(zigzag,lfgui::color(255,255,255,200),
+                                                  lfgui::stroke_style(5,lfgui::line_join::miter));});
+            const lfgui::rect blur_area(x,y,s,s);
+            run("box_blur",s,px,[&]{lfgui::box_blur(target,blur_area,4);});
+            run("gaussian_blur",s,px,[&]{lfgui::gaussian_blur(target,blur_area,8);});
+            std::vector<lfgui::point> star=make_star(x+s/2,y+s/2,s/2);
+            run("draw_polygon",s,px*0.35,[&]{target.draw_polygon(star,lfgui::color(255,255,0,180));});
+            run("draw_polygon_aa",s,px*0.35,[&]{target.draw_polygon(star,lfgui::color(255,255,0,180),true);});
+            // a small polygon on the large target, should cost about its own area
+            std::vector<lfgui::point> small_star=make_star(x+8,y+8,8);
+            run("draw_polygon_small",s,16*16*0.35,[&]{target.draw_polygon(small_star,lfgui::color(255,255,0,180));});
+        }
+
+        for(int font_size:{12,24,48})
+        {
+            const std::string text="The quick brown fox jumps over the lazy dog 0123456789";
+            double px=double(target.text_length(text,font_size))*font_size;
+            run("draw_text",font_size,px,[&]{target.draw_text(10,10,text,lfgui::color(0,0,0,255),font_size);});
+        }
+    }
+
+    std::ostringstream json;
+    json<<"{\n";
+    json<<"  \"benchmark\": \"lfgui_bench_kernels\",\n";
+    json<<"  \"layout\": \""<<layout_name()<<"\",\n";
+    json<<"  \"simd\": \""<<simd_name()<<"\",\n";
+    json<<"  \"alpha\": \""<<alpha_name()<<"\",\n";
+#ifdef __VERSION__
+    json<<"  \"compiler\": \""<<json_escape(__VERSION__)<<"\",\n";
+#endif
+    json<<"  \"supported\": "<<(supported?"true":"false")<<",\n";
+    json<<"  \"results\": [";
+    for(size_t i=0;i<results.size();i++)
+    {
+        const result& r=results[i];
+        json<<(i?",":"")<<"\n    {\"name\": \""<<r.name<<"\", \"size\": "<<r.size<<", \"pixels\": "<<r.pixels
+            <<", \"iterations\": "<<r.iterations<<", \"ns_per_op\": "<<r.ns_per_op<<", \"mpix_per_s\": "<<r.mpix_per_s<<"}";
+    }
+    json<<"\n  ]\n}\n";
+
+    if(output.empty())
+        std::cout<<json.str();
+    else
+        std::ofstream(output)<<json.str();
+    if(!supported)
+        std::cerr<<layout_name()<<'/'<<simd_name()<<": not supported by this CPU, skipped"<<std::endl;
+    return 0;
+}
@@ -0,0 +1,419 @@
+// Macro-benchmark of whole scenes: builds synthetic widget trees (or the sample GUI) in a headless gui and measures
+// full redraws, idle updates, mouse-move sweeps, clicks, drags and resizes. Reports frame-time percentiles, the
+// event-dispatch latency, the memory used per widget and the image buffers allocated. Results are written as JSON.
+//
+// Scenes:
+//   sample  the scene from common_sample_code.cpp
+//   wide    --windows windows side by side, each with --leaves leaves (button, label, slider, lineedit)
+//   deep    --depth windows nested into each other, --leaves leaves in the innermost one
+//   flat    --windows * --leaves leaves directly in the gui
+//
+// Usage: lfgui_bench_scene [--output file.json] [--scene name] [--frames n] [--windows n] [--leaves n] [--depth n]
+//                          [--data dir] [--trace trace.json]
+//
+// --trace writes the zones recorded with LFGUI_PROFILE_ZONE as Chrome trace JSON, it needs a library built with the
+// CMake option LFGUI_PROFILER.
+
+#include "../lfgui/lfgui_wrapper_headless.h"
+#include "../lfgui/button.h"
+#include "../lfgui/label.h"
+#include "../lfgui/slider.h"
+#include "../lfgui/lineedit.h"
+#include "../lfgui/window.h"
+#include "../lfgui/profiler.h"
+#include "../lfgui/memory_pool.h"
+#include "../common_sample_code.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace
+{
+
+const char* layout_name()
+{
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    return "planar";
+#else
+    return "packed";
+#endif
+}
+
+/// \brief Returns the number of bytes currently allocated from the heap or -1 if that's unknown on this platform.
+/// Image buffers cached by the memory pool don't count.
+long long heap_in_use()
+{
+#if defined(__GLIBC__)&&(__GLIBC__>2||(__GLIBC__==2&&__GLIBC_MINOR__>=33))
+    return (long long)mallinfo2().uordblks-(long long)lfgui::memory_pool::global().stats().bytes_cached;
+#else
+    return -1;
+#endif
+}
+
+const char* usage="Usage: lfgui_bench_scene [--output file.json] [--scene name] [--frames n] [--windows n] "
+                  "[--leaves n] [--depth n]\n                         [--data dir] [--trace trace.json]";
+
+/// \brief Swallows everything written to it. Used to silence the sample GUI which prints on every resize.
+struct null_buffer : std::streambuf
+{
+    int overflow(int c) override{return c;}
+};
+
+struct scene
+{
+    std::string name;
+    std::unique_ptr<lfgui::wrapper_headless::gui> gui;
+    std::vector<lfgui::widget*> leaves;     ///< \brief Widgets to click on.
+    std::vector<lfgui::window*> windows;    ///< \brief Top level windows to drag around.
+    size_t widgets=0;
+    long long bytes=-1;                     ///< \brief Heap memory used by building the scene, -1 if unknown.
+};
+
+/// \brief Adds the leaf number i to parent, cycling through button, label, slider and lineedit.
+lfgui::widget* add_leaf(lfgui::widget* parent,int i,int x,int y)
+{
+    const std::string text="leaf "+std::to_string(i);
+    switch(i%4)
+    {
+    case 0:
+        return parent->add_child(new lfgui::button(x,y,100,25,text));
+    case 1:
+        return parent->add_child(new lfgui::label(x,y,100,25,text,{0,0,0},14));
+    case 2:
+        return parent->add_child(new lfgui::slider(x,y,100,20,0,100,i));
+    default:
+        return parent->add_child(new lfgui::lineedit(x,y,100,25,text));
+    }
+}
+
+/// \brief Adds count leaves in two columns to parent.
+void add_leaves(scene& s,lfgui::widget* parent,int count)
+{
+    for(int i=0;i<count;i++)
+        s.leaves.push_back(add_leaf(parent,i,5+(i%2)*105,5+(i/2)*30));
+}
+
+scene build_scene(const std::string& name,int width,int height,int windows,int leaves,int depth)
+{
+    scene s;
+    s.name=name;
+    s.gui.reset(new lfgui::wrapper_headless::gui(width,height));
+    long long heap_before=heap_in_use();     // without the frame buffer of the gui
+    lfgui::wrapper_headless::gui* gui=s.gui.get();
+
+    if(name=="sample")
+        setup_sample_gui(gui);
+    else if(name=="wide")
+    {
+        const int window_width=230;
+        const int window_height=std::max(100,((leaves+1)/2)*30+47);
+        const int columns=std::max(1,width/(window_width/2));
+        for(int i=0;i<windows;i++)
+        {
+            // overlap the windows by half so that the occluded parts are drawn too
+            int x=(i%columns)*window_width/2;
+            int y=((i/columns)*window_height/2)%std::max(1,height-window_height);
+            auto w=gui->add_child(new lfgui::window(x,y,window_width,window_height,"window "+std::to_string(i)));
+            s.windows.push_back(w);
+            add_leaves(s,w->widget_content,leaves);
+        }
+    }
+    else if(name=="deep")
+    {
+        lfgui::window* inner=nullptr;
+        int w=width-20;
+        int h=height-20;
+        for(int i=0;i<depth;i++)
+        {
+            // each window fills the content area of its parent, windows can't get smaller than 100x100
+            if(inner)
+                inner=inner->add_child_to_content_widget(new lfgui::window(2,2,w,h,"depth "+std::to_string(i)));
+            else
+                s.windows.push_back(inner=gui->add_child(new lfgui::window(10,10,w,h,"depth 0")));
+            w=std::max(100,w-17);
+            h=std::max(100,h-41);
+        }
+        add_leaves(s,inner->widget_content,leaves);
+    }
+    else if(name=="flat")
+    {
+        const int columns=std::max(1,(width-10)/105);
+        for(int i=0;i<windows*leaves;i++)
+            s.leaves.push_back(add_leaf(gui,i,5+(i%columns)*105,5+((i/columns)*30)%std::max(1,height-30)));
+    }
+    else
+        throw lfgui::exception("unknown scene \""+name+"\"");
+
+    lfgui::asset_loader::global().wait();
+    gui->render();  // the first frame swaps in the loaded images and creates lazily prepared resources like glyphs
+    long long heap_after=heap_in_use();
+    if(heap_before>=0&&heap_after>=0)
+        s.bytes=heap_after-heap_before;
+    s.widgets=gui->descendant_count();
+    return s;
+}
+
+/// \brief Collected timings of one workload in nanoseconds.
+struct samples
+{
+    std::vector<double> frame;      ///< \brief Time to render a frame (update() or render()).
+    std::vector<double> dispatch;   ///< \brief Time to handle one injected event.
+};
+
+struct result
+{
+    std::string scene;
+    std::string workload;
+    size_t widgets;
+    long long bytes;
+    samples s;
+    uint64_t allocations;           ///< \brief image buffers allocated during the workload, see lfgui::memory_pool
+    uint64_t system_allocations;    ///< \brief the part of them that wasn't served from the pool
+};
+
+using clock_type=std::chrono::steady_clock;
+
+double elapsed_ns(clock_type::time_point start)
+{
+    return std::chrono::duration<double,std::nano>(clock_type::now()-start).count();
+}
+
+/// \brief Runs event, then renders a frame if needed and records both durations.
+void step(samples& s,lfgui::wrapper_headless::gui& gui,const std::function<void()>& event)
+{
+    if(event)
+    {
+        auto start=clock_type::now();
+        event();
+        s.dispatch.push_back(elapsed_ns(start));
+    }
+    auto start=clock_type::now();
+    if(gui.update())
+        s.frame.push_back(elapsed_ns(start));
+}
+
+samples run_workload(scene& sc,const std::string& workload,int frames)
+{
+    samples s;
+    lfgui::wrapper_headless::gui& gui=*sc.gui;
+    const int w=gui.width();
+    const int h=gui.height();
+
+    if(workload=="redraw")
+        for(int i=0;i<frames;i++)
+        {
+            auto start=clock_type::now();
+            gui.render();
+            s.frame.push_back(elapsed_ns(start));
+        }
+    else if(workload=="idle")
+        for(int i=0;i<frames;i++)
+            step(s,gui,[&]{gui.need_redraw();});
+    else if(workload=="mouse_move")
+    {
+        // sweep over the whole gui in rows, like a mouse crossing all the widgets
+        const int columns=std::max(1,frames/8);
+        for(int i=0;i<frames;i++)
+        {
+            int x=(i%columns)*(w-1)/std::max(1,columns-1);
+            int y=((i/columns)*97+13)%h;
+            step(s,gui,[&]{gui.mouse_move(x,y);});
+        }
+    }
+    else if(workload=="click")
+        for(int i=0;i<frames;i++)
+        {
+            lfgui::point p;
+            if(sc.leaves.empty())   // scenes not built here: click on a grid
+                p=lfgui::point((i*131+50)%w,(i/(w/131+1)*67+40)%h);
+            else
+            {
+                lfgui::widget* leaf=sc.leaves[i%sc.leaves.size()];
+                p=leaf->to_global(lfgui::point(leaf->width()/2,leaf->height()/2));
+            }
+            step(s,gui,[&]{gui.click(p.x,p.y);});
+        }
+    else if(workload=="drag")
+    {
+        // drag the first window by its title bar or whatever is in the center of the gui
+        lfgui::point p(w/2,h/2);
+        if(!sc.windows.empty())
+            p=sc.windows.front()->to_global(lfgui::point(sc.windows.front()->width()/2,12));
+        gui.mouse_press(p.x,p.y);
+        for(int i=0;i<frames;i++)
+        {
+            // move back and forth so that the window stays inside the gui
+            int dx=(i/16)%2?-4:4;
+            p.x+=dx;
+            p.y+=(i/32)%2?-2:2;
+            step(s,gui,[&]{gui.mouse_move(p.x,p.y);});
+        }
+        gui.mouse_release(p.x,p.y);
+        gui.update();
+    }
+    else if(workload=="resize")
+    {
+        for(int i=0;i<frames;i++)
+        {
+            int rw=i%2?w:w*3/4;
+            int rh=i%2?h:h*3/4;
+            step(s,gui,[&]{gui.resize(rw,rh);});
+        }
+        gui.resize(w,h);
+        gui.update();
+    }
+    return s;
+}
+
+/// \brief Returns the p-th percentile (0..100) with the nearest-rank method. v has to be sorted.
+double percentile(const std::vector<double>& v,double p)
+{
+    if(v.empty())
+        return 0;
+    size_t rank=size_t(p/100*v.size()+0.999999);
+    return v[std::min(v.size(),std::max<size_t>(rank,1))-1];
+}
+
+std::string json_stats(std::vector<double> v)
+{
+    std::sort(v.begin(),v.end());
+    double sum=0;
+    for(double d:v)
+        sum+=d;
+    std::ostringstream ss;
+    ss<<"{\"count\": "<<v.size()<<", \"mean_ns\": "<<(v.empty()?0:sum/v.size())<<", \"p50_ns\": "<<percentile(v,50)
+      <<", \"p90_ns\": "<<percentile(v,90)<<", \"p99_ns\": "<<percentile(v,99)<<", \"max_ns\": "<<(v.empty()?0:v.back())<<"}";
+    return ss.str();
+}
+
+std::string json_escape(const std::string& str)
+{
+    std::string ret;
+    for(char c:str)
+        if(c=='"'||c=='\\')
+            ret+=std::string("\\")+c;
+        else
+            ret+=c;
+    return ret;
+}
+
+}   // namespace
+
+int main(int argc,char* argv[])
+{
+    std::string output;
+    std::string filter;
+    std::string trace;
+    int frames=200;
+    int windows=16;
+    int leaves=8;
+    int depth=12;
+#ifdef LFGUI_DATA_DIR
+    std::string data_dir=LFGUI_DATA_DIR;
+#else
+    std::string data_dir="lfgui_data/";
+#endif
+    for(int i=1;i<argc;i+=2)
+    {
+        std::string arg=argv[i];
+        if(i+1==argc)
+        {
+            std::cerr<<"missing value for "<<arg<<"\n"<<usage<<std::endl;
+            return 1;
+        }
+        if(arg=="--output")
+            output=argv[i+1];
+        else if(arg=="--scene")
+            filter=argv[i+1];
+        else if(arg=="--frames")
+            frames=std::max(1,std::stoi(argv[i+1]));
+        else if(arg=="--windows")
+            windows=std::max(1,std::stoi(argv[i+1]));
+        else if(arg=="--leaves")
+            leaves=std::max(0,std::stoi(argv[i+1]));
+        else if(arg=="--depth")
+            depth=std::max(1,std::stoi(argv[i+1]));
+        else if(arg=="--data")
+            data_dir=argv[i+1];
+        else if(arg=="--trace")
+            trace=argv[i+1];
+        else
+        {
+            std::cerr<<"unknown argument "<<arg<<"\n"<<usage<<std::endl;
+            return 1;
+        }
+    }
+    lfgui::ressource_path::set(data_dir);
+
+    null_buffer null;
+    std::streambuf* cout_buffer=std::cout.rdbuf(&null);
+
+    std::vector<result> results;
+    for(const std::string name:{"sample","wide","deep","flat"})
+    {
+        if(!filter.empty()&&name.find(filter)==std::string::npos)
+            continue;
+        build_scene(name,1280,720,windows,leaves,depth);  // loads the static images, so they aren't counted below
+        for(const std::string workload:{"redraw","idle","mouse_move","click","drag","resize"})
+        {
+            // every workload gets a fresh scene so that they don't influence each other
+            scene sc=build_scene(name,1280,720,windows,leaves,depth);
+            result r;
+            r.scene=name;
+            r.workload=workload;
+            r.widgets=sc.widgets;
+            r.bytes=sc.bytes;
+            const lfgui::memory_pool::statistics before=lfgui::memory_pool::global().stats();
+            r.s=run_workload(sc,workload,frames);
+            const lfgui::memory_pool::statistics after=lfgui::memory_pool::global().stats();
+            r.allocations=after.allocations-before.allocations;
+            r.system_allocations=after.system_allocations-before.system_allocations;
+            results.push_back(r);
+
+            std::vector<double> f=r.s.frame;
+            std::sort(f.begin(),f.end());
+            std::cerr<<layout_name()<<' '<<name<<' '<<workload<<": "<<r.widgets<<" widgets, "<<f.size()<<" frames, p50 "
+                     <<percentile(f,50)/1000<<" us, p99 "<<percentile(f,99)/1000<<" us, "<<r.allocations
+                     <<" allocations ("<<r.system_allocations<<" from the system)"<<std::endl;
+        }
+    }
+
+    std::cout.rdbuf(cout_buffer);
+
+    std::ostringstream json;
+    json<<"{\n";
+    json<<"  \"benchmark\": \"lfgui_bench_scene\",\n";
+    json<<"  \"layout\": \""<<layout_name()<<"\",\n";
+#ifdef __VERSION__
+    json<<"  \"compiler\": \""<<json_escape(__VERSION__)<<"\",\n";
+#endif
+    json<<"  \"frames\": "<<frames<<", \"windows\": "<<windows<<", \"leaves\": "<<leaves<<", \"depth\": "<<depth<<",\n";
+    json<<"  \"results\": [";
+    for(size_t i=0;i<results.size();i++)
+    {
+        const result& r=results[i];
+        json<<(i?",":"")<<"\n    {\"scene\": \""<<r.scene<<"\", \"workload\": \""<<r.workload<<"\", \"widgets\": "<<r.widgets
+            <<", \"bytes\": "<<r.bytes<<", \"bytes_per_widget\": "<<(r.bytes>=0&&r.widgets?double(r.bytes)/r.widgets:-1)
+            <<", \"allocations\": "<<r.allocations<<", \"system_allocations\": "<<r.system_allocations
+            <<",\n     \"frame\": "<<json_stats(r.s.frame)<<",\n     \"dispatch\": "<<json_stats(r.s.dispatch)<<"}";
+    }
+    json<<"\n  ]\n}\n";
+
+    if(!trace.empty()&&!lfgui::profiler::write_chrome_trace(trace))
+        std::cerr<<"Could not write the trace to \""<<trace<<"\"."<<std::endl;
+
+    if(output.empty())
+        std::cout<<json.str();
+    else
+        std::ofstream(output)<<json.str();
+    return 0;
+}
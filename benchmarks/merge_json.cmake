@@ -0,0 +1,16 @@
+# Merges all JSON files in INPUT_DIR into one JSON array written to OUTPUT.
+# Usage: cmake -DINPUT_DIR=<dir> -DOUTPUT=<file> -P merge_json.cmake
+file (GLOB inputs "${INPUT_DIR}/*.json")
+list (SORT inputs)
+set (content "[\n")
+set (first TRUE)
+foreach (input ${inputs})
+    file (READ ${input} json)
+    string (STRIP "${json}" json)
+    if (NOT first)
+        set (content "${content},\n")
+    endif ()
+    set (content "${content}${json}")
+    set (first FALSE)
+endforeach ()
+file (WRITE ${OUTPUT} "${content}\n]\n")
@@ -142,24 +142,15 @@ void setup_sample_gui(lfgui::widget* gui)
 
         lfgui::slider* slider_r=movable->add_child(new lfgui::slider(10,60,100,25,0,255,color_background.r));
         slider_r->on_value_change([&](float v){color_background.r=v;});
-        slider_r->img_handle_normal.multiply(lfgui::color({255,128,128}));
-        slider_r->img_handle_hover.multiply(lfgui::color({255,128,128}));
-        slider_r->img_handle_pressed.multiply(lfgui::color({255,128,128}));
-        slider_r->img_background.multiply(lfgui::color({255,128,128}));
+        slider_r->multiply_images(lfgui::color({255,128,128}));
 
         lfgui::slider* slider_g=movable->add_child(new lfgui::slider(10,90,100,25,0,255,color_background.g));
         slider_g->on_value_change([&](float v){color_background.g=v;});
-        slider_g->img_handle_normal.multiply({128,255,128});
-        slider_g->img_handle_hover.multiply({128,255,128});
-        slider_g->img_handle_pressed.multiply({128,255,128});
-        slider_g->img_background.multiply({128,255,128});
+        slider_g->multiply_images(lfgui::color({128,255,128}));
 
         lfgui::slider* slider_b=movable->add_child(new lfgui::slider(10,120,100,25,0,255,color_background.b));
         slider_b->on_value_change([&](float v){color_background.b=v;});
-        slider_b->img_handle_normal.multiply({128,128,255});
-        slider_b->img_handle_hover.multiply({128,128,255});
-        slider_b->img_handle_pressed.multiply({128,128,255});
-        slider_b->img_background.multiply({128,128,255});
+        slider_b->multiply_images(lfgui::color({128,128,255}));
 
         lfgui::slider* slider_a=movable->add_child(new lfgui::slider(10,150,100,25,0,255,color_background.a));
         slider_a->on_value_change([&](float v){color_background.a=v;});
@@ -218,7 +209,7 @@ void setup_sample_gui(lfgui::widget* gui)
             // this should be time based instead of "counting redraws" but that's enough for a simple example
             degree+=slider_speed->value();
         });
-        paint_area->redraw_every_n_seconds=1/25.0f; // try drawing with 25 FPS
+        paint_area->set_redraw_every_n_seconds(1/25.0f); // try drawing with 25 FPS
     }
 
     {
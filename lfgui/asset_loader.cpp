@@ -0,0 +1,170 @@
+#include "asset_loader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+namespace lfgui
+{
+
+asset_loader::asset_loader(int threads)
+    : _thread_count(threads>0?threads:std::max(1,int(std::thread::hardware_concurrency())-1)),
+      _decoder([](const std::string& path){return image::load(path);})
+{
+}
+
+asset_loader::~asset_loader()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop=true;
+        _pending-=_jobs.size();
+        _jobs.clear();
+    }
+    _job_added.notify_all();
+    for(auto& t:_threads)
+        t.join();
+}
+
+void asset_loader::set_decoder(image_decoder decoder,bool thread_safe)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _decoder=std::move(decoder);
+    _decoder_thread_safe=thread_safe;
+}
+
+template<typename T>
+asset<T> asset_loader::_load(std::map<std::string,asset<T>>& cache,const std::string& path,
+                             std::function<std::shared_ptr<T>()> load,bool async)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it=cache.find(path);
+    if(it!=cache.end())
+        return it->second;
+
+    auto task=std::make_shared<std::packaged_task<std::shared_ptr<T>()>>(std::move(load));
+    asset<T> ret(task->get_future().share());
+    cache.emplace(path,ret);
+    if(!async)
+    {
+        lock.unlock();
+        (*task)();
+        return ret;
+    }
+
+    _jobs.push_back([task]{(*task)();});
+    _pending++;
+    while(int(_threads.size())<_thread_count)
+        _threads.emplace_back([this]{_work();});
+    lock.unlock();
+    _job_added.notify_one();
+    return ret;
+}
+
+void asset_loader::_work()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for(;;)
+    {
+        _job_added.wait(lock,[this]{return _stop||!_jobs.empty();});
+        if(_stop)
+            return;
+        std::function<void()> job=std::move(_jobs.front());
+        _jobs.pop_front();
+        lock.unlock();
+        job();      // a packaged_task, exceptions end up in the asset
+        lock.lock();
+        _pending--;
+        _job_finished.notify_all();
+    }
+}
+
+asset<const image> asset_loader::load_image(const std::string& path)
+{
+    image_decoder decoder;
+    bool thread_safe;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        decoder=_decoder;
+        thread_safe=_decoder_thread_safe;
+    }
+    return _load<const image>(_images,path,[decoder,path]
+    {
+        std::shared_ptr<image> img=std::make_shared<image>(decoder(path));
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        img->premultiply();
+#endif
+        return std::shared_ptr<const image>(std::move(img));
+    },thread_safe);
+}
+
+asset<font> asset_loader::load_font(const std::string& path)
+{
+    return _load<font>(_fonts,path,[path]{return std::make_shared<font>(path);},true);
+}
+
+void asset_loader::preload_default_font()
+{
+    when_ready(load_font(ressource_path::get()+"FreeSans.ttf"),[](font& f)
+    {
+        if(!font::_default_font())
+            font::set_default_font(f);
+    });
+}
+
+size_t asset_loader::poll()
+{
+    std::vector<callback> ready;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_callbacks.empty())
+            return 0;
+        auto split=std::stable_partition(_callbacks.begin(),_callbacks.end(),[](const callback& c){return !c.ready();});
+        ready.assign(std::make_move_iterator(split),std::make_move_iterator(_callbacks.end()));
+        _callbacks.erase(split,_callbacks.end());
+    }
+    for(callback& c:ready)
+    {
+        // a failed load throws from the asset, that must neither abort the frame nor drop the other callbacks
+        try
+        {
+            c.call();
+        }
+        catch(const std::exception& e)
+        {
+            std::cerr<<"LFGUI Error: An asset could not be loaded: "<<e.what()<<std::endl;
+        }
+        catch(...)
+        {
+            std::cerr<<"LFGUI Error: An asset could not be loaded."<<std::endl;
+        }
+    }
+    return ready.size();
+}
+
+size_t asset_loader::pending()const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _pending;
+}
+
+void asset_loader::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _job_finished.wait(lock,[this]{return _pending==0;});
+}
+
+void asset_loader::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _images.clear();
+    _fonts.clear();
+}
+
+asset_loader& asset_loader::global()
+{
+    static asset_loader loader;
+    return loader;
+}
+
+}   // namespace lfgui
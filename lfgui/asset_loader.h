@@ -0,0 +1,136 @@
+#ifndef LFGUI_ASSET_LOADER_H
+#define LFGUI_ASSET_LOADER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief A placeholder for an image or font that is loaded by an asset_loader, possibly still in the background.
+/// Copies refer to the same asset.
+template<typename T>
+class asset
+{
+    std::shared_future<std::shared_ptr<T>> _future;
+public:
+    asset()=default;
+    explicit asset(std::shared_future<std::shared_ptr<T>> future) : _future(std::move(future)){}
+
+    /// \brief Returns false for a default constructed asset that doesn't refer to anything.
+    bool valid()const{return _future.valid();}
+    /// \brief Returns true if the asset has been loaded (or loading failed) and get() won't block.
+    bool ready()const{return valid()&&_future.wait_for(std::chrono::seconds(0))==std::future_status::ready;}
+    /// \brief Returns the asset, waits for it if it's still being loaded. Rethrows the exception if loading failed.
+    T& get()const{return *_future.get();}
+    /// \brief Same as get() but returns the shared pointer owning the asset.
+    std::shared_ptr<T> shared()const{return _future.get();}
+};
+
+/// \brief Loads images and fonts on a pool of worker threads and caches them by path, so building a large gui doesn't
+/// block on file access and decoding and every file is only loaded once. The images are decoded straight into the
+/// pixel layout of the library (see image::format) and premultiplied with LFGUI_PREMULTIPLIED_ALPHA.
+///
+/// A load returns an asset right away. when_ready() registers a function that is called by poll() on the thread
+/// calling poll() (normally the gui thread, gui::redraw() and need_redraw() do that) once the asset is ready. The
+/// widgets use it through widget::when_loaded() to swap in their images when they arrive.
+///
+/// Images are decoded with image::load by default. That function is set by the wrapper and isn't necessarily thread
+/// safe, so it runs synchronously on the calling thread unless a wrapper declares it thread safe with set_decoder().
+class asset_loader
+{
+public:
+    using image_decoder=std::function<image(const std::string&)>;
+
+    /// \brief Creates a loader with the given number of worker threads, 0 means one less than the number of cores
+    /// (at least one). The threads are started with the first background load.
+    explicit asset_loader(int threads=0);
+    /// \brief Stops the worker threads. Loads that haven't started yet are dropped, their assets throw a
+    /// std::future_error from get().
+    ~asset_loader();
+    asset_loader(const asset_loader&)=delete;
+    asset_loader& operator=(const asset_loader&)=delete;
+
+    /// \brief Sets the function decoding image files. Only a thread safe decoder is run on the worker threads, others
+    /// run synchronously in load_image(). The default is image::load, not thread safe.
+    void set_decoder(image_decoder decoder,bool thread_safe);
+
+    /// \brief Starts loading the image at path or returns the cached asset if it has been requested before.
+    asset<const image> load_image(const std::string& path);
+    /// \brief Starts loading the TrueType font at path or returns the cached asset if it has been requested before.
+    asset<font> load_font(const std::string& path);
+    /// \brief Loads the default font (see font::default_font()) in the background and sets it as the default once it's
+    /// ready, unless text has been drawn in the meantime and the default font has been loaded synchronously.
+    void preload_default_font();
+
+    /// \brief Calls f(a.get()) from poll() once the asset is ready, or right away if it already is.
+    template<typename T,typename F>
+    void when_ready(const asset<T>& a,F f)
+    {
+        if(a.ready())
+        {
+            f(a.get());
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _callbacks.push_back(callback{[a]{return a.ready();},[a,f]{f(a.get());}});
+    }
+
+    /// \brief Calls the functions registered with when_ready() whose assets are ready, on the calling thread. Returns
+    /// the number of functions called. If an asset failed to load (or a function throws), the error is printed to
+    /// std::cerr and the other functions are still called.
+    size_t poll();
+    /// \brief Returns the number of loads that haven't finished yet.
+    size_t pending()const;
+    /// \brief Blocks until all loads have finished. Doesn't call the functions registered with when_ready(), see
+    /// poll().
+    void wait();
+    /// \brief Forgets all cached assets. Assets still in use stay valid.
+    void clear_cache();
+
+    /// \brief The loader used by the widgets.
+    static asset_loader& global();
+
+private:
+    struct callback
+    {
+        std::function<bool()> ready;
+        std::function<void()> call;
+    };
+
+    mutable std::mutex _mutex;
+    std::condition_variable _job_added;
+    std::condition_variable _job_finished;
+    std::deque<std::function<void()>> _jobs;
+    std::vector<std::thread> _threads;
+    int _thread_count;
+    size_t _pending=0;
+    bool _stop=false;
+    image_decoder _decoder;
+    bool _decoder_thread_safe=false;
+    std::map<std::string,asset<const image>> _images;
+    std::map<std::string,asset<font>> _fonts;
+    std::vector<callback> _callbacks;
+
+    /// \brief Returns the cached asset for path or creates it with load, run on a worker thread if async is set.
+    template<typename T>
+    asset<T> _load(std::map<std::string,asset<T>>& cache,const std::string& path,
+                   std::function<std::shared_ptr<T>()> load,bool async);
+    /// \brief The loop of a worker thread.
+    void _work();
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_ASSET_LOADER_H
@@ -0,0 +1,247 @@
+#include "blur.h"
+#include "display_list.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lfgui
+{
+
+namespace
+{
+
+/// \brief The width in bytes of the column blocks of the vertical passes. A block of a few hundred rows stays in the
+/// L2 cache while all passes run over it.
+const int blur_block_bytes=256;
+
+#ifdef LFGUI_SSE2
+/// \brief Loads the four bytes of a pixel as four 32 bit values.
+inline __m128i blur_load_pixel(const uint8_t* p)
+{
+    int32_t v;
+    memcpy(&v,p,4);
+    const __m128i v0=_mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v),v0),v0);
+}
+#endif
+
+/// \brief Writes the averages of the 2*radius+1 pixels (four interleaved channels) around each of the length pixels
+/// of target. source is padded: target pixel x is centered on source pixel x+radius and source has
+/// length+2*radius+1 pixels.
+void box_blur_row(const uint8_t* source,uint8_t* target,int length,int radius)
+{
+    const int window=radius*2+1;
+    const float scale=1.f/window;
+#ifdef LFGUI_SSE2
+    __m128i sum=_mm_setzero_si128();
+    for(int i=0;i<window;i++)
+        sum=_mm_add_epi32(sum,blur_load_pixel(source+i*4));
+    const __m128 scale_4=_mm_set1_ps(scale);
+    const __m128 half=_mm_set1_ps(0.5f);
+    for(int x=0;x<length;x++)
+    {
+        __m128i v=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(sum),scale_4),half));
+        v=_mm_packs_epi32(v,v);
+        const int32_t result=_mm_cvtsi128_si32(_mm_packus_epi16(v,v));
+        memcpy(target+x*4,&result,4);
+        sum=_mm_add_epi32(sum,_mm_sub_epi32(blur_load_pixel(source+(x+window)*4),blur_load_pixel(source+x*4)));
+    }
+#else
+    int sum[4]={0,0,0,0};
+    for(int i=0;i<window;i++)
+        for(int c=0;c<4;c++)
+            sum[c]+=source[i*4+c];
+    for(int x=0;x<length;x++)
+        for(int c=0;c<4;c++)
+        {
+            target[x*4+c]=uint8_t(float(sum[c])*scale+0.5f);
+            sum[c]+=source[(x+window)*4+c]-source[x*4+c];
+        }
+#endif
+}
+
+/// \brief The same as box_blur_row() vertically for rows of row_bytes bytes: target row y is the average of the
+/// source rows y to y+2*radius. sums needs room for row_bytes values.
+void box_blur_columns(const uint8_t* source,uint8_t* target,int rows,int row_bytes,int radius,int* sums)
+{
+    const int window=radius*2+1;
+    const float scale=1.f/window;
+    std::fill(sums,sums+row_bytes,0);
+    for(int y=0;y<window;y++)
+        for(int i=0;i<row_bytes;i++)
+            sums[i]+=source[size_t(y)*row_bytes+i];
+    for(int y=0;y<rows;y++)
+    {
+        const uint8_t* add=source+size_t(y+window)*row_bytes;
+        const uint8_t* remove=source+size_t(y)*row_bytes;
+        uint8_t* t=target+size_t(y)*row_bytes;
+        int i=0;
+#ifdef LFGUI_SSE2
+        const __m128i v0=_mm_setzero_si128();
+        const __m128 scale_4=_mm_set1_ps(scale);
+        const __m128 half=_mm_set1_ps(0.5f);
+        for(;i+16<=row_bytes;i+=16)
+        {
+            __m128i* s=(__m128i*)(sums+i);
+            __m128i s0=_mm_loadu_si128(s);
+            __m128i s1=_mm_loadu_si128(s+1);
+            __m128i s2=_mm_loadu_si128(s+2);
+            __m128i s3=_mm_loadu_si128(s+3);
+            __m128i r0=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s0),scale_4),half));
+            __m128i r1=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s1),scale_4),half));
+            __m128i r2=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s2),scale_4),half));
+            __m128i r3=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s3),scale_4),half));
+            _mm_storeu_si128((__m128i*)(t+i),_mm_packus_epi16(_mm_packs_epi32(r0,r1),_mm_packs_epi32(r2,r3)));
+
+            // the differences of the 16 bytes as 16 bit, then sign extended to 32 bit
+            __m128i a=_mm_loadu_si128((const __m128i*)(add+i));
+            __m128i b=_mm_loadu_si128((const __m128i*)(remove+i));
+            __m128i d_lo=_mm_sub_epi16(_mm_unpacklo_epi8(a,v0),_mm_unpacklo_epi8(b,v0));
+            __m128i d_hi=_mm_sub_epi16(_mm_unpackhi_epi8(a,v0),_mm_unpackhi_epi8(b,v0));
+            _mm_storeu_si128(s,_mm_add_epi32(s0,_mm_srai_epi32(_mm_unpacklo_epi16(d_lo,d_lo),16)));
+            _mm_storeu_si128(s+1,_mm_add_epi32(s1,_mm_srai_epi32(_mm_unpackhi_epi16(d_lo,d_lo),16)));
+            _mm_storeu_si128(s+2,_mm_add_epi32(s2,_mm_srai_epi32(_mm_unpacklo_epi16(d_hi,d_hi),16)));
+            _mm_storeu_si128(s+3,_mm_add_epi32(s3,_mm_srai_epi32(_mm_unpackhi_epi16(d_hi,d_hi),16)));
+        }
+#endif
+        for(;i<row_bytes;i++)
+        {
+            t[i]=uint8_t(float(sums[i])*scale+0.5f);
+            sums[i]+=add[i]-remove[i];
+        }
+    }
+}
+
+/// \brief Blurs area (already clipped to the image) with one box blur pass per radius, first all passes along the
+/// rows, then all passes along the columns. Box filters along different axes commute, so this equals alternating
+/// them (apart from rounding).
+void box_blur_passes(image& img,const rect& area,const std::vector<int>& radii)
+{
+    const int w=area.width;
+    const int h=area.height;
+    const int padding=*std::max_element(radii.begin(),radii.end());
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const int planes=4;
+    const int pixel_bytes=1;
+#else
+    const int planes=1;
+    const int pixel_bytes=4;
+#endif
+    uint8_t* data=(uint8_t*)img.data();
+    const size_t plane_bytes=img.plane_stride();
+    const size_t line_bytes=size_t(img.stride())*pixel_bytes;
+
+    // Rows: each row is copied into the middle of a buffer with the border pixels repeated to both sides, so the
+    // running sums need no bounds checks. The planes are interleaved to use the same kernel.
+    parallel_for(area.y,area.bottom(),std::max(1,(1<<16)/w),[&](int begin,int end)
+    {
+        std::vector<uint8_t> padded(size_t(w+padding*2+1)*4);
+        std::vector<uint8_t> blurred(size_t(w)*4);
+        uint8_t* middle=padded.data()+padding*4;
+        for(int y=begin;y<end;y++)
+        {
+            uint8_t* row=data+y*line_bytes+area.x*pixel_bytes;
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+            for(int x=0;x<w;x++)
+                for(int c=0;c<4;c++)
+                    middle[x*4+c]=row[c*plane_bytes+x];
+#else
+            memcpy(middle,row,size_t(w)*4);
+#endif
+            for(size_t pass=0;pass<radii.size();pass++)
+            {
+                if(pass)
+                    memcpy(middle,blurred.data(),size_t(w)*4);
+                for(int x=0;x<padding;x++)
+                    memcpy(padded.data()+x*4,middle,4);
+                for(int x=w;x<w+padding+1;x++)
+                    memcpy(middle+x*4,middle+(w-1)*4,4);
+                box_blur_row(middle-radii[pass]*4,blurred.data(),w,radii[pass]);
+            }
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+            for(int x=0;x<w;x++)
+                for(int c=0;c<4;c++)
+                    row[c*plane_bytes+x]=blurred[x*4+c];
+#else
+            memcpy(row,blurred.data(),size_t(w)*4);
+#endif
+        }
+    });
+
+    // Columns: in blocks of blur_block_bytes, each copied with padding rows into a buffer where all passes run.
+    const int blocks=(w*pixel_bytes+blur_block_bytes-1)/blur_block_bytes;
+    const int block_pixels=blur_block_bytes/pixel_bytes;
+    parallel_for(0,planes*blocks,std::max(1,(1<<16)/(block_pixels*h)),[&](int begin,int end)
+    {
+        std::vector<uint8_t> padded(size_t(h+padding*2+1)*blur_block_bytes);
+        std::vector<uint8_t> blurred(size_t(h)*blur_block_bytes);
+        std::vector<int> sums(blur_block_bytes);
+        for(int job=begin;job<end;job++)
+        {
+            const int block_begin=(job%blocks)*blur_block_bytes;
+            const int bytes=std::min(blur_block_bytes,w*pixel_bytes-block_begin);
+            uint8_t* column=data+(job/blocks)*plane_bytes+area.y*line_bytes+area.x*pixel_bytes+block_begin;
+            uint8_t* middle=padded.data()+size_t(padding)*bytes;
+            for(int y=0;y<h;y++)
+                memcpy(middle+size_t(y)*bytes,column+y*line_bytes,bytes);
+            for(size_t pass=0;pass<radii.size();pass++)
+            {
+                if(pass)
+                    memcpy(middle,blurred.data(),size_t(h)*bytes);
+                for(int y=0;y<padding;y++)
+                    memcpy(padded.data()+size_t(y)*bytes,middle,bytes);
+                for(int y=h;y<h+padding+1;y++)
+                    memcpy(middle+size_t(y)*bytes,middle+size_t(h-1)*bytes,bytes);
+                box_blur_columns(middle-size_t(radii[pass])*bytes,blurred.data(),h,bytes,radii[pass],sums.data());
+            }
+            for(int y=0;y<h;y++)
+                memcpy(column+y*line_bytes,blurred.data()+size_t(y)*bytes,bytes);
+        }
+    });
+}
+
+/// \brief Clips area to img and runs the passes with a radius above 0.
+void box_blur_clipped(image& img,const rect& area,std::vector<int> radii)
+{
+    const rect clipped=area.intersected(rect(0,0,img.width(),img.height()));
+    radii.erase(std::remove_if(radii.begin(),radii.end(),[](int r){return r<1;}),radii.end());
+    if(clipped.empty()||radii.empty())
+        return;
+    if(display_list* list=img.recording())
+        return list->add([=](image& i){box_blur_passes(i,clipped,radii);});
+    box_blur_passes(img,clipped,radii);
+}
+
+}   // namespace
+
+void box_blur(image& img,const rect& area,int radius,int passes)
+{
+    box_blur_clipped(img,area,std::vector<int>(std::max(0,passes),radius));
+}
+
+void gaussian_blur(image& img,const rect& area,float sigma)
+{
+    box_blur_clipped(img,area,gaussian_box_radii(sigma));
+}
+
+std::vector<int> gaussian_box_radii(float sigma,int passes)
+{
+    // Boxes of the sizes lower and lower+2 (both odd) are mixed so that the variances add up to sigma^2
+    // (see Kutskir, "Fastest Gaussian Blur", after Wells 1986).
+    std::vector<int> ret;
+    if(passes<1)
+        return ret;
+    const double variance=double(sigma)*sigma*12;
+    int lower=int(std::floor(std::sqrt(variance/passes+1)));
+    if(lower%2==0)
+        lower--;
+    lower=std::max(1,lower);
+    const int lower_count=int(std::round((variance-passes*lower*lower-4*passes*lower-3*passes)/(-4*lower-4)));
+    for(int i=0;i<passes;i++)
+        ret.push_back(((i<lower_count?lower:lower+2)-1)/2);
+    return ret;
+}
+
+}   // namespace lfgui
@@ -0,0 +1,35 @@
+#ifndef LFGUI_BLUR_H
+#define LFGUI_BLUR_H
+
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief Blurs the given area of img in place with passes box filters of size 2*radius+1. One pass averages the
+/// neighbourhood of every pixel, three passes come close to a gaussian. The cost doesn't depend on the radius: each
+/// pass keeps running sums along the rows and then along the columns, with SIMD if available. The columns are
+/// processed in blocks that fit into the cache and large areas are split into parts that are processed on multiple
+/// threads (see parallel_for()). Pixels outside of the area are neither read nor written, the area is extended by
+/// repeating its border pixels.
+/// With straight alpha the colors of transparent pixels bleed into their neighbours, with LFGUI_PREMULTIPLIED_ALPHA
+/// they don't.
+void box_blur(image& img,const rect& area,int radius,int passes=1);
+/// \brief Blurs the whole image, see box_blur(image&,const rect&,int,int).
+inline void box_blur(image& img,int radius,int passes=1){box_blur(img,rect(0,0,img.width(),img.height()),radius,passes);}
+
+/// \brief Blurs the given area of img in place with an approximated gaussian with the standard deviation sigma, made
+/// of three box blur passes with the radii from gaussian_box_radii(). See box_blur() for the details.
+void gaussian_blur(image& img,const rect& area,float sigma);
+/// \brief Blurs the whole image, see gaussian_blur(image&,const rect&,float).
+inline void gaussian_blur(image& img,float sigma){gaussian_blur(img,rect(0,0,img.width(),img.height()),sigma);}
+
+/// \brief Returns the radii of the given number of box blur passes whose combination has about the variance of a
+/// gaussian with the standard deviation sigma.
+std::vector<int> gaussian_box_radii(float sigma,int passes=3);
+
+}   // namespace lfgui
+
+#endif // LFGUI_BLUR_H
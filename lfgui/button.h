@@ -69,33 +69,25 @@ public:
 private:
     // called by the constructor to create the button images that are draw when drawing the widget
     // A rendered image of a 3D ball is used to draw a rectangular button with three states, rounded corners and borders.
+    // The images are empty until the source images have been loaded.
     void prepare_images()
     {
-        img_normal =image(ressource_path::get().append("gui_ball.png"));
-        img_hover  =image(ressource_path::get().append("gui_ball_dent_half.png"));
-        img_pressed=image(ressource_path::get().append("gui_ball_dent.png"));
-        image temp(width(),height());
-
-        // image for the button in normal state
-        {
-            temp.clear();
-            temp.draw_image_corners_stretched(border_width,img_normal);
-            img_normal=temp.copy();
-        }
-
-        // image for hovered button
-        {
-            temp.clear();
-            temp.draw_image_corners_stretched(border_width,img_hover);
-            img_hover=temp.copy();
-        }
+        asset_loader& loader=asset_loader::global();
+        when_loaded(loader.load_image(ressource_path::get().append("gui_ball.png")),
+                    [this](const image& img){img_normal=stretched(img);});
+        when_loaded(loader.load_image(ressource_path::get().append("gui_ball_dent_half.png")),
+                    [this](const image& img){img_hover=stretched(img);});
+        when_loaded(loader.load_image(ressource_path::get().append("gui_ball_dent.png")),
+                    [this](const image& img){img_pressed=stretched(img);});
+    }
 
-        // image for pressed button
-        {
-            temp.clear();
-            temp.draw_image_corners_stretched(border_width,img_pressed);
-            img_pressed=std::move(temp);
-        }
+    // returns the given ball image stretched to the size of the button with the corners kept
+    image stretched(const image& img)const
+    {
+        image ret(width(),height());
+        ret.clear();
+        ret.draw_image_corners_stretched(border_width,img);
+        return ret;
     }
 };
 
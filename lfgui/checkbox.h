@@ -49,7 +49,7 @@ public:
     void set_checked(bool checked)
     {
         checked_=checked;
-        dirty=true;
+        set_dirty();
     }
 
     bool is_checked()const{return checked_;}
@@ -57,8 +57,15 @@ public:
 private:
     void prepare_images()
     {
-        img_unchecked=image(ressource_path::get()+"gui_checkbox_unchecked.png").scaled(height(),height()).multiplied(text_color());
-        img_checked  =image(ressource_path::get()+"gui_checkbox_checked.png").scaled(height(),height()).multiplied(text_color());
+        asset_loader& loader=asset_loader::global();
+        when_loaded(loader.load_image(ressource_path::get()+"gui_checkbox_unchecked.png"),[this](const image& img)
+        {
+            img_unchecked=img.scaled(height(),height()).multiplied(text_color());
+        });
+        when_loaded(loader.load_image(ressource_path::get()+"gui_checkbox_checked.png"),[this](const image& img)
+        {
+            img_checked=img.scaled(height(),height()).multiplied(text_color());
+        });
     }
 };
 
@@ -0,0 +1,40 @@
+#include "display_list.h"
+#include "profiler.h"
+
+namespace lfgui
+{
+
+void display_list::replay(image& target)const
+{
+    LFGUI_PROFILE_ZONE("display_list replay");
+    for(const command& c:_commands)
+        c(target);
+}
+
+void display_list::clear()
+{
+    _commands.clear();
+    _previous_snapshots.swap(_snapshots);
+    _snapshots.clear();
+}
+
+std::shared_ptr<const image> display_list::snapshot(const image& img)
+{
+    // foreign pixels (and those of a sub_image()) can change without the image knowing about it
+    if(img.image_data.foreign_data)
+        return std::make_shared<image>(img.copy());
+    const uint64_t version=img.version();
+    auto it=_snapshots.find(version);
+    if(it!=_snapshots.end())
+        return it->second;
+    std::shared_ptr<const image> ret;
+    it=_previous_snapshots.find(version);
+    if(it!=_previous_snapshots.end())
+        ret=it->second;
+    else
+        ret=std::make_shared<image>(img.copy());
+    _snapshots[version]=ret;
+    return ret;
+}
+
+}   // namespace lfgui
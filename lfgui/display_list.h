@@ -0,0 +1,66 @@
+#ifndef LFGUI_DISPLAY_LIST_H
+#define LFGUI_DISPLAY_LIST_H
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief The draw calls of a frame, recorded to be rasterized later and usually on another thread (see
+/// frame_pipeline). An image constructed with a display_list records every draw call into it instead of drawing:
+///
+/// \code
+/// lfgui::display_list list;
+/// lfgui::image recorder(list,800,600);
+/// gui.redraw(recorder,0,0);      // runs the on_paint handlers, nothing is rasterized
+/// list.replay(frame);            // draws the frame, can be done by another thread
+/// \endcode
+///
+/// The recorded calls keep copies of all their parameters, so the widgets can change right after recording. Drawn
+/// images are copied as well (see snapshot()), images that don't change are only copied once and the copy is shared
+/// by all the frames drawing it.
+///
+/// A recording image has no pixels: reading them (get_pixel(), data(), drawing it into another image) and changing its
+/// size are not possible.
+class display_list
+{
+public:
+    using command=std::function<void(image&)>;
+
+    display_list()=default;
+    display_list(const display_list&)=delete;
+    display_list& operator=(const display_list&)=delete;
+
+    /// \brief Appends a draw call. The recording image calls this, free functions drawing into an image (like
+    /// gaussian_blur()) do so if image::recording() is set.
+    void add(command c){_commands.push_back(std::move(c));}
+    /// \brief Executes the recorded draw calls on target, in order.
+    void replay(image& target)const;
+    /// \brief Removes all draw calls and starts a new frame for snapshot(): copies not used by the frame recorded
+    /// since the last clear() are dropped.
+    void clear();
+    /// \brief Returns the number of recorded draw calls.
+    size_t size()const{return _commands.size();}
+    bool empty()const{return _commands.empty();}
+    /// \brief Exchanges the draw calls with the ones of o. The snapshots stay with each list.
+    void swap_commands(display_list& o){_commands.swap(o._commands);}
+
+    /// \brief Returns an unchangeable copy of img for draw calls that are replayed later. Images whose pixels haven't
+    /// changed since the last copy (see image::version()) are not copied again, images of foreign memory always are.
+    std::shared_ptr<const image> snapshot(const image& img);
+
+private:
+    std::vector<command> _commands;
+    /// \brief The snapshots used by the frame being recorded and by the previous one, by image::version().
+    std::unordered_map<uint64_t,std::shared_ptr<const image>> _snapshots;
+    std::unordered_map<uint64_t,std::shared_ptr<const image>> _previous_snapshots;
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_DISPLAY_LIST_H
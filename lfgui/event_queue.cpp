@@ -0,0 +1,114 @@
+#include "event_queue.h"
+
+namespace lfgui
+{
+
+// A bounded queue as described by Dmitry Vyukov: every cell has a sequence number that tells the producers and the
+// consumer whose turn it is. A cell at position pos is free for the producer if its sequence is pos and holds a
+// published event if its sequence is pos+1. The consumer frees it again by setting it to pos+capacity.
+
+event_queue::event_queue(size_t capacity)
+    : _enqueue_pos(0),_posted(0),_rejected(0),_coalesced(0),_processed(0),_batches(0),_largest_batch(0)
+{
+    size_t size=2;
+    while(size<capacity)
+        size*=2;
+    _cells.reset(new cell[size]);
+    _mask=size-1;
+    for(size_t i=0;i<size;i++)
+        _cells[i].sequence.store(i,std::memory_order_relaxed);
+}
+
+bool event_queue::push(posted_event&& e)
+{
+    cell* c;
+    size_t pos=_enqueue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        c=&_cells[pos&_mask];
+        const size_t sequence=c->sequence.load(std::memory_order_acquire);
+        const intptr_t difference=intptr_t(sequence)-intptr_t(pos);
+        if(difference==0)
+        {
+            if(_enqueue_pos.compare_exchange_weak(pos,pos+1,std::memory_order_relaxed))
+                break;
+        }
+        else if(difference<0)     // the consumer hasn't taken the event a lap ago yet, the queue is full
+        {
+            _rejected.fetch_add(1,std::memory_order_relaxed);
+            return false;
+        }
+        else
+            pos=_enqueue_pos.load(std::memory_order_relaxed);
+    }
+    c->event=std::move(e);
+    c->sequence.store(pos+1,std::memory_order_release);
+    _posted.fetch_add(1,std::memory_order_relaxed);
+    return true;
+}
+
+bool event_queue::_pop(posted_event& e)
+{
+    cell& c=_cells[_dequeue_pos&_mask];
+    if(c.sequence.load(std::memory_order_acquire)!=_dequeue_pos+1)
+        return false;
+    e=std::move(c.event);
+    c.event=posted_event();     // don't keep the captures of the task alive until the cell is used again
+    c.sequence.store(_dequeue_pos+_mask+1,std::memory_order_release);
+    _dequeue_pos++;
+    return true;
+}
+
+posted_event* event_queue::_peek()
+{
+    cell& c=_cells[_dequeue_pos&_mask];
+    if(c.sequence.load(std::memory_order_acquire)!=_dequeue_pos+1)
+        return nullptr;
+    return &c.event;
+}
+
+size_t event_queue::drain(const std::function<void(posted_event&)>& handler)
+{
+    // only what has been claimed so far, the handler may post again
+    const size_t limit=_enqueue_pos.load(std::memory_order_acquire)-_dequeue_pos;
+    size_t taken=0;
+    posted_event e;
+    while(taken<limit&&_pop(e))
+    {
+        taken++;
+        posted_event* next=taken<limit?_peek():nullptr;
+        if(next&&next->kind==e.kind&&(e.kind==posted_event::type::mouse_move||e.kind==posted_event::type::mouse_wheel))
+        {
+            if(e.kind==posted_event::type::mouse_wheel)
+            {
+                next->x+=e.x;
+                next->y+=e.y;
+            }
+            _coalesced.fetch_add(1,std::memory_order_relaxed);
+            continue;
+        }
+        _processed.fetch_add(1,std::memory_order_relaxed);
+        handler(e);
+    }
+    if(taken)
+    {
+        _batches.fetch_add(1,std::memory_order_relaxed);
+        if(taken>_largest_batch.load(std::memory_order_relaxed))
+            _largest_batch.store(taken,std::memory_order_relaxed);
+    }
+    return taken;
+}
+
+event_queue::statistics event_queue::stats()const
+{
+    statistics ret;
+    ret.posted=_posted.load(std::memory_order_relaxed);
+    ret.rejected=_rejected.load(std::memory_order_relaxed);
+    ret.coalesced=_coalesced.load(std::memory_order_relaxed);
+    ret.processed=_processed.load(std::memory_order_relaxed);
+    ret.batches=_batches.load(std::memory_order_relaxed);
+    ret.largest_batch=_largest_batch.load(std::memory_order_relaxed);
+    return ret;
+}
+
+}   // namespace lfgui
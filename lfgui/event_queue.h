@@ -0,0 +1,102 @@
+#ifndef LFGUI_EVENT_QUEUE_H
+#define LFGUI_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace lfgui
+{
+
+/// \brief An input event or a task posted to a gui from another thread, see gui::post().
+struct posted_event
+{
+    enum class type : uint8_t
+    {
+        task,
+        mouse_press,
+        mouse_release,
+        mouse_move,
+        mouse_wheel,    ///< \brief x and y are the wheel deltas
+        key_press,
+        key_release
+    };
+
+    type kind=type::task;
+    int x=0;
+    int y=0;
+    uint32_t button=0;          ///< \brief the event button, or the key for key events
+    uint32_t button_state=0;
+    std::string character;      ///< \brief the entered text of key events in UTF-8
+    std::function<void()> task;
+};
+
+/// \brief A bounded queue with any number of producer threads and one consumer thread. Pushing doesn't take a lock:
+/// a producer claims a slot with a compare and swap on the write position and publishes it with the sequence number
+/// of the slot, so a simulation thread posting to the gui never waits for the gui thread or for other producers.
+///
+/// A full queue rejects the event instead of blocking or growing, push() returns false and the rejection is counted.
+/// The consumer takes the events in batches with drain(), merging consecutive mouse moves and wheel events on the
+/// way, so a fast producer costs one hit test per frame instead of one per event.
+class event_queue
+{
+public:
+    /// \brief Counters of a queue, see stats().
+    struct statistics
+    {
+        uint64_t posted=0;          ///< \brief events accepted by push()
+        uint64_t rejected=0;        ///< \brief events dropped by push() because the queue was full
+        uint64_t coalesced=0;       ///< \brief mouse moves and wheel events merged into the following one
+        uint64_t processed=0;       ///< \brief events handed to the handler of drain()
+        uint64_t batches=0;         ///< \brief calls of drain() that found at least one event
+        uint64_t largest_batch=0;   ///< \brief the most events taken by one drain()
+    };
+
+    /// \brief The capacity is rounded up to a power of two, at least 2.
+    explicit event_queue(size_t capacity=1024);
+    event_queue(const event_queue&)=delete;
+    event_queue& operator=(const event_queue&)=delete;
+
+    /// \brief Thread safe. Appends an event, returns false if the queue is full.
+    bool push(posted_event&& e);
+    /// \brief Only for the consumer thread. Hands the events queued so far to handler in order, merging consecutive
+    /// mouse moves (the last position wins) and wheel events (the deltas are added up). Events pushed while draining,
+    /// also by the handler itself, are left for the next call. Returns the number of events taken from the queue.
+    /// If the handler throws, the events after the throwing one stay queued.
+    size_t drain(const std::function<void(posted_event&)>& handler);
+
+    size_t capacity()const{return _mask+1;}
+    /// \brief Thread safe. Returns the counters since the queue was created.
+    statistics stats()const;
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        posted_event event;
+    };
+
+    std::unique_ptr<cell[]> _cells;
+    size_t _mask;
+    char _pad0[64];                         ///< \brief keeps the write position in its own cache line
+    std::atomic<size_t> _enqueue_pos;
+    char _pad1[64];
+    size_t _dequeue_pos=0;                  ///< \brief only touched by the consumer
+    std::atomic<uint64_t> _posted;
+    std::atomic<uint64_t> _rejected;
+    std::atomic<uint64_t> _coalesced;
+    std::atomic<uint64_t> _processed;
+    std::atomic<uint64_t> _batches;
+    std::atomic<uint64_t> _largest_batch;
+
+    /// \brief Takes the next event if one is published. Only for the consumer.
+    bool _pop(posted_event& e);
+    /// \brief Returns the next event without taking it, nullptr if none is published. Only for the consumer.
+    posted_event* _peek();
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_EVENT_QUEUE_H
@@ -7,16 +7,22 @@
 #include <memory>
 #include <exception>
 #include <functional>
+#ifdef _MSC_VER
 #include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
 
 #include "../stk_misc.h"
 #include "../stk_debugging.h"
+#include "memory_pool.h"
 
 struct stbtt_fontinfo;
 
 namespace lfgui
 {
 
+/// \brief Owns a buffer from memory_pool::global() (aligned to memory_pool::alignment) or refers to foreign data.
 struct memory_wrapper
 {
     uint8_t* ptr_=0;
@@ -25,8 +31,7 @@ struct memory_wrapper
 
     memory_wrapper(size_t size=0):size_(size)
     {
-        if(size)
-            ptr_=(uint8_t*)malloc(size);
+        ptr_=(uint8_t*)memory_pool::global().allocate(size);
     }
 
     memory_wrapper(void* data,size_t size):ptr_((uint8_t*)data),size_(size),foreign_data(true)
@@ -35,28 +40,32 @@ struct memory_wrapper
 
     ~memory_wrapper()
     {
-        if(ptr_&&!foreign_data)
-            free(ptr_);
+        release();
     }
 
     uint8_t* get()const{return ptr_;}
     int size()const{return size_;}
 
-    void reset(size_t size)
+    /// \brief Gives the buffer back to the pool, unless it's foreign.
+    void release()
     {
         if(ptr_&&!foreign_data)
-            free(ptr_);
+            memory_pool::global().release(ptr_,size_);
+        ptr_=0;
+        size_=0;
         foreign_data=false;
-        if(size)
-            ptr_=(uint8_t*)malloc(size);
+    }
+
+    void reset(size_t size)
+    {
+        release();
+        ptr_=(uint8_t*)memory_pool::global().allocate(size);
         size_=size;
     }
 
     void reset(void* data,size_t size)
     {
-std::cout<<"resetting to"<<(size_t)data<<std::endl;
-        if(ptr_&&!foreign_data)
-            free(ptr_);
+        release();
         foreign_data=true;
         ptr_=(uint8_t*)data;
         size_=size;
@@ -64,19 +73,19 @@ std::cout<<"resetting to"<<(size_t)data<<std::endl;
 
     memory_wrapper(memory_wrapper&& o)
     {
-        ptr_=o.ptr_;
-        size_=o.size_;
-        foreign_data=o.foreign_data;
-        o.ptr_=0;
-        o.size_=0;
+        *this=std::move(o);
     }
     memory_wrapper& operator=(memory_wrapper&& o)
     {
+        if(this==&o)
+            return *this;
+        release();
         ptr_=o.ptr_;
         size_=o.size_;
         foreign_data=o.foreign_data;
         o.ptr_=0;
         o.size_=0;
+        o.foreign_data=false;
         return *this;
     }
 
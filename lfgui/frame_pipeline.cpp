@@ -0,0 +1,99 @@
+#include "frame_pipeline.h"
+#include "profiler.h"
+
+#include <chrono>
+
+namespace lfgui
+{
+
+frame_pipeline::frame_pipeline(present_function present) : _present(std::move(present))
+{
+    _thread=std::thread([this]{_run();});
+}
+
+frame_pipeline::~frame_pipeline()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _rendered.wait(lock,[this]{return !_pending;});
+        _stop=true;
+    }
+    _submitted.notify_all();
+    _thread.join();
+}
+
+image& frame_pipeline::begin_frame(int width,int height)
+{
+    // drops the draw calls of the frame rendered before the last one and the snapshots it alone used
+    _recording.clear();
+    if(_recorder.width()!=width||_recorder.height()!=height)
+        _recorder=image(_recording,width,height);
+    return _recorder;
+}
+
+void frame_pipeline::submit(const std::vector<lfgui::rect>& damage)
+{
+    LFGUI_PROFILE_ZONE("frame_pipeline submit");
+    std::unique_lock<std::mutex> lock(_mutex);
+    if(_pending)
+    {
+        auto start=std::chrono::steady_clock::now();
+        _rendered.wait(lock,[this]{return !_pending;});
+        _statistics.stalls++;
+        _statistics.stall_seconds+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    }
+    _in_flight.swap_commands(_recording);
+    _width=_recorder.width();
+    _height=_recorder.height();
+    _damage=damage;
+    _pending=true;
+    _statistics.submitted++;
+    lock.unlock();
+    _submitted.notify_one();
+}
+
+void frame_pipeline::wait()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _rendered.wait(lock,[this]{return !_pending;});
+}
+
+frame_pipeline::statistics frame_pipeline::stats()const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _statistics;
+}
+
+void frame_pipeline::_run()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for(;;)
+    {
+        _submitted.wait(lock,[this]{return _stop||_pending;});
+        if(_stop)
+            return;
+        // _in_flight, the size, _damage and _frame are left alone by the gui thread while _pending is set
+        lock.unlock();
+        auto start=std::chrono::steady_clock::now();
+        {
+            LFGUI_PROFILE_ZONE("frame_pipeline render");
+            if(_frame.width()!=_width||_frame.height()!=_height)
+                _frame=image(_width,_height);
+            _in_flight.replay(_frame);
+        }
+        const double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        if(_present)
+        {
+            LFGUI_PROFILE_ZONE("frame_pipeline present");
+            _present(_frame,_damage);
+        }
+        lock.lock();
+        _pending=false;
+        _statistics.rendered++;
+        _statistics.commands+=_in_flight.size();
+        _statistics.render_seconds+=seconds;
+        _rendered.notify_all();
+    }
+}
+
+}   // namespace lfgui
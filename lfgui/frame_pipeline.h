@@ -0,0 +1,89 @@
+#ifndef LFGUI_FRAME_PIPELINE_H
+#define LFGUI_FRAME_PIPELINE_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "display_list.h"
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief Rasterizes and presents the frames of a wrapper on a separate render thread: the gui thread only records
+/// frame N+1 into a display_list (running the on_paint handlers, but drawing no pixels) while the render thread
+/// replays the draw calls of frame N into its image and presents it, for example by converting it into the memory of
+/// the graphics API (a QImage, a staging buffer, ...). The gui thread so gets back to the events right after the
+/// widgets have been painted.
+///
+/// The wrapper gets the image to draw the frame into from begin_frame() and hands the recorded frame over with
+/// submit(). At most one frame is in flight, submit() waits until the previous frame has been rendered and presented
+/// (counted as a stall in stats()). Every frame is rendered completely and presented, so presenting only the damaged
+/// areas of a frame (see gui::damage()) is enough.
+///
+/// The present function runs on the render thread and must only use the frame and the damage it gets, not the
+/// widgets. The gui thread has to call wait() before it reads the frame (see frame()) or what the present function
+/// writes (like the QImage drawn by paintEvent) or replaces it.
+class frame_pipeline
+{
+public:
+    /// \brief Presents a frame. The damage are the areas changed since the previous frame.
+    using present_function=std::function<void(const image& frame,const std::vector<lfgui::rect>& damage)>;
+
+    /// \brief Counters of a pipeline, see stats().
+    struct statistics
+    {
+        uint64_t submitted=0;       ///< \brief frames handed over with submit()
+        uint64_t rendered=0;        ///< \brief frames rasterized and presented by the render thread
+        uint64_t commands=0;        ///< \brief draw calls replayed by the render thread
+        uint64_t stalls=0;          ///< \brief submits that had to wait for the previous frame
+        double stall_seconds=0;     ///< \brief time the gui thread spent waiting in submit()
+        double render_seconds=0;    ///< \brief time the render thread spent rasterizing, without presenting
+    };
+
+    /// \brief Starts the render thread. Without a present function the frames are only rendered, see frame().
+    explicit frame_pipeline(present_function present=present_function());
+    /// \brief Renders the frame in flight, if any, and stops the render thread.
+    ~frame_pipeline();
+    frame_pipeline(const frame_pipeline&)=delete;
+    frame_pipeline& operator=(const frame_pipeline&)=delete;
+
+    /// \brief Starts a new frame of the given size and returns the image to draw it into. The image records the draw
+    /// calls (see display_list), it stays valid until the next call.
+    image& begin_frame(int width,int height);
+    /// \brief Hands the frame recorded since begin_frame() over to the render thread together with its damage.
+    void submit(const std::vector<lfgui::rect>& damage);
+    /// \brief Blocks until the frame in flight has been rendered and presented.
+    void wait();
+    /// \brief Returns the last rendered frame. Only valid after wait() and until the next submit().
+    const image& frame()const{return _frame;}
+    /// \brief Returns the counters since the pipeline was created.
+    statistics stats()const;
+
+private:
+    present_function _present;
+    display_list _recording;                ///< \brief the frame the gui thread records
+    image _recorder;                        ///< \brief records into _recording
+    display_list _in_flight;                ///< \brief the frame the render thread renders
+    int _width=0;                           ///< \brief the size of the frame in flight
+    int _height=0;
+    std::vector<lfgui::rect> _damage;       ///< \brief the damage of the frame in flight
+    image _frame;                           ///< \brief the frame rendered last
+    bool _pending=false;                    ///< \brief set while a frame waits for or is being rendered
+    bool _stop=false;
+    statistics _statistics;
+    mutable std::mutex _mutex;
+    std::condition_variable _submitted;
+    std::condition_variable _rendered;
+    std::thread _thread;
+
+    /// \brief The loop of the render thread.
+    void _run();
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_FRAME_PIPELINE_H
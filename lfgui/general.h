@@ -10,6 +10,24 @@
 
 #include "geometry.h"
 
+// The SIMD code paths are chosen at compile time by the instruction sets the compiler is allowed to use (like -msse4.1
+// or -mavx2, or /arch:AVX2 with Visual Studio which always has SSE2 on x64). Defining LFGUI_NO_SIMD disables all of
+// them and only the plain C++ code is used.
+#ifndef LFGUI_NO_SIMD
+#if defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP>=2)
+#define LFGUI_SSE2
+#endif
+#if defined(__SSSE3__)||defined(__AVX__)
+#define LFGUI_SSSE3
+#endif
+#if defined(__SSE4_1__)||defined(__AVX__)
+#define LFGUI_SSE4_1
+#endif
+#ifdef __AVX2__
+#define LFGUI_AVX2
+#endif
+#endif
+
 namespace lfgui
 {
 
@@ -21,6 +39,16 @@ enum class alignment
     right
 };
 
+/// \brief Memory layouts of pixel data with 8 bit per channel. See image::format and convert_pixels().
+enum class pixel_format
+{
+    bgra,           ///< \brief packed, blue at the lowest address (Qt's ARGB32, Direct3D, Windows bitmaps)
+    rgba,           ///< \brief packed, red at the lowest address (OpenGL, Urho3D)
+    planar_bgra     ///< \brief four planes: all blue values, then green, red and alpha
+};
+
+/// \brief A color with 8 bit per channel. The channels are in the same order as in a packed image, BGRA or with
+/// LFGUI_PACKED_RGBA defined RGBA.
 struct color
 {
     union
@@ -29,14 +57,25 @@ struct color
         uint32_t value;
         struct
         {
+#ifdef LFGUI_PACKED_RGBA
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+            uint8_t a;
+#else
             uint8_t b;
             uint8_t g;
             uint8_t r;
             uint8_t a;
+#endif
         };
     };
 
+#ifdef LFGUI_PACKED_RGBA
+    color(uint8_t r=0,uint8_t g=0,uint8_t b=0,uint8_t a=255) : r(r),g(g),b(b),a(a){}
+#else
     color(uint8_t r=0,uint8_t g=0,uint8_t b=0,uint8_t a=255) : b(b),g(g),r(r),a(a){}
+#endif
     /// \brief Constructs a color from an array. Order is RGBA.
     //color(uint8_t array[4]) {*((uint32_t*)this->array)=*((uint32_t*)array);}
     /// \brief Constructs a color from one uint32_t. On little-endian systems (x86) the colors are reversed as ABGR.
@@ -54,6 +93,20 @@ struct color
         return color(r,g,b,a*f/255);
     }
 
+    /// \brief Returns this color with red, green and blue multiplied by the alpha (premultiplied alpha).
+    color premultiplied()const
+    {
+        return color((r*a+128)*257>>16,(g*a+128)*257>>16,(b*a+128)*257>>16,a);
+    }
+
+    /// \brief The inverse of premultiplied(). Loses precision with small alpha values.
+    color unpremultiplied()const
+    {
+        if(a==0)
+            return color(0,0,0,0);
+        return color(std::min(255,(r*255+a/2)/a),std::min(255,(g*255+a/2)/a),std::min(255,(b*255+a/2)/a),a);
+    }
+
     color operator*(float f)
     {
         return color(r*f,g*f,b*f,a*f);
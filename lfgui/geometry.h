@@ -24,7 +24,11 @@ struct exception : public std::exception
             custom_handler()(text);
         else
         {
+#ifdef _MSC_VER
             __debugbreak();
+#else
+            __builtin_trap();
+#endif
             exit(-1);
         }
     }
@@ -156,6 +160,100 @@ struct rect
     int left()const{return x;}
     int bottom()const{return y+height;}
     int right()const{return x+width;}
+
+    /// \brief Returns true if this rectangle has no area.
+    bool empty()const{return width<=0||height<=0;}
+    /// \brief Returns width*height.
+    int area()const{return empty()?0:width*height;}
+
+    /// \brief Returns the overlapping area of this and the given rectangle. The result is empty if they don't overlap.
+    rect intersected(const rect& o)const
+    {
+        int l=std::max(left(),o.left());
+        int t=std::max(top(),o.top());
+        int r=std::min(right(),o.right());
+        int b=std::min(bottom(),o.bottom());
+        if(r<=l||b<=t)
+            return rect();
+        return rect(l,t,r-l,b-t);
+    }
+
+    /// \brief Returns the bounding rectangle of this and the given rectangle. Empty rectangles are ignored.
+    rect united(const rect& o)const
+    {
+        if(o.empty())
+            return *this;
+        if(empty())
+            return o;
+        int l=std::min(left(),o.left());
+        int t=std::min(top(),o.top());
+        int r=std::max(right(),o.right());
+        int b=std::max(bottom(),o.bottom());
+        return rect(l,t,r-l,b-t);
+    }
+
+    /// \brief Returns true if the given rectangle is completely inside of this one. Empty rectangles are always inside.
+    bool contains(const rect& o) const
+    {
+        return o.empty()||(x<=o.x&&o.right()<=right()&&y<=o.y&&o.bottom()<=bottom());
+    }
+
+    /// \brief Returns true if the two rectangles overlap or touch each other.
+    bool touches(const rect& o)const
+    {
+        return left()<=o.right()&&o.left()<=right()&&top()<=o.bottom()&&o.top()<=bottom();
+    }
+};
+
+/// \brief A 2D affine transformation, maps x,y to a*x+b*y+tx,c*x+d*y+ty. Matrices are combined with *, the right one
+/// is applied first: (translation(100,50)*rotation(0.5f)).map(x,y) rotates x,y and then moves it.
+struct affine_matrix
+{
+    float a=1;
+    float b=0;
+    float c=0;
+    float d=1;
+    float tx=0;
+    float ty=0;
+
+    affine_matrix(){}
+    affine_matrix(float a,float b,float c,float d,float tx,float ty) : a(a),b(b),c(c),d(d),tx(tx),ty(ty){}
+
+    static affine_matrix translation(float x,float y){return affine_matrix(1,0,0,1,x,y);}
+    static affine_matrix scaling(float sx,float sy){return affine_matrix(sx,0,0,sy,0,0);}
+    /// \brief Rotates by angle (in radians) around 0,0. As y points down, positive angles rotate clockwise.
+    static affine_matrix rotation(float angle)
+    {
+        float s=std::sin(angle);
+        float c=std::cos(angle);
+        return affine_matrix(c,-s,s,c,0,0);
+    }
+    /// \brief Rotates by angle (in radians) around the point x,y.
+    static affine_matrix rotation(float angle,float x,float y){return translation(x,y)*rotation(angle)*translation(-x,-y);}
+
+    affine_matrix operator*(const affine_matrix& o)const
+    {
+        return affine_matrix(a*o.a+b*o.c,a*o.b+b*o.d,
+                             c*o.a+d*o.c,c*o.b+d*o.d,
+                             a*o.tx+b*o.ty+tx,c*o.tx+d*o.ty+ty);
+    }
+
+    point_float map(float x,float y)const{return point_float(a*x+b*y+tx,c*x+d*y+ty);}
+    float determinant()const{return a*d-b*c;}
+    /// \brief Returns true if the matrix can be inverted, which is the case if it doesn't collapse the plane to a line.
+    bool invertible()const{return std::abs(determinant())>1e-12f;}
+    /// \brief Returns the inverse transformation. Throws an lfgui::exception if the matrix is not invertible().
+    affine_matrix inverted()const
+    {
+        if(!invertible())
+            throw lfgui::exception("affine_matrix::inverted() called on a matrix that can't be inverted");
+        float det=determinant();
+        float ia=d/det;
+        float ib=-b/det;
+        float ic=-c/det;
+        float id=a/det;
+        return affine_matrix(ia,ib,ic,id,-(ia*tx+ib*ty),-(ic*tx+id*ty));
+    }
 };
 
 /// \brief Used to position and size widgets.
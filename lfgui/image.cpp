@@ -1,6 +1,11 @@
+#include <algorithm>
 #include <cmath>
+#include <mutex>
 
 #include "image.h"
+#include "display_list.h"
+#include "rasterizer.h"
+#include "resample.h"
 #include "../stb_truetype.h"
 
 using namespace std;
@@ -8,10 +13,48 @@ using namespace std;
 namespace lfgui
 {
 
+thread_local image::draw_statistics* image::statistics=nullptr;
+
+namespace
+{
+
+std::atomic<uint64_t> last_image_version(0);
+
+/// \brief Returns the pixels of v as an image that stays unchanged while a recorded draw call waits for its replay,
+/// and the area of it that v shows. Views of images share the snapshot of the whole image (see
+/// display_list::snapshot()), views of foreign data are copied.
+std::pair<std::shared_ptr<const image>,lfgui::rect> recorded_view(display_list& list,const image_view& v)
+{
+    if(v.source())
+        return {list.snapshot(*v.source()),lfgui::rect(v.origin().x,v.origin().y,v.width(),v.height())};
+    std::shared_ptr<const image> copy=std::make_shared<image>(v.copy());
+    return {copy,copy->rect()};
+}
+
+}   // namespace
+
+#if defined(LFGUI_SSE2)&&defined(LFGUI_PREMULTIPLIED_ALPHA)
+/// \brief Blends 16 premultiplied source values over the destination: source+destination*(255-a)/255.
+/// a_neg_1 and a_neg_2 are the unpacked 255-a of the lower and upper 8 pixels.
+static inline __m128i blend_premultiplied(__m128i destination,__m128i source,__m128i a_neg_1,__m128i a_neg_2)
+{
+    const __m128i v0=_mm_setzero_si128();
+    const __m128i v32897=_mm_set1_epi16(32897);
+    __m128i d_1=_mm_mullo_epi16(_mm_unpacklo_epi8(destination,v0),a_neg_1);
+    __m128i d_2=_mm_mullo_epi16(_mm_unpackhi_epi8(destination,v0),a_neg_2);
+    d_1=_mm_srli_epi16(_mm_mulhi_epu16(d_1,v32897),7);
+    d_2=_mm_srli_epi16(_mm_mulhi_epu16(d_2,v32897),7);
+    return _mm_adds_epu8(_mm_packus_epi16(d_1,d_2),source);
+}
+#endif
+
 image::image(const std::string& filename)
 {
     STK_STACKTRACE
     *this=load(filename);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+    premultiply();
+#endif
 }
 
 image::image(int width,int height):width_(width),height_(height)
@@ -20,10 +63,19 @@ image::image(int width,int height):width_(width),height_(height)
     image_data.reset(width*height*4);
 }
 
-image::image(void* data,int width,int height):width_(width),height_(height)
+image::image(display_list& list,int width,int height):width_(width),height_(height),_recording(&list)
+{
+}
+
+image::image(void* data,int width,int height,int stride,int plane_stride)
+    : width_(width),height_(height),_stride(stride),_plane_stride(plane_stride)
 {
     STK_STACKTRACE
-    image_data.reset(data,width*height*4);
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    image_data.reset(data,size_t(this->plane_stride())*4);
+#else
+    image_data.reset(data,size_t(this->stride())*height*4);
+#endif
 }
 
 /*
@@ -47,6 +99,8 @@ image& image::operator=(const image& o)
 image image::copy() const
 {
     STK_STACKTRACE
+    if(!contiguous())
+        return image_view(*this).copy();
     image ret(width_,height_);
     memcpy(ret.image_data.get(),image_data.get(),width()*height()*4);
     return ret;
@@ -54,11 +108,21 @@ image image::copy() const
 
 image::image(image&& o)
 {
-    image_data=std::move(o.image_data);
-    width_=o.width_;
-    height_=o.height_;
-    o.width_=0;
-    o.height_=0;
+    *this=std::move(o);
+}
+
+uint64_t image::version()const
+{
+    uint64_t ret=_version.load(std::memory_order_relaxed);
+    if(ret)
+        return ret;
+    const uint64_t next=last_image_version.fetch_add(1,std::memory_order_relaxed)+1;
+    return _version.compare_exchange_strong(ret,next,std::memory_order_relaxed)?next:ret;
+}
+
+void image::_record(std::function<void(image&)> command)
+{
+    _recording->add(std::move(command));
 }
 
 image& image::operator=(image&& o)
@@ -66,24 +130,43 @@ image& image::operator=(image&& o)
     image_data=std::move(o.image_data);
     width_=o.width_;
     height_=o.height_;
+    _opacity=std::move(o._opacity);
+    _opacity_state.store(o._opacity_state.load());
+    _version.store(o._version.load());
+    _stride=o._stride;
+    _plane_stride=o._plane_stride;
+    _parent=o._parent;
+    _recording=o._recording;
     o.width_=0;
     o.height_=0;
+    o._stride=0;
+    o._plane_stride=0;
+    o._invalidate_opacity();
+    o._parent=nullptr;
+    o._recording=nullptr;
     return *this;
 }
 
-// TODO
-//image& image::resize_cubic(int w,int h){cimage->resize(std::max(0,w),std::max(0,h),1,4,5);return *this;}
+void image::_replace_data(memory_wrapper&& mw,int w,int h)
+{
+    image_data=std::move(mw);
+    width_=w;
+    height_=h;
+    _stride=0;
+    _plane_stride=0;
+    _version.store(0,std::memory_order_relaxed);
+    _parent=nullptr;    // the pixels are no longer those of the parent
+}
 
 image& image::resize_nearest(int w,int h)
 {
+    _invalidate_opacity();
     memory_wrapper mw(w*h*4);
     if(w<1||h<1||width()<1||height()<1)
     {
 //std::cerr<<w<<":"<<h<<" "<<width()<<":"<<height()<<std::endl;
         __builtin_trap();
-        image_data=std::move(mw);
-        width_=w;
-        height_=h;
+        _replace_data(std::move(mw),w,h);
         return *this;
     }
 
@@ -93,9 +176,9 @@ image& image::resize_nearest(int w,int h)
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
     uint8_t* data_new=mw.get();
     uint8_t* data_old=image_data.get();
-    int count1_old=width()*height();
-    int count2_old=width()*height()*2;
-    int count3_old=width()*height()*3;
+    int count1_old=plane_stride();
+    int count2_old=plane_stride()*2;
+    int count3_old=plane_stride()*3;
     int count1_new=w*h;
     int count2_new=w*h*2;
     int count3_new=w*h*3;
@@ -103,7 +186,7 @@ image& image::resize_nearest(int w,int h)
     for(int y=0;y<h;y++)
     {
         int yw_new=y*w;
-        int yw_old=int(y*fh)*width();
+        int yw_old=int(y*fh)*stride();
 
         for(int x=0;x<w;x++)
         {
@@ -121,7 +204,7 @@ image& image::resize_nearest(int w,int h)
     for(int y=0;y<h;y++)
     {
         int yw_new=y*w;
-        int yw_old=int(y*fh)*width();
+        int yw_old=int(y*fh)*stride();
 
         for(int x=0;x<w;x++)
         {
@@ -132,244 +215,54 @@ image& image::resize_nearest(int w,int h)
     }
 #endif
 
-    image_data=std::move(mw);
-    width_=w;
-    height_=h;
+    _replace_data(std::move(mw),w,h);
     return *this;
 }
 
 image& image::resize_linear(int w,int h)
 {
-//return resize_nearest(w,h);
-    memory_wrapper mw(w*h*4);
-    if(w<1||h<1||width()<1||height()<1)
-    {
-//std::cerr<<w<<":"<<h<<" "<<width()<<":"<<height()<<std::endl;
-        __builtin_trap();
-        image_data=std::move(mw);
-        width_=w;
-        height_=h;
-        return *this;
-    }
-
-    float fw=width()/float(w);
-    float fh=height()/float(h);
-
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* data_new=mw.get();
-    uint8_t* data_old=image_data.get();
-    int count1_old=width()*height();
-    int count2_old=width()*height()*2;
-    int count3_old=width()*height()*3;
-    int count1_new=w*h;
-    int count2_new=w*h*2;
-    int count3_new=w*h*3;
-    int width_old=width();
-    int height_old=height();
-    bool width_is_1=(width_old==1);
-    bool height_is_1=(height_old==1);
-
-    for(int y=0;y<h;y++)
-    {
-        int yw_new=y*w;
-        float y_old_f=y*fh-0.5f;
-        y_old_f=y_old_f>0?y_old_f:0;
-        int y_old=y_old_f;
-        float factor_interpolate_y=y_old_f-y_old;
-        float factor_interpolate_y_neg=1.0f-factor_interpolate_y;
-        y_old=y_old>=height_old?height_old-1:y_old;
-        int yw_old=y_old*width_old;
-
-        for(int x=0;x<w;x++)
-        {
-            float x_old_f=x*fw-0.5f;
-            x_old_f=x_old_f>0?x_old_f:0;
-            int x_old=x_old_f;
-            float factor_interpolate_x=x_old_f-x_old;
-            float factor_interpolate_x_neg=1.0f-factor_interpolate_x;
-
-            x_old=x_old>=width_old?width_old-1:x_old;
-            int offset_old=yw_old+x_old;
-            int offset_new=yw_new+x;
-
-            if(!height_is_1&&!width_is_1)
-            {
-                int c00=data_old[offset_old];
-                int c10=data_old[offset_old+1];
-                int c01=data_old[offset_old+width_old];
-                int c11=data_old[offset_old+width_old+1];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                c01=c01*factor_interpolate_x_neg+c11*factor_interpolate_x;
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new]=c00;
-
-                c00=data_old[offset_old+count1_old];
-                c10=data_old[offset_old+1+count1_old];
-                c01=data_old[offset_old+width_old+count1_old];
-                c11=data_old[offset_old+width_old+1+count1_old];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                c01=c01*factor_interpolate_x_neg+c11*factor_interpolate_x;
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new+count1_new]=c00;
-
-                c00=data_old[offset_old+count2_old];
-                c10=data_old[offset_old+1+count2_old];
-                c01=data_old[offset_old+width_old+count2_old];
-                c11=data_old[offset_old+width_old+1+count2_old];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                c01=c01*factor_interpolate_x_neg+c11*factor_interpolate_x;
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new+count2_new]=c00;
-
-                c00=data_old[offset_old+count3_old];
-                c10=data_old[offset_old+1+count3_old];
-                c01=data_old[offset_old+width_old+count3_old];
-                c11=data_old[offset_old+width_old+1+count3_old];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                c01=c01*factor_interpolate_x_neg+c11*factor_interpolate_x;
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new+count3_new]=c00;
-            }
-            else if(height_is_1&&!width_is_1)
-            {
-                int c00=data_old[offset_old];
-                int c10=data_old[offset_old+1];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                data_new[offset_new]=c00;
-
-                c00=data_old[offset_old+count1_old];
-                c10=data_old[offset_old+1+count1_old];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                data_new[offset_new+count1_new]=c00;
-
-                c00=data_old[offset_old+count2_old];
-                c10=data_old[offset_old+1+count2_old];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                data_new[offset_new+count2_new]=c00;
-
-                c00=data_old[offset_old+count3_old];
-                c10=data_old[offset_old+1+count3_old];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                data_new[offset_new+count3_new]=c00;
-            }
-            else if(!height_is_1&&width_is_1)
-            {
-                int c00=data_old[offset_old];
-                int c01=data_old[offset_old+width_old];
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new]=c00;
-
-                c00=data_old[offset_old+count1_old];
-                c01=data_old[offset_old+width_old+count1_old];
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new+count1_new]=c00;
-
-                c00=data_old[offset_old+count2_old];
-                c01=data_old[offset_old+width_old+count2_old];
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new+count2_new]=c00;
-
-                c00=data_old[offset_old+count3_old];
-                c01=data_old[offset_old+width_old+count3_old];
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new+count3_new]=c00;
-            }
-            else
-            {
-                int c00=data_old[offset_old];
-                data_new[offset_new]=c00;
-
-                c00=data_old[offset_old+count1_old];
-                data_new[offset_new+count1_new]=c00;
-
-                c00=data_old[offset_old+count2_old];
-                data_new[offset_new+count2_new]=c00;
+    return *this=resized_linear(w,h);
+}
 
-                c00=data_old[offset_old+count3_old];
-                data_new[offset_new+count3_new]=c00;
-            }
-        }
-    }
-#else
-    color* data_new=(color*)mw.get();
-    color* data_old=(color*)image_data.get();
-    int width_old=width();
-    int height_old=height();
-    bool width_is_1=(width_old==1);
-    bool height_is_1=(height_old==1);
+image& image::resize_cubic(int w,int h)
+{
+    return *this=resized_cubic(w,h);
+}
 
-    for(int y=0;y<h;y++)
-    {
-        int yw_new=y*w;
-        float y_old_f=y*fh-0.5f;
-        y_old_f=y_old_f>0?y_old_f:0;
-        int y_old=y_old_f;
-        float factor_interpolate_y=y_old_f-y_old;
-        float factor_interpolate_y_neg=1.0f-factor_interpolate_y;
-        y_old=y_old>=height_old?height_old-1:y_old;
-        int yw_old=y_old*width_old;
+image& image::resize_lanczos(int w,int h)
+{
+    return *this=resized_lanczos(w,h);
+}
 
-        for(int x=0;x<w;x++)
-        {
-            float x_old_f=x*fw-0.5f;
-            x_old_f=x_old_f>0?x_old_f:0;
-            int x_old=x_old_f;
-            float factor_interpolate_x=x_old_f-x_old;
-            float factor_interpolate_x_neg=1.0f-factor_interpolate_x;
-
-            x_old=x_old>=width_old?width_old-1:x_old;
-            int offset_old=yw_old+x_old;
-            int offset_new=yw_new+x;
+image image::resized_linear(int w,int h)const
+{
+    image ret(std::max(0,w),std::max(0,h));
+    resample(*this,ret,resample_filter::linear);
+    return ret;
+}
 
-            if(!height_is_1&&!width_is_1)
-            {
-                color c00=data_old[offset_old];
-                color c10=data_old[offset_old+1];
-                color c01=data_old[offset_old+width_old];
-                color c11=data_old[offset_old+width_old+1];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                c01=c01*factor_interpolate_x_neg+c11*factor_interpolate_x;
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new]=c00;
-            }
-            else if(height_is_1&&!width_is_1)
-            {
-                color c00=data_old[offset_old];
-                color c10=data_old[offset_old+1];
-                c00=c00*factor_interpolate_x_neg+c10*factor_interpolate_x;
-                data_new[offset_new]=c00;
-            }
-            else if(!height_is_1&&width_is_1)
-            {
-                color c00=data_old[offset_old];
-                color c01=data_old[offset_old+width_old];
-                c00=c00*factor_interpolate_y_neg+c01*factor_interpolate_y;
-                data_new[offset_new]=c00;
-            }
-            else
-            {
-                color c00=data_old[offset_old];
-                data_new[offset_new]=c00;
-            }
-        }
-    }
-#endif
+image image::resized_cubic(int w,int h)const
+{
+    image ret(std::max(0,w),std::max(0,h));
+    resample(*this,ret,resample_filter::cubic);
+    return ret;
+}
 
-    image_data=std::move(mw);
-    width_=w;
-    height_=h;
-    return *this;
+image image::resized_lanczos(int w,int h)const
+{
+    image ret(std::max(0,w),std::max(0,h));
+    resample(*this,ret,resample_filter::lanczos);
+    return ret;
 }
 
 image& image::crop(int x,int y,int w,int h)
 {
+    _invalidate_opacity();
     if(w<1||h<1)
     {
         std::cerr<<"crop "<<w<<"x"<<h<<std::endl;
         throw std::logic_error("lfgui::image::crop ERROR: bad values");
-        image_data=std::move(memory_wrapper(0));
-        width_=0;
-        height_=0;
+        _replace_data(memory_wrapper(0),0,0);
         return *this;
     }
     /*if(w<1)
@@ -381,10 +274,10 @@ image& image::crop(int x,int y,int w,int h)
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
     uint8_t* data_in=image_data.get();
     uint8_t* data_out=mw.get();
-    int width_old=width();
-    int count1_old=width()*height();
-    int count2_old=width()*height()*2;
-    int count3_old=width()*height()*3;
+    int width_old=stride();
+    int count1_old=plane_stride();
+    int count2_old=plane_stride()*2;
+    int count3_old=plane_stride()*3;
     int count1_new=w*h;
     int count2_new=w*h*2;
     int count3_new=w*h*3;
@@ -404,7 +297,7 @@ image& image::crop(int x,int y,int w,int h)
 #else
     color* data_in=(color*)image_data.get();
     color* data_out=(color*)mw.get();
-    int width_old=width();
+    int width_old=stride();
 
     for(int y2=0;y2<h;y2++)
     {
@@ -415,12 +308,34 @@ image& image::crop(int x,int y,int w,int h)
     }
 #endif
 
-    image_data=std::move(mw);
-    width_=w;
-    height_=h;
+    _replace_data(std::move(mw),w,h);
     return *this;
 }
 
+image image::cropped(int x,int y,int w,int h)const
+{
+    image_view v=view(lfgui::rect(x,y,w,h));
+    if(v.empty())
+        throw std::logic_error("lfgui::image::cropped ERROR: bad values");
+    return v.copy();
+}
+
+image_view image::view(const lfgui::rect& area)const
+{
+    return image_view(*this,area);
+}
+
+image image::sub_image(const lfgui::rect& area)
+{
+    const lfgui::rect r=area.intersected(rect());
+    if(r.empty())
+        return image();
+    image ret(_pixels()+r.x+size_t(r.y)*stride(),r.width,r.height,stride(),plane_stride());
+    ret._parent=this;
+    _invalidate_opacity();
+    return ret;
+}
+
 // based on https://en.wikipedia.org/wiki/Cohen%E2%80%93Sutherland_algorithm
 namespace
 {
@@ -510,6 +425,10 @@ bool clip_line(int& x0,int& y0,int& x1,int& y1,int max_x,int max_y)
 // found at http://members.chello.at/~easyfilter/bresenham.html
 void image::draw_line(int x0,int y0,int x1,int y1,color c)
 {
+    _count_draw(std::min(x0,x1),std::min(y0,y1),abs(x1-x0)+1,abs(y1-y0)+1);
+    if(_recording)
+        return _record([=](image& i){i.draw_line(x0,y0,x1,y1,c);});
+    _invalidate_opacity();
     if(clip_line(x0,y0,x1,y1,width()-1,height()-1))
         return;
 
@@ -521,7 +440,7 @@ void image::draw_line(int x0,int y0,int x1,int y1,color c)
 
     for(;;)
     {
-        blend_pixel(x0,y0,c);
+        _blend_pixel(x0,y0,c);
         if(x0==x1&&y0==y1)
             break;
         e2=2*err;
@@ -538,154 +457,190 @@ void image::draw_line(int x0,int y0,int x1,int y1,color c)
     }
 }
 
-// based on http://stackoverflow.com/questions/849211/shortest-distance-between-a-point-and-a-line-segment
-inline float distance_point_line(int point_x,int point_y,int line_x0,int line_y0,int line_x1,int line_y1)
+void image::draw_line(int x0,int y0,int x1,int y1,color c,float w,float fading_start)
 {
-    int A=point_x-line_x0;
-    int B=point_y-line_y0;
-    int C=line_x1-line_x0;
-    int D=line_y1-line_y0;
-
-    int dot=A*C+B*D;
-    float len_sq=C*C+D*D;
-    float param=-1;
-    if(len_sq!=0) //in case of 0 length line
-        param=dot/len_sq;
-
-    int xx,yy;
-
-    if(param<0)
-    {
-        xx=line_x0;
-        yy=line_y0;
-    }
-    else if(param>1)
-    {
-        xx=line_x1;
-        yy=line_y1;
-    }
-    else
+    int border=int(w)+1;
+    _count_draw(std::min(x0,x1)-border,std::min(y0,y1)-border,abs(x1-x0)+1+border*2,abs(y1-y0)+1+border*2);
+    if(c.a==0||!(w>0))
+        return;
+    if(_recording)
+        return _record([=](image& i){i.draw_line(x0,y0,x1,y1,c,w,fading_start);});
+
+    // The alpha falls linearly from 1 to 0 over fade pixels around the distance w/2 from the line, which keeps the
+    // fading of the old per pixel version and antialiases lines without fading.
+    const float fade=std::max(1.f,w*(1-fading_start));
+    const float radius=(w+fade)/2;  // no pixel further away from the line is touched
+    const float dx=x1-x0;
+    const float dy=y1-y0;
+    const float length=std::sqrt(dx*dx+dy*dy);
+    const float ux=length>0?dx/length:1;
+    const float uy=length>0?dy/length:0;
+
+    const int top=std::max(0,int(std::floor(std::min(y0,y1)-radius)));
+    const int bottom=std::min(height()-1,int(std::ceil(std::max(y0,y1)+radius)));
+    static thread_local std::vector<uint8_t> coverage;
+    coverage.resize(width());
+    for(int y=top;y<=bottom;y++)
     {
-        xx=line_x0+param*C;
-        yy=line_y0+param*D;
+        // the columns where this row crosses the round capped band around the line: the circles around the end
+        // points and the part of the band between them
+        const float ry=y-y0;
+        float left=INFINITY;
+        float right=-INFINITY;
+        for(int end=0;end<2;end++)
+        {
+            const float cx=end?x1:x0;
+            const float cy=(end?y1:y0)-y;
+            const float h=radius*radius-cy*cy;
+            if(h>0)
+            {
+                left=std::min(left,cx-std::sqrt(h));
+                right=std::max(right,cx+std::sqrt(h));
+            }
+        }
+        // perpendicular distance and position along the line are linear in x: offset+slope*(x-x0)
+        float band_left=-INFINITY;
+        float band_right=INFINITY;
+        auto limit=[&](float slope,float offset,float min,float max)
+        {
+            if(slope==0)
+            {
+                if(offset<min||offset>max)
+                    band_left=INFINITY;
+                return;
+            }
+            float a=(min-offset)/slope;
+            float b=(max-offset)/slope;
+            if(a>b)
+                std::swap(a,b);
+            band_left=std::max(band_left,a);
+            band_right=std::min(band_right,b);
+        };
+        limit(uy,-ry*ux,-radius,radius);
+        limit(ux,ry*uy,0,length);
+        if(band_left<band_right)
+        {
+            left=std::min(left,x0+band_left);
+            right=std::max(right,x0+band_right);
+        }
+        if(left>right)      // missed both caps and the band, left and right are still infinite
+            continue;
+
+        const int start=std::max(0,int(std::floor(left)));
+        const int end=std::min(width()-1,int(std::ceil(right)));
+        if(start>end)
+            continue;
+        float perpendicular=(start-x0)*uy-ry*ux;
+        float along=(start-x0)*ux+ry*uy;
+        for(int x=start;x<=end;x++)
+        {
+            // the distance to the line, only the round caps need a square root
+            float d=std::abs(perpendicular);
+            if(along<0)
+                d=std::sqrt(perpendicular*perpendicular+along*along);
+            else if(along>length)
+                d=std::sqrt(perpendicular*perpendicular+(along-length)*(along-length));
+            const float a=std::min(1.f,std::max(0.f,(w/2-d)/fade+0.5f));
+            coverage[x-start]=uint8_t(a*255+0.5f);
+            perpendicular+=uy;
+            along+=ux;
+        }
+        blend_span(start,y,end-start+1,c,coverage.data());
     }
-
-    int dx=point_x-xx;
-    int dy=point_y-yy;
-    return std::sqrt(dx*dx+dy*dy);
 }
 
-void image::draw_line(int x0,int y0,int x1,int y1,color c,float w,float fading_start)
+// based on https://en.wikipedia.org/wiki/Xiaolin_Wu%27s_line_algorithm
+void image::draw_line_antialiased(point_float a,point_float b,color c)
 {
-    if(clip_line(x0,y0,x1,y1,width()-1,height()-1))
+    _count_draw(int(std::floor(std::min(a.x,b.x)))-1,int(std::floor(std::min(a.y,b.y)))-1,
+                int(std::abs(b.x-a.x))+3,int(std::abs(b.y-a.y))+3);
+    if(_recording)
+        return _record([=](image& i){i.draw_line_antialiased(a,b,c);});
+    _invalidate_opacity();
+    if(c.a==0)
         return;
-
-    int dx=x1-x0;
-    int dy=y1-y0;
-    if(dx==0&&dy==0)
+    // pixel centers are at whole numbers in here
+    float x0=a.x-0.5f;
+    float y0=a.y-0.5f;
+    float x1=b.x-0.5f;
+    float y1=b.y-0.5f;
+    const bool steep=std::abs(y1-y0)>std::abs(x1-x0);
+    if(steep)
     {
-        blend_pixel_safe(x0,y0,c);
-        return;
+        std::swap(x0,y0);
+        std::swap(x1,y1);
     }
-
-    // calculate a polygon that is the outer shape of our line. Like a bounding box, but not axis aligned.
-    std::vector<point> polygon;
+    if(x0>x1)
     {
-        float d=sqrt(dx*dx+dy*dy);
-        float rx=dx/d;
-        float ry=dy/d;
-        rx*=w;
-        ry*=w;
-
-        polygon.emplace_back(x0+ry-rx,y0-rx-ry);
-        polygon.emplace_back(x1+ry+rx,y1-rx+ry);
-        polygon.emplace_back(x1-ry+rx,y1+rx+ry);
-        polygon.emplace_back(x0-ry-rx,y0+rx-ry);
+        std::swap(x0,x1);
+        std::swap(y0,y1);
     }
+    const float gradient=x1>x0?(y1-y0)/(x1-x0):0;
 
-    // draw the actual line
+    auto plot=[&](int x,int y,float coverage)
     {
-        std::vector<int> edges;
-        edges.resize(height());
-        int image_width=width();
-        int image_height=height();
-
-        int pixelX,pixelY,i,j,swap,node_count;
-
-        //  Loop through the rows of the image.
-        for(pixelY=0;pixelY<image_height;pixelY++)
-        {
-            //  Build a list of nodes.
-            edges.resize(0);
-            j=4-1;
-            for(i=0;i<4;i++)
-            {
-                if((polygon[i].y<(double)pixelY&&polygon[j].y>=(double)pixelY)
-                 ||(polygon[j].y<(double)pixelY&&polygon[i].y>=(double)pixelY))
-                    edges.push_back((polygon[i].x+(pixelY-polygon[i].y)/double(polygon[j].y-polygon[i].y)*(polygon[j].x-polygon[i].x)));
-                j=i;
-            }
-            node_count=edges.size();
-
-            //  Sort the nodes, via a simple "Bubble" sort.
-            i=0;
-            while(i<node_count-1)
-            {
-                if(edges[i]>edges[i+1])
-                {
-                    swap=edges[i];
-                    edges[i]=edges[i+1];
-                    edges[i+1]=swap;
-                    if(i)
-                        i--;
-                }
-                else
-                    i++;
-            }
+        if(steep)
+            std::swap(x,y);
+        if(x>=0&&y>=0&&x<width()&&y<height())
+            _blend_pixel(x,y,c.alpha_multiplied(int(coverage*255+0.5f)));
+    };
+    auto fraction=[](float v){return v-std::floor(v);};
+
+    // the end points are weighted by how much of their pixel column the line covers
+    const int first=int(std::floor(x0+0.5f));
+    float y=y0+gradient*(first-x0);
+    float gap=1-fraction(x0+0.5f);
+    plot(first,int(std::floor(y)),(1-fraction(y))*gap);
+    plot(first,int(std::floor(y))+1,fraction(y)*gap);
+    const float first_y=y;
+
+    const int last=int(std::floor(x1+0.5f));
+    y=y1+gradient*(last-x1);
+    gap=fraction(x1+0.5f);
+    if(last!=first)
+    {
+        plot(last,int(std::floor(y)),(1-fraction(y))*gap);
+        plot(last,int(std::floor(y))+1,fraction(y)*gap);
+    }
 
-            //  Fill the pixels between node pairs.
-            for(i=0;i<node_count;i+=2)
-            {
-                if(edges[i  ]>=image_width)
-                    break;
-                if(edges[i+1]> 0 )
-                {
-                    if(edges[i  ]<0 )
-                        edges[i  ]=0 ;
-                    if(edges[i+1]>image_width)
-                        edges[i+1]=image_width;
-
-                    for(pixelX=edges[i];pixelX<edges[i+1];pixelX++)
-                    {
-                        float s=distance_point_line(pixelX,pixelY,x0,y0,x1,y1)/w;
-                        s-=fading_start/2;
-                        if(s>0)
-                            s/=(1.0f-fading_start);
-                        int si=s*255;
-                        si=std::min(255,si);
-                        si=std::max(0,si);
-                        si=255-si;
-                        blend_pixel(pixelX,pixelY,c.alpha_multiplied(si));
-                    }
-                }
-            }
-        }
+    // the pixels in between, only those inside the image
+    const int start=std::max(first+1,0);
+    const int end=std::min(last-1,(steep?height():width())-1);
+    y=first_y+gradient*(start-first);
+    for(int x=start;x<=end;x++)
+    {
+        const int iy=int(std::floor(y));
+        const float f=y-iy;
+        plot(x,iy,1-f);
+        plot(x,iy+1,f);
+        y+=gradient;
     }
 }
 
 void image::draw_rect(int x,int y,int width,int height,color color_foreground)
 {
+    _count_draw(x,y,width,height);
+    if(_recording)
+        return _record([=](image& i){i.draw_rect(x,y,width,height,color_foreground);});
+    _fill_rect(x,y,width,height,color_foreground);
+}
+
+void image::_fill_rect(int x,int y,int width,int height,color color_foreground)
+{
+    _invalidate_opacity();
     lfgui::rect r=rect();
     int x_start=std::max(x,r.left());
     int y_start=std::max(y,r.top());
     int x_end=std::min(x+width,r.right());
     int y_end=std::min(y+height,r.bottom());
-    int w=this->width();
+    if(x_start>=x_end||y_start>=y_end)
+        return;
+    int w=stride();
     int i;
 
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* d=data();
-    int c=count();
+    uint8_t* d=_pixels();
+    int c=plane_stride();
     if(color_foreground.a==255)
     {
         for(y=y_start;y<y_end;y++)
@@ -702,16 +657,18 @@ void image::draw_rect(int x,int y,int width,int height,color color_foreground)
         for(y=y_start;y<y_end;y++)
         {
             x=x_start;
-#ifdef __SSE2__
+#ifdef LFGUI_SSE2
             __m128i v0=_mm_set1_epi32(0);
             __m128i v255=_mm_set1_epi16(255);
             __m128i v257=_mm_set1_epi16(257);
+#ifndef LFGUI_PREMULTIPLIED_ALPHA
             __m128i cfga=_mm_set1_epi8(color_foreground.a);
+#endif
             __m128i cfga_1=_mm_set1_epi16(color_foreground.a);
             __m128i cfga_1_neg=_mm_sub_epi16(v255,cfga_1);
-            for(;x<((x_end-x_start)/16*16);x+=16)
+            for(;x+16<=x_end;x+=16)
             {
-                uint8_t* d=data();
+                uint8_t* d=_pixels();
                 i=y*w+x;
 
                 __m128i cfg_1=_mm_set1_epi16(color_foreground.b);
@@ -759,11 +716,26 @@ void image::draw_rect(int x,int y,int width,int height,color color_foreground)
                 _mm_storeu_si128((__m128i*)(d+i),cbg_1);
 
                 i+=c;
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+                // the alpha is blended like the colors: a+d*(1-a)
+                cfg_1=_mm_mullo_epi16(v255,cfga_1);
+                cbg=_mm_loadu_si128((const __m128i*)(d+i));
+                cbg_1=_mm_unpacklo_epi8(cbg,v0);
+                cbg_2=_mm_unpackhi_epi8(cbg,v0);
+                cbg_1=_mm_mullo_epi16(cbg_1,cfga_1_neg);
+                cbg_2=_mm_mullo_epi16(cbg_2,cfga_1_neg);
+                cbg_1=_mm_adds_epu16(cbg_1,cfg_1);
+                cbg_2=_mm_adds_epu16(cbg_2,cfg_1);
+                cbg_1=_mm_mulhi_epu16(cbg_1,v257);
+                cbg_2=_mm_mulhi_epu16(cbg_2,v257);
+                cbg_1=_mm_packus_epi16(cbg_1,cbg_2);
+#else
                 cbg=_mm_loadu_si128((const __m128i*)(d+i));
                 cbg_1=_mm_unpacklo_epi8(cbg,v0);
                 cbg_2=_mm_unpackhi_epi8(cbg,v0);
                 cbg_1=_mm_packus_epi16(cbg_1,cbg_2);
                 cbg_1=_mm_adds_epu8(cbg_1,cfga);
+#endif
                 _mm_storeu_si128((__m128i*)(d+i),cbg_1);
             }
 #endif
@@ -776,8 +748,12 @@ void image::draw_rect(int x,int y,int width,int height,color color_foreground)
                 i+=c;
                 d[i]=(d[i]*(255-color_foreground.a)+color_foreground.r*color_foreground.a)*257>>16;
                 i+=c;
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+                d[i]=(d[i]*(255-color_foreground.a)+255*color_foreground.a)*257>>16;
+#else
                 auto a=d[i]+color_foreground.a;
                 d[i]=a>255?255:a;
+#endif
             }
         }
     }
@@ -794,24 +770,208 @@ void image::draw_rect(int x,int y,int width,int height,color color_foreground)
     }
     else
     {
+#ifdef LFGUI_SSE2
+        const __m128i v0=_mm_setzero_si128();
+        const __m128i v257=_mm_set1_epi16(257);
+        const __m128i a=_mm_set1_epi16(color_foreground.a);
+        const __m128i a_neg=_mm_set1_epi16(255-color_foreground.a);
+        // the color times its alpha as 16 bit values, two pixels. The alpha channel is handled like a color with the
+        // value 255 and replaced afterwards if the alpha is straight.
+        const color opaque(color_foreground.r,color_foreground.g,color_foreground.b,255);
+        const __m128i s=_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(opaque.value),v0),a);
+#ifndef LFGUI_PREMULTIPLIED_ALPHA
+        const __m128i alpha_mask=_mm_set1_epi32(0xFF000000);
+        const __m128i alpha=_mm_and_si128(_mm_set1_epi8(color_foreground.a),alpha_mask);
+#endif
+#endif
         for(y=y_start;y<y_end;y++)
         {
             x=x_start;
-            // TODO: add SSE2
+#ifdef LFGUI_SSE2
+            for(;x+4<=x_end;x+=4)
+            {
+                i=y*w+x;
+                __m128i dst=_mm_loadu_si128((const __m128i*)(d+i));
+                __m128i d_1=_mm_adds_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst,v0),a_neg),s);
+                __m128i d_2=_mm_adds_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst,v0),a_neg),s);
+                __m128i result=_mm_packus_epi16(_mm_mulhi_epu16(d_1,v257),_mm_mulhi_epu16(d_2,v257));
+#ifndef LFGUI_PREMULTIPLIED_ALPHA
+                result=_mm_or_si128(_mm_andnot_si128(alpha_mask,result),
+                                    _mm_and_si128(_mm_adds_epu8(dst,alpha),alpha_mask));
+#endif
+                _mm_storeu_si128((__m128i*)(d+i),result);
+            }
+#endif
             for(;x<x_end;x++)
             {
                 i=y*w+x;
                 d[i].r=(d[i].r*(255-color_foreground.a)+color_foreground.r*color_foreground.a)*257>>16;
                 d[i].g=(d[i].g*(255-color_foreground.a)+color_foreground.g*color_foreground.a)*257>>16;
                 d[i].b=(d[i].b*(255-color_foreground.a)+color_foreground.b*color_foreground.a)*257>>16;
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+                d[i].a=(d[i].a*(255-color_foreground.a)+255*color_foreground.a)*257>>16;
+#else
                 auto a=d[i].a+color_foreground.a;
                 d[i].a=a>255?255:a;
+#endif
             }
         }
     }
 #endif
 }
 
+void image::blend_span(int x,int y,int length,color c,const uint8_t* coverage)
+{
+    if(y<0||y>=height()||c.a==0)
+        return;
+    if(_recording)
+    {
+        const std::vector<uint8_t> copied(coverage,coverage+(coverage?std::max(0,length):0));
+        return _record([=](image& i){i.blend_span(x,y,length,c,copied.empty()?nullptr:copied.data());});
+    }
+    if(!coverage)
+    {
+        _fill_rect(x,y,length,1,c);
+        return;
+    }
+    if(x<0)
+    {
+        coverage-=x;
+        length+=x;
+        x=0;
+    }
+    length=std::min(length,width()-x);
+    if(length<=0)
+        return;
+
+    // The alpha of a pixel is c.a*coverage/255. Each channel becomes (d*(255-a)+s*a+255)/65536*257, which is exact
+    // for a=0 and a=255. With straight alpha the alpha channel is saturated, with premultiplied alpha it is blended
+    // like the colors with a source of 255.
+    const int ca=c.a;
+    int i=0;
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    uint8_t* d=data()+size_t(y)*stride()+x;
+    const size_t plane=plane_stride();
+#ifdef LFGUI_SSE2
+    const __m128i v0=_mm_setzero_si128();
+    const __m128i v128=_mm_set1_epi16(128);
+    const __m128i v255=_mm_set1_epi16(255);
+    const __m128i v257=_mm_set1_epi16(257);
+    const __m128i vca=_mm_set1_epi16(ca);
+    const uint8_t channels[4]={c.b,c.g,c.r,255};
+    for(;i+16<=length;i+=16)
+    {
+        __m128i cov=_mm_loadu_si128((const __m128i*)(coverage+i));
+        const int mask=_mm_movemask_epi8(_mm_cmpeq_epi8(cov,v0));
+        if(mask==0xFFFF)
+            continue;
+        __m128i a_1=_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(cov,v0),vca),v128);
+        __m128i a_2=_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(cov,v0),vca),v128);
+        a_1=_mm_srli_epi16(_mm_add_epi16(a_1,_mm_srli_epi16(a_1,8)),8);
+        a_2=_mm_srli_epi16(_mm_add_epi16(a_2,_mm_srli_epi16(a_2,8)),8);
+        const __m128i a_neg_1=_mm_sub_epi16(v255,a_1);
+        const __m128i a_neg_2=_mm_sub_epi16(v255,a_2);
+        for(int p=0;p<4;p++)
+        {
+            uint8_t* dp=d+p*plane+i;
+            __m128i dst=_mm_loadu_si128((const __m128i*)dp);
+#ifndef LFGUI_PREMULTIPLIED_ALPHA
+            if(p==3)
+            {
+                _mm_storeu_si128((__m128i*)dp,_mm_adds_epu8(dst,_mm_packus_epi16(a_1,a_2)));
+                break;
+            }
+#endif
+            const __m128i s=_mm_set1_epi16(channels[p]);
+            __m128i d_1=_mm_mullo_epi16(_mm_unpacklo_epi8(dst,v0),a_neg_1);
+            __m128i d_2=_mm_mullo_epi16(_mm_unpackhi_epi8(dst,v0),a_neg_2);
+            d_1=_mm_add_epi16(_mm_add_epi16(d_1,_mm_mullo_epi16(s,a_1)),v255);
+            d_2=_mm_add_epi16(_mm_add_epi16(d_2,_mm_mullo_epi16(s,a_2)),v255);
+            d_1=_mm_mulhi_epu16(d_1,v257);
+            d_2=_mm_mulhi_epu16(d_2,v257);
+            _mm_storeu_si128((__m128i*)dp,_mm_packus_epi16(d_1,d_2));
+        }
+    }
+#endif
+    for(;i<length;i++)
+    {
+        if(!coverage[i])
+            continue;
+        int a=ca*coverage[i]+128;
+        a=(a+(a>>8))>>8;
+        uint8_t* dp=d+i;
+        dp[0]=(dp[0]*(255-a)+c.b*a+255)*257>>16;
+        dp[plane]=(dp[plane]*(255-a)+c.g*a+255)*257>>16;
+        dp[plane*2]=(dp[plane*2]*(255-a)+c.r*a+255)*257>>16;
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        dp[plane*3]=(dp[plane*3]*(255-a)+255*a+255)*257>>16;
+#else
+        dp[plane*3]=std::min(255,dp[plane*3]+a);
+#endif
+    }
+#else
+    color* d=(color*)data()+size_t(y)*stride()+x;
+#ifdef LFGUI_SSE2
+    const __m128i v0=_mm_setzero_si128();
+    const __m128i v128=_mm_set1_epi16(128);
+    const __m128i v255=_mm_set1_epi16(255);
+    const __m128i v257=_mm_set1_epi16(257);
+    const __m128i vca=_mm_set1_epi16(ca);
+    // the color with an alpha of 255 as 16 bit values, two pixels
+    const __m128i s=_mm_unpacklo_epi8(_mm_set1_epi32(color(c.r,c.g,c.b,255).value),v0);
+    const __m128i opaque=_mm_set1_epi32(c.value);
+    for(;i+4<=length;i+=4)
+    {
+        uint32_t cov4;
+        memcpy(&cov4,coverage+i,4);
+        if(!cov4)
+            continue;
+        if(cov4==0xFFFFFFFF&&ca==255)
+        {
+            _mm_storeu_si128((__m128i*)(d+i),opaque);
+            continue;
+        }
+        __m128i a=_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(cov4)),v0);
+        a=_mm_add_epi16(_mm_mullo_epi16(a,vca),v128);
+        a=_mm_srli_epi16(_mm_add_epi16(a,_mm_srli_epi16(a,8)),8);
+        a=_mm_unpacklo_epi16(a,a);
+        const __m128i a_1=_mm_unpacklo_epi32(a,a);  // the alpha of pixel 0 and 1 in all four channels
+        const __m128i a_2=_mm_unpackhi_epi32(a,a);
+        __m128i dst=_mm_loadu_si128((const __m128i*)(d+i));
+        __m128i d_1=_mm_mullo_epi16(_mm_unpacklo_epi8(dst,v0),_mm_sub_epi16(v255,a_1));
+        __m128i d_2=_mm_mullo_epi16(_mm_unpackhi_epi8(dst,v0),_mm_sub_epi16(v255,a_2));
+        d_1=_mm_add_epi16(_mm_add_epi16(d_1,_mm_mullo_epi16(s,a_1)),v255);
+        d_2=_mm_add_epi16(_mm_add_epi16(d_2,_mm_mullo_epi16(s,a_2)),v255);
+        d_1=_mm_mulhi_epu16(d_1,v257);
+        d_2=_mm_mulhi_epu16(d_2,v257);
+        __m128i result=_mm_packus_epi16(d_1,d_2);
+#ifndef LFGUI_PREMULTIPLIED_ALPHA
+        const __m128i alpha_mask=_mm_set1_epi32(0xFF000000);
+        const __m128i alpha=_mm_adds_epu8(dst,_mm_and_si128(_mm_packus_epi16(a_1,a_2),alpha_mask));
+        result=_mm_or_si128(_mm_andnot_si128(alpha_mask,result),_mm_and_si128(alpha_mask,alpha));
+#endif
+        _mm_storeu_si128((__m128i*)(d+i),result);
+    }
+#endif
+    for(;i<length;i++)
+    {
+        if(!coverage[i])
+            continue;
+        int a=ca*coverage[i]+128;
+        a=(a+(a>>8))>>8;
+        color& dp=d[i];
+        dp.r=(dp.r*(255-a)+c.r*a+255)*257>>16;
+        dp.g=(dp.g*(255-a)+c.g*a+255)*257>>16;
+        dp.b=(dp.b*(255-a)+c.b*a+255)*257>>16;
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        dp.a=(dp.a*(255-a)+255*a+255)*257>>16;
+#else
+        dp.a=std::min(255,dp.a+a);
+#endif
+    }
+#endif
+}
+
 inline void print(__m128i v)
 {
     static char hex[]="0123456789ABCDEF";
@@ -844,313 +1004,483 @@ inline void print(__m128i v)
     std::cout<<" "<<vec[0]<<','<<vec[1]<<','<<vec[2]<<','<<vec[3]<<std::endl;
 }
 
-// based on http://alienryderflex.com/polygon_fill/
-void image::draw_polygon(const std::vector<point>& vec,color c)
+void image::draw_polygon(const std::vector<point>& vec,color c,bool antialiased,fill_rule rule)
 {
-    int vec_size=vec.size();
-    std::vector<int> edges;
-    edges.resize(height());
-    int image_width=width();
-    int image_height=height();
+    if(_recording)
+    {
+        _count_draw(0,0,0,0);
+        return _record([=](image& i){i.draw_polygon(vec,c,antialiased,rule);});
+    }
+    static thread_local rasterizer r;
+    r.clear();
+    r.add_polygon(vec);
+    if(statistics&&!r.empty())
+    {
+        lfgui::rect bounds=r.bounds();
+        _count_draw(bounds.x,bounds.y,bounds.width,bounds.height);
+    }
+    r.fill(*this,c,rule,antialiased);
+}
 
-    int pixelX,pixelY,i,j,swap,node_count;
+namespace
+{
 
-    //  Loop through the rows of the image.
-    for(pixelY=0;pixelY<image_height;pixelY++)
+/// \brief Blends length pixels of img starting at pixel img_index over target_image starting at target_index.
+void blend_image_row(image& target_image,int target_index,const image_view& img,int img_index,int length)
+{
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    uint8_t* d=target_image.data()+target_index;
+    const uint8_t* img_d=img.data();
+    int count1=target_image.plane_stride();
+    int count2=target_image.plane_stride()*2;
+    int count3=target_image.plane_stride()*3;
+    int img_count1=img.plane_stride();
+    int img_count2=img.plane_stride()*2;
+    int img_count3=img.plane_stride()*3;
+    int index=0;
+    int index_end=length;
+
+#ifdef LFGUI_SSE2
+    __m128i v0=_mm_set1_epi32(0);
+    __m128i vmax=_mm_set1_epi8(255);
+    __m128i v255=_mm_set1_epi16(255);
+    __m128i v32897=_mm_set1_epi16(32897);
+    for(;index<index_end/16*16;index+=16,img_index+=16)
     {
-        //  Build a list of nodes.
-        edges.resize(0);
-        j=vec_size-1;
-        for(i=0;i<vec_size;i++)
+        __m128i input2_a=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count3));
+        __m128i input2_b;
+
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(input2_a,v0))==0xFFFF)      // all alpha 0?
         {
-            if((vec[i].y<(double)pixelY&&vec[j].y>=(double)pixelY)
-             ||(vec[j].y<(double)pixelY&&vec[i].y>=(double)pixelY))
-                edges.push_back((vec[i].x+(pixelY-vec[i].y)/double(vec[j].y-vec[i].y)*(vec[j].x-vec[i].x)));
-            j=i;
+            continue;
         }
-        node_count=edges.size();
-
-        //  Sort the nodes, via a simple "Bubble" sort.
-        i=0;
-        while(i<node_count-1)
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(input2_a,vmax))==0xFFFF)    // all alpha 1?
         {
-            if(edges[i]>edges[i+1])
-            {
-                swap=edges[i];
-                edges[i]=edges[i+1];
-                edges[i+1]=swap;
-                if(i)
-                    i--;
-            }
-            else
-                i++;
+            input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index           ));
+            _mm_storeu_si128((__m128i*)(d+index       ),input2_b);
+            input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count1));
+            _mm_storeu_si128((__m128i*)(d+index+count1),input2_b);
+            input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count2));
+            _mm_storeu_si128((__m128i*)(d+index+count2),input2_b);
+            _mm_storeu_si128((__m128i*)(d+index+count3),input2_a);
+            continue;
         }
 
-        //  Fill the pixels between node pairs.
-        for(i=0;i<node_count;i+=2)
+        __m128i input2_a_1=_mm_unpacklo_epi8(input2_a,v0);
+        __m128i input2_a_2=_mm_unpackhi_epi8(input2_a,v0);
+        __m128i input2_a_1_neg=_mm_sub_epi8(v255,input2_a_1);
+        __m128i input2_a_2_neg=_mm_sub_epi8(v255,input2_a_2);
+
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        for(int channel=0;channel<4;channel++)
         {
-            if(edges[i  ]>=image_width)
-                break;
-            if(edges[i+1]> 0 )
-            {
-                if(edges[i  ]<0 )
-                    edges[i  ]=0 ;
-                if(edges[i+1]>image_width)
-                    edges[i+1]=image_width;
-                for(pixelX=edges[i];pixelX<edges[i+1];pixelX++)
-                    blend_pixel(pixelX,pixelY,c);
-            }
+            uint8_t* target=d+index+channel*count1;
+            __m128i source=_mm_loadu_si128((const __m128i*)(img_d+img_index+channel*img_count1));
+            __m128i dest=_mm_loadu_si128((const __m128i*)target);
+            _mm_storeu_si128((__m128i*)target,blend_premultiplied(dest,source,input2_a_1_neg,input2_a_2_neg));
         }
-    }
-}
+        continue;
+#endif
 
-void image::draw_image(int x,int y,const image& img,lfgui::rect area)
-{
-    if(x>=width()||y>=height())
-        return;
-    if(area.width==0)
-        area.width=img.width()-area.left();
-    if(area.height==0)
-        area.height=img.height()-area.top();
-    int img_offset_x=area.x;
-    int img_offset_y=area.y;
-    area.x=x;
-    area.y=y;
-    int start_x=x;
-    int start_y=y;
-    int end_x=area.right();
-    int end_y=area.bottom();
+        __m128i input1_b;
+        __m128i input1_1;
+        __m128i input1_2;
+        __m128i input2_1;
+        __m128i input2_2;
 
-    if(end_x>=width())
-        end_x=width();
-    if(end_y>=height())
-        end_y=height();
+        input1_b=_mm_loadu_si128((const __m128i*)(d+index));
+        input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index));
 
-    if(start_x<0)
-    {
-        img_offset_x-=start_x;
-        start_x=0;
-    }
-    if(start_y<0)
-    {
-        img_offset_y-=start_y;
-        start_y=0;
-    }
-    if(end_x<0||end_y<0)
-        return;
+        input1_1=_mm_unpacklo_epi8(input1_b,v0);
+        input1_2=_mm_unpackhi_epi8(input1_b,v0);
 
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* d=data();
-    uint8_t* img_d=img.data();
-    int count1=width()*height();
-    int count2=width()*height()*2;
-    int count3=width()*height()*3;
-    int img_count1=img.width()*img.height();
-    int img_count2=img.width()*img.height()*2;
-    int img_count3=img.width()*img.height()*3;
-    int target_y=start_y;
-    int img_y=img_offset_y;
+        input2_1=_mm_unpacklo_epi8(input2_b,v0);
+        input2_2=_mm_unpackhi_epi8(input2_b,v0);
 
-    for(;target_y<end_y;target_y++,img_y++)
-    {
-        int target_x=start_x;
-        int img_x=img_offset_x;
+        input1_1=_mm_mullo_epi16(input1_1,input2_a_1_neg);
+        input1_2=_mm_mullo_epi16(input1_2,input2_a_2_neg);
 
-        uint8_t* d=data()+target_x+target_y*width();
-        int index=0;
-        int index_end=end_x-start_x;
-        int img_index=img_x+img_y*img.width();
+        input2_1=_mm_mullo_epi16(input2_1,input2_a_1);
+        input2_2=_mm_mullo_epi16(input2_2,input2_a_2);
 
-#ifdef __SSE2__
-        __m128i v0=_mm_set1_epi32(0);
-        __m128i vmax=_mm_set1_epi8(255);
-        __m128i v255=_mm_set1_epi16(255);
-        __m128i v32897=_mm_set1_epi16(32897);
-        for(;index<index_end/16*16;index+=16,img_index+=16)
-        {
-            __m128i input2_a=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count3));
-            __m128i input2_b;
+        input1_1=_mm_adds_epu16(input1_1,input2_1);
+        input1_2=_mm_adds_epu16(input1_2,input2_2);
 
-            if(_mm_test_all_zeros(input2_a,vmax))    // all alpha 0?
-            {
-                continue;
-            }
-            if(_mm_test_all_ones(input2_a))    // all alpha 1?
-            {
-                input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index           ));
-                _mm_storeu_si128((__m128i*)(d+index       ),input2_b);
-                input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count1));
-                _mm_storeu_si128((__m128i*)(d+index+count1),input2_b);
-                input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count2));
-                _mm_storeu_si128((__m128i*)(d+index+count2),input2_b);
-                _mm_storeu_si128((__m128i*)(d+index+count3),input2_a);
-                continue;
-            }
+        //input1_1=_mm_mulhi_epu16(input1_1,v257);
+        //input1_2=_mm_mulhi_epu16(input1_2,v257);
+        input1_1=_mm_mulhi_epu16(input1_1,v32897);
+        input1_2=_mm_mulhi_epu16(input1_2,v32897);
+        input1_1=_mm_srli_epi16(input1_1,7);
+        input1_2=_mm_srli_epi16(input1_2,7);
 
-            __m128i input2_a_1=_mm_unpacklo_epi8(input2_a,v0);
-            __m128i input2_a_2=_mm_unpackhi_epi8(input2_a,v0);
-            __m128i input2_a_1_neg=_mm_sub_epi8(v255,input2_a_1);
-            __m128i input2_a_2_neg=_mm_sub_epi8(v255,input2_a_2);
+        input1_b=_mm_packus_epi16(input1_1,input1_2);
 
-            __m128i input1_b;
-            __m128i input1_1;
-            __m128i input1_2;
-            __m128i input2_1;
-            __m128i input2_2;
+        _mm_storeu_si128((__m128i*)(d+index),input1_b);
 
-            input1_b=_mm_loadu_si128((const __m128i*)(d+index));
-            input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index));
+        input1_b=_mm_loadu_si128((const __m128i*)(d+index+count1));
+        input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count1));
 
-            input1_1=_mm_unpacklo_epi8(input1_b,v0);
-            input1_2=_mm_unpackhi_epi8(input1_b,v0);
+        input1_1=_mm_unpacklo_epi8(input1_b,v0);
+        input1_2=_mm_unpackhi_epi8(input1_b,v0);
 
-            input2_1=_mm_unpacklo_epi8(input2_b,v0);
-            input2_2=_mm_unpackhi_epi8(input2_b,v0);
+        input2_1=_mm_unpacklo_epi8(input2_b,v0);
+        input2_2=_mm_unpackhi_epi8(input2_b,v0);
 
-            input1_1=_mm_mullo_epi16(input1_1,input2_a_1_neg);
-            input1_2=_mm_mullo_epi16(input1_2,input2_a_2_neg);
+        input1_1=_mm_mullo_epi16(input1_1,input2_a_1_neg);
+        input1_2=_mm_mullo_epi16(input1_2,input2_a_2_neg);
 
-            input2_1=_mm_mullo_epi16(input2_1,input2_a_1);
-            input2_2=_mm_mullo_epi16(input2_2,input2_a_2);
+        input2_1=_mm_mullo_epi16(input2_1,input2_a_1);
+        input2_2=_mm_mullo_epi16(input2_2,input2_a_2);
 
-            input1_1=_mm_adds_epu16(input1_1,input2_1);
-            input1_2=_mm_adds_epu16(input1_2,input2_2);
+        input1_1=_mm_adds_epu16(input1_1,input2_1);
+        input1_2=_mm_adds_epu16(input1_2,input2_2);
 
-            //input1_1=_mm_mulhi_epu16(input1_1,v257);
-            //input1_2=_mm_mulhi_epu16(input1_2,v257);
-            input1_1=_mm_mulhi_epu16(input1_1,v32897);
-            input1_2=_mm_mulhi_epu16(input1_2,v32897);
-            input1_1=_mm_srli_epi16(input1_1,7);
-            input1_2=_mm_srli_epi16(input1_2,7);
+        //input1_1=_mm_mulhi_epu16(input1_1,v257);
+        //input1_2=_mm_mulhi_epu16(input1_2,v257);
+        input1_1=_mm_mulhi_epu16(input1_1,v32897);
+        input1_2=_mm_mulhi_epu16(input1_2,v32897);
+        input1_1=_mm_srli_epi16(input1_1,7);
+        input1_2=_mm_srli_epi16(input1_2,7);
 
-            input1_b=_mm_packus_epi16(input1_1,input1_2);
+        input1_b=_mm_packus_epi16(input1_1,input1_2);
+        _mm_storeu_si128((__m128i*)(d+index+count1),input1_b);
 
-            _mm_storeu_si128((__m128i*)(d+index),input1_b);
+        input1_b=_mm_loadu_si128((const __m128i*)(d+index+count2));
+        input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count2));
 
-            input1_b=_mm_loadu_si128((const __m128i*)(d+index+count1));
-            input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count1));
+        input1_1=_mm_unpacklo_epi8(input1_b,v0);
+        input1_2=_mm_unpackhi_epi8(input1_b,v0);
 
-            input1_1=_mm_unpacklo_epi8(input1_b,v0);
-            input1_2=_mm_unpackhi_epi8(input1_b,v0);
+        input2_1=_mm_unpacklo_epi8(input2_b,v0);
+        input2_2=_mm_unpackhi_epi8(input2_b,v0);
 
-            input2_1=_mm_unpacklo_epi8(input2_b,v0);
-            input2_2=_mm_unpackhi_epi8(input2_b,v0);
+        input1_1=_mm_mullo_epi16(input1_1,input2_a_1_neg);
+        input1_2=_mm_mullo_epi16(input1_2,input2_a_2_neg);
 
-            input1_1=_mm_mullo_epi16(input1_1,input2_a_1_neg);
-            input1_2=_mm_mullo_epi16(input1_2,input2_a_2_neg);
+        input2_1=_mm_mullo_epi16(input2_1,input2_a_1);
+        input2_2=_mm_mullo_epi16(input2_2,input2_a_2);
 
-            input2_1=_mm_mullo_epi16(input2_1,input2_a_1);
-            input2_2=_mm_mullo_epi16(input2_2,input2_a_2);
+        input1_1=_mm_adds_epu16(input1_1,input2_1);
+        input1_2=_mm_adds_epu16(input1_2,input2_2);
 
-            input1_1=_mm_adds_epu16(input1_1,input2_1);
-            input1_2=_mm_adds_epu16(input1_2,input2_2);
+        //input1_1=_mm_mulhi_epu16(input1_1,v257);
+        //input1_2=_mm_mulhi_epu16(input1_2,v257);
+        input1_1=_mm_mulhi_epu16(input1_1,v32897);
+        input1_2=_mm_mulhi_epu16(input1_2,v32897);
+        input1_1=_mm_srli_epi16(input1_1,7);
+        input1_2=_mm_srli_epi16(input1_2,7);
 
-            //input1_1=_mm_mulhi_epu16(input1_1,v257);
-            //input1_2=_mm_mulhi_epu16(input1_2,v257);
-            input1_1=_mm_mulhi_epu16(input1_1,v32897);
-            input1_2=_mm_mulhi_epu16(input1_2,v32897);
-            input1_1=_mm_srli_epi16(input1_1,7);
-            input1_2=_mm_srli_epi16(input1_2,7);
+        input1_b=_mm_packus_epi16(input1_1,input1_2);
+        _mm_storeu_si128((__m128i*)(d+index+count2),input1_b);
 
-            input1_b=_mm_packus_epi16(input1_1,input1_2);
-            _mm_storeu_si128((__m128i*)(d+index+count1),input1_b);
+        __m128i input1_a=_mm_loadu_si128((const __m128i*)(d+index+count3));
+        __m128i input1_a_1=_mm_unpacklo_epi8(input1_a,v0);
+        __m128i input1_a_2=_mm_unpackhi_epi8(input1_a,v0);
 
-            input1_b=_mm_loadu_si128((const __m128i*)(d+index+count2));
-            input2_b=_mm_loadu_si128((const __m128i*)(img_d+img_index+img_count2));
+        input1_a_1=_mm_adds_epi16(input1_a_1,input2_a_1);
+        input1_a_2=_mm_adds_epi16(input1_a_2,input2_a_2);
 
-            input1_1=_mm_unpacklo_epi8(input1_b,v0);
-            input1_2=_mm_unpackhi_epi8(input1_b,v0);
+        input1_a=_mm_packus_epi16(input1_a_1,input1_a_2);
+        _mm_storeu_si128((__m128i*)(d+index+count3),input1_a);
+    }
+#endif
+    for(;index<index_end;index++,img_index++)
+    {
+        int a=img_d[img_index+img_count3];
+        if(a==0)
+            continue;
+        if(a==255)
+        {
+            d[index]=img_d[img_index];
+            d[index+count1]=img_d[img_index+img_count1];
+            d[index+count2]=img_d[img_index+img_count2];
+            d[index+count3]=255;
+            continue;
+        }
 
-            input2_1=_mm_unpacklo_epi8(input2_b,v0);
-            input2_2=_mm_unpackhi_epi8(input2_b,v0);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        for(int channel=0;channel<4;channel++)
+        {
+            uint8_t& target=d[index+channel*count1];
+            target=std::min(255,img_d[img_index+channel*img_count1]+((int(target)*(255-a)*32897)>>23));
+        }
+#else
+        d[index       ]=(int(d[index       ]*(255-a)+img_d[img_index]*a)*(32897))>>23;
+        d[index+count1]=(int(d[index+count1]*(255-a)+img_d[img_index+img_count1]*a)*(32897))>>23;
+        d[index+count2]=(int(d[index+count2]*(255-a)+img_d[img_index+img_count2]*a)*(32897))>>23;
+        int alpha=(int)d[index+count3]+a;
+        d[index+count3]=alpha>255?255:alpha;
+#endif
+    }
+#else
+    color* d=((color*)target_image.data())+target_index;
+    const color* img_d=(const color*)img.data();
+    for(int index=0;index<length;index++,img_index++)
+    {
+        const color& c_source=img_d[img_index];
+        color& c_target=d[index];
+        if(c_source.a==0)
+            continue;
+        if(c_source.a==255)
+        {
+            c_target=c_source;
+            continue;
+        }
 
-            input1_1=_mm_mullo_epi16(input1_1,input2_a_1_neg);
-            input1_2=_mm_mullo_epi16(input1_2,input2_a_2_neg);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        int a_neg=255-c_source.a;
+        c_target.r=std::min(255,c_source.r+((int(c_target.r)*a_neg*32897)>>23));
+        c_target.g=std::min(255,c_source.g+((int(c_target.g)*a_neg*32897)>>23));
+        c_target.b=std::min(255,c_source.b+((int(c_target.b)*a_neg*32897)>>23));
+        c_target.a=c_source.a+((int(c_target.a)*a_neg*32897)>>23);
+#else
+        c_target.r=(int(c_target.r*(255-c_source.a)+c_source.r*c_source.a)*(32897))>>23;
+        c_target.g=(int(c_target.g*(255-c_source.a)+c_source.g*c_source.a)*(32897))>>23;
+        c_target.b=(int(c_target.b*(255-c_source.a)+c_source.b*c_source.a)*(32897))>>23;
+        int alpha=(int)c_target.a+c_source.a;
+        c_target.a=alpha>255?255:alpha;
+#endif
+    }
+#endif
+}
 
-            input2_1=_mm_mullo_epi16(input2_1,input2_a_1);
-            input2_2=_mm_mullo_epi16(input2_2,input2_a_2);
+/// \brief Copies length pixels of img starting at pixel img_index to target_image starting at target_index.
+void copy_image_row(image& target_image,int target_index,const image_view& img,int img_index,int length)
+{
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    uint8_t* d=target_image.data()+target_index;
+    const uint8_t* s=img.data()+img_index;
+    for(int channel=0;channel<4;channel++)
+        memcpy(d+size_t(channel)*target_image.plane_stride(),s+size_t(channel)*img.plane_stride(),length);
+#else
+    memcpy(target_image.data()+target_index,img.data()+img_index,size_t(length)*4);
+#endif
+}
 
-            input1_1=_mm_adds_epu16(input1_1,input2_1);
-            input1_2=_mm_adds_epu16(input1_2,input2_2);
+/// \brief Scans the alpha channel of img for the opacity spans of all rows.
+void build_opacity_index(const image& img,opacity_index& index)
+{
+    index.row_begin.clear();
+    index.spans.clear();
+    index.row_begin.reserve(img.height()+1);
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const uint8_t* alpha=img.const_data()+size_t(img.plane_stride())*3;
+    const int step=1;
+#else
+    const uint8_t* alpha=(const uint8_t*)img.const_data()+3;  // the alpha is the fourth byte in all packed layouts
+    const int step=4;
+#endif
+    auto kind_of=[](uint8_t a)
+    {
+        return a==0?opacity_span::transparent:a==255?opacity_span::opaque:opacity_span::mixed;
+    };
+    const int w=img.width();
+    for(int y=0;y<img.height();y++)
+    {
+        const size_t row_first=index.spans.size();
+        index.row_begin.push_back(int(row_first));
+        const uint8_t* a=alpha+size_t(y)*img.stride()*step;
+        for(int x=0;x<w;)
+        {
+            const int begin=x;
+            const opacity_span::kind_type run=kind_of(a[x*step]);
+            for(x++;x<w&&kind_of(a[x*step])==run;x++);
+            const opacity_span::kind_type kind=x-begin>=opacity_span::min_length?run:opacity_span::mixed;
+            if(index.spans.size()>row_first&&index.spans.back().kind==kind)
+                index.spans.back().end=x;
+            else
+                index.spans.push_back(opacity_span{begin,x,kind});
+        }
+    }
+    index.row_begin.push_back(int(index.spans.size()));
+}
 
-            //input1_1=_mm_mulhi_epu16(input1_1,v257);
-            //input1_2=_mm_mulhi_epu16(input1_2,v257);
-            input1_1=_mm_mulhi_epu16(input1_1,v32897);
-            input1_2=_mm_mulhi_epu16(input1_2,v32897);
-            input1_1=_mm_srli_epi16(input1_1,7);
-            input1_2=_mm_srli_epi16(input1_2,7);
+}   // namespace
 
-            input1_b=_mm_packus_epi16(input1_1,input1_2);
-            _mm_storeu_si128((__m128i*)(d+index+count2),input1_b);
+image image_view::copy()const
+{
+    image ret(width(),height());
+    for(int y=0;y<height();y++)
+        copy_image_row(ret,y*width(),*this,y*stride(),width());
+    return ret;
+}
 
-            __m128i input1_a=_mm_loadu_si128((const __m128i*)(d+index+count3));
-            __m128i input1_a_1=_mm_unpacklo_epi8(input1_a,v0);
-            __m128i input1_a_2=_mm_unpackhi_epi8(input1_a,v0);
+image image_view::scaled(int w,int h)const
+{
+    image ret(std::max(0,w),std::max(0,h));
+    resample(*this,ret,resample_filter::linear);
+    return ret;
+}
 
-            input1_a_1=_mm_adds_epi16(input1_a_1,input2_a_1);
-            input1_a_2=_mm_adds_epi16(input1_a_2,input2_a_2);
+const opacity_index& image::opacity_spans()const
+{
+    if(_opacity_state.load(std::memory_order_acquire)==2)
+        return *_opacity;
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if(_opacity_state.load(std::memory_order_acquire)!=2)
+    {
+        if(!_opacity)
+            _opacity.reset(new opacity_index);
+        build_opacity_index(*this,*_opacity);
+        _opacity_state.store(2,std::memory_order_release);
+    }
+    return *_opacity;
+}
 
-            input1_a=_mm_packus_epi16(input1_a_1,input1_a_2);
-            _mm_storeu_si128((__m128i*)(d+index+count3),input1_a);
-        }
-#endif
-        for(;index<index_end;index++,img_index++)
+lfgui::rect image::opaque_rect()const
+{
+    const opacity_index& index=opacity_spans();
+    auto opaque_in_row=[&](int y,int begin,int end)
+    {
+        for(const opacity_span* s=index.row(y);s!=index.row_end(y);s++)
+            if(s->kind==opacity_span::opaque&&s->begin<=begin&&end<=s->end)
+                return true;
+        return false;
+    };
+
+    // The widest opaque span of each row is extended up and down over the rows that are opaque there as well.
+    // Rows with the same widest span as the row before would give the same rectangle.
+    lfgui::rect ret;
+    int previous_begin=0;
+    int previous_end=0;
+    for(int y=0;y<height();y++)
+    {
+        const opacity_span* widest=nullptr;
+        for(const opacity_span* s=index.row(y);s!=index.row_end(y);s++)
+            if(s->kind==opacity_span::opaque&&(!widest||s->end-s->begin>widest->end-widest->begin))
+                widest=s;
+        if(!widest)
         {
-            int a=img_d[img_index+img_count3];
-            if(a==0)
-                continue;
-            if(a==255)
-            {
-                d[index]=img_d[img_index];
-                d[index+count1]=img_d[img_index+img_count1];
-                d[index+count2]=img_d[img_index+img_count2];
-                d[index+count3]=255;
-                continue;
-            }
-
-            d[index       ]=(int(d[index       ]*(255-a)+img_d[img_index]*a)*(32897))>>23;
-            d[index+count1]=(int(d[index+count1]*(255-a)+img_d[img_index+img_count1]*a)*(32897))>>23;
-            d[index+count2]=(int(d[index+count2]*(255-a)+img_d[img_index+img_count2]*a)*(32897))>>23;
-            int alpha=(int)d[index+count3]+a;
-            d[index+count3]=alpha>255?255:alpha;
+            previous_end=previous_begin;
+            continue;
         }
+        if(widest->begin==previous_begin&&widest->end==previous_end)
+            continue;
+        previous_begin=widest->begin;
+        previous_end=widest->end;
+        int top=y;
+        while(top>0&&opaque_in_row(top-1,widest->begin,widest->end))
+            top--;
+        int bottom=y+1;
+        while(bottom<height()&&opaque_in_row(bottom,widest->begin,widest->end))
+            bottom++;
+        const lfgui::rect r(widest->begin,top,widest->end-widest->begin,bottom-top);
+        if(r.area()>ret.area())
+            ret=r;
     }
-#else
-    color* img_d=(color*)img.data();
-    int target_y=start_y;
-    int img_y=img_offset_y;
-    for(;target_y<end_y;target_y++,img_y++)
+    return ret;
+}
+
+const opacity_index* image::_opacity_for_drawing()const
+{
+    int state=_opacity_state.load(std::memory_order_acquire);
+    if(state==2)
+        return _opacity.get();
+    if(state==0&&_opacity_state.compare_exchange_strong(state,1))
+        return nullptr;
+    return &opacity_spans();
+}
+
+void image::draw_image(int x,int y,const image& img,lfgui::rect area)
+{
+    if(area.width==0)
+        area.width=img.width()-area.left();
+    if(area.height==0)
+        area.height=img.height()-area.top();
+    draw_image(x,y,img.view(area));
+}
+
+void image::draw_image(int x,int y,const image_view& img)
+{
+    if(x>=width()||y>=height())
+        return;
+    _count_draw(x,y,img.width(),img.height());
+    if(_recording)
     {
-        int target_x=start_x;
-        int img_x=img_offset_x;
+        const auto s=recorded_view(*_recording,img);
+        return _record([=](image& i){i.draw_image(x,y,image_view(*s.first,s.second));});
+    }
+    int img_offset_x=0;
+    int img_offset_y=0;
+    int start_x=x;
+    int start_y=y;
+    int end_x=x+img.width();
+    int end_y=y+img.height();
 
-        color* d=((color*)data())+target_x+target_y*width();
-        int index=0;
-        int index_end=end_x-start_x;
-        int img_index=img_x+img_y*img.width();
+    if(end_x>=width())
+        end_x=width();
+    if(end_y>=height())
+        end_y=height();
+
+    if(start_x<0)
+    {
+        img_offset_x-=start_x;
+        start_x=0;
+    }
+    if(start_y<0)
+    {
+        img_offset_y-=start_y;
+        start_y=0;
+    }
+    if(end_x<0||end_y<0)
+        return;
 
-        // TODO: add SSE2
+    const int length=end_x-start_x;
+    if(length<=0)
+        return;
 
-        for(;index<index_end;index++,img_index++)
+    // Transparent spans are skipped, opaque ones copied and only the rest is blended. The planar SIMD blending
+    // already skips and copies blocks of 16 pixels quickly, there only long spans are worth the extra calls.
+#if defined(LFGUI_SSE2)&&defined(LFGUI_SEPARATE_COLOR_CHANNELS)
+    const int blend_block=16;
+    const int min_span=64;
+#else
+    const int blend_block=1;
+    const int min_span=0;
+#endif
+    // the spans are in coordinates of the viewed image, views of foreign data have none
+    const opacity_index* opacity=img.source()?img.source()->_opacity_for_drawing():nullptr;
+    const point origin=img.origin();
+    const int img_end_x=img_offset_x+length;
+    for(int target_y=start_y,img_y=img_offset_y;target_y<end_y;target_y++,img_y++)
+    {
+        const int target_index=start_x+target_y*stride();
+        const int img_index=img_offset_x+img_y*img.stride();
+        if(!opacity)
         {
-            color& c_source=img_d[img_index];
-            color& c_target=d[index];
-            if(c_source.a==0)
-                continue;
-            if(c_source.a==255)
+            blend_image_row(*this,target_index,img,img_index,length);
+            continue;
+        }
+        const int row=img_y+origin.y;
+        const opacity_span* span=std::upper_bound(opacity->row(row),opacity->row_end(row),img_offset_x+origin.x,
+                                                  [](int x,const opacity_span& s){return x<s.end;});
+        int img_x=img_offset_x;     // the pixels before are drawn or part of the blended run
+        int blend_begin=img_x;      // the start of the run of pixels to blend, which ends at img_x
+        for(;span!=opacity->row_end(row)&&span->begin-origin.x<img_end_x;span++)
+        {
+            int begin=std::max(span->begin-origin.x,img_x);
+            const int end=std::min(span->end-origin.x,img_end_x);
+            if(span->kind==opacity_span::mixed||end-begin<min_span)
             {
-                c_target=c_source;
+                img_x=end;
                 continue;
             }
-
-            c_target.r=(int(c_target.r*(255-c_source.a)+c_source.r*c_source.a)*(32897))>>23;
-            c_target.g=(int(c_target.g*(255-c_source.a)+c_source.g*c_source.a)*(32897))>>23;
-            c_target.b=(int(c_target.b*(255-c_source.a)+c_source.b*c_source.a)*(32897))>>23;
-            int alpha=(int)c_target.a+c_source.a;
-            c_target.a=alpha>255?255:alpha;
+            if(blend_begin<begin)
+            {
+                // blending works for any pixel, so the run is extended into this span to avoid a scalar rest
+                begin=std::min(blend_begin+(begin-blend_begin+blend_block-1)/blend_block*blend_block,end);
+                blend_image_row(*this,target_index+blend_begin-img_offset_x,img,img_index+blend_begin-img_offset_x,
+                                begin-blend_begin);
+            }
+            if(span->kind==opacity_span::opaque&&begin<end)
+                copy_image_row(*this,target_index+begin-img_offset_x,img,img_index+begin-img_offset_x,end-begin);
+            img_x=blend_begin=end;
         }
+        if(blend_begin<img_x)
+            blend_image_row(*this,target_index+blend_begin-img_offset_x,img,img_index+blend_begin-img_offset_x,
+                            img_x-blend_begin);
     }
-#endif
 }
 
 void image::draw_image(int start_x,int start_y,const image& img,float opacity)
@@ -1173,7 +1503,7 @@ return;
         for(int x=0;x<end_x;x++)
         {
             if(0<=target_x&&0<=target_y)
-                blend_pixel(target_x,target_y,img.get_pixel(x,y).alpha_multiplied(opacity));
+                _blend_pixel(target_x,target_y,img.get_pixel(x,y).alpha_multiplied(opacity));
             target_x++;
         }
         target_x=start_x;
@@ -1183,20 +1513,30 @@ return;
 
 void image::draw_image_multiplied(int x,int y,const image& img,lfgui::rect area)
 {
-    if(x>=width()||y>=height())
-        return;
     if(area.width==0)
         area.width=img.width()-area.left();
     if(area.height==0)
         area.height=img.height()-area.top();
-    int img_offset_x=area.x;
-    int img_offset_y=area.y;
-    area.x=x;
-    area.y=y;
+    draw_image_multiplied(x,y,img.view(area));
+}
+
+void image::draw_image_multiplied(int x,int y,const image_view& img)
+{
+    if(x>=width()||y>=height())
+        return;
+    _count_draw(x,y,img.width(),img.height());
+    if(_recording)
+    {
+        const auto s=recorded_view(*_recording,img);
+        return _record([=](image& i){i.draw_image_multiplied(x,y,image_view(*s.first,s.second));});
+    }
+    _invalidate_opacity();
+    int img_offset_x=0;
+    int img_offset_y=0;
     int start_x=x;
     int start_y=y;
-    int end_x=area.right();
-    int end_y=area.bottom();
+    int end_x=x+img.width();
+    int end_y=y+img.height();
 
     if(end_x>=width())
         end_x=width();
@@ -1216,14 +1556,13 @@ void image::draw_image_multiplied(int x,int y,const image& img,lfgui::rect area)
     if(end_x<0||end_y<0)
         return;
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* d=data();
-    uint8_t* img_d=img.data();
-    int count1=width()*height();
-    int count2=width()*height()*2;
-    int count3=width()*height()*3;
-    int img_count1=img.width()*img.height();
-    int img_count2=img.width()*img.height()*2;
-    int img_count3=img.width()*img.height()*3;
+    const uint8_t* img_d=img.data();
+    int count1=plane_stride();
+    int count2=plane_stride()*2;
+    int count3=plane_stride()*3;
+    int img_count1=img.plane_stride();
+    int img_count2=img.plane_stride()*2;
+    int img_count3=img.plane_stride()*3;
     int target_y=start_y;
     int img_y=img_offset_y;
 
@@ -1232,10 +1571,10 @@ void image::draw_image_multiplied(int x,int y,const image& img,lfgui::rect area)
         int target_x=start_x;
         int img_x=img_offset_x;
 
-        uint8_t* d=data()+target_x+target_y*width();
+        uint8_t* d=_pixels()+target_x+target_y*stride();
         int index=0;
         int index_end=end_x-start_x;
-        int img_index=img_x+img_y*img.width();
+        int img_index=img_x+img_y*img.stride();
 
 #ifdef __SSE2__f
         __m128i v0=_mm_set1_epi32(0);
@@ -1397,7 +1736,7 @@ d[index+count2]=img_d[img_index+img_count2];*/
         }
     }
 #else
-    color* img_d=(color*)img.data();
+    const color* img_d=(const color*)img.data();
     int target_y=start_y;
     int img_y=img_offset_y;
 
@@ -1406,14 +1745,14 @@ d[index+count2]=img_d[img_index+img_count2];*/
         int target_x=start_x;
         int img_x=img_offset_x;
 
-        color* d=((color*)data())+target_x+target_y*width();
+        color* d=((color*)_pixels())+target_x+target_y*stride();
         int index=0;
         int index_end=end_x-start_x;
-        int img_index=img_x+img_y*img.width();
+        int img_index=img_x+img_y*img.stride();
 
         for(;index<index_end;index++,img_index++)
         {
-            color& c_source=img_d[img_index];
+            const color& c_source=img_d[img_index];
             float a=c_source.a;
             if(a==0)
                 continue;
@@ -1434,8 +1773,14 @@ d[index+count2]=img_d[img_index+img_count2];*/
 #endif
 }
 
-void image::draw_image_solid(int start_x,int start_y,const image& img)
+void image::draw_image_solid(int start_x,int start_y,const image_view& img)
 {
+    _count_draw(start_x,start_y,img.width(),img.height());
+    if(_recording)
+    {
+        const auto s=recorded_view(*_recording,img);
+        return _record([=](image& i){i.draw_image_solid(start_x,start_y,image_view(*s.first,s.second));});
+    }
     int end_x=start_x+img.width();
     int end_y=start_y+img.height();
     if(end_x>width())
@@ -1445,15 +1790,22 @@ void image::draw_image_solid(int start_x,int start_y,const image& img)
     end_x-=start_x;
     end_y-=start_y;
 
-    int target_x=start_x;
-    int target_y=start_y;
+    // only the part inside this image, rows reaching further would write into the padding or the next row, which
+    // can belong to another sub_image()
+    const int img_x=std::max(0,-start_x);
+    const int first_y=std::max(0,-start_y);
+    const int length=end_x-img_x;
+    if(length<=0)
+        return;
+    int target_x=start_x+img_x;
+    int target_y=start_y+first_y;
 
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* source=img.data();
+    const uint8_t* source=img.data()+img_x;
     uint8_t* target=data();
-    int source_count=img.width()*img.height();
-    int target_count=width()*height();
-    for(int y=0;y<end_y;y++)
+    int source_count=img.plane_stride();
+    int target_count=plane_stride();
+    for(int y=first_y;y<end_y;y++)
     {
         /*for(int x=0;x<end_x;x++)
         {
@@ -1468,10 +1820,10 @@ void image::draw_image_solid(int start_x,int start_y,const image& img)
             }
             target_x++;
         }*/
-        memcpy(target+target_x+target_y*width(),source+y*img.width(),img.width());
-        memcpy(target+target_x+target_y*width()+target_count,source+y*img.width()+source_count,img.width());
-        memcpy(target+target_x+target_y*width()+target_count*2,source+y*img.width()+source_count*2,img.width());
-        memcpy(target+target_x+target_y*width()+target_count*3,source+y*img.width()+source_count*3,img.width());
+        memcpy(target+target_x+target_y*stride(),source+y*img.stride(),length);
+        memcpy(target+target_x+target_y*stride()+target_count,source+y*img.stride()+source_count,length);
+        memcpy(target+target_x+target_y*stride()+target_count*2,source+y*img.stride()+source_count*2,length);
+        memcpy(target+target_x+target_y*stride()+target_count*3,source+y*img.stride()+source_count*3,length);
         //target_x=start_x;
         /*int i=target_x+target_y*width();
         int j=y*img.width();
@@ -1479,16 +1831,231 @@ void image::draw_image_solid(int start_x,int start_y,const image& img)
         target_y++;
     }
 #else
-    uint32_t* source=img.data();
+    const uint32_t* source=img.data()+img_x;
     uint32_t* target=data();
-    for(int y=0;y<end_y;y++)
+    for(int y=first_y;y<end_y;y++)
     {
-        memcpy(target+target_x+target_y*width(),source+y*img.width(),img.width()*4);
+        memcpy(target+target_x+target_y*stride(),source+y*img.stride(),size_t(length)*4);
         target_y++;
     }
 #endif
 }
 
+namespace
+{
+
+/// \brief Narrows the range lo<x<hi to the x for which min<p0+x*dp<max.
+void clip_span(float p0,float dp,float min,float max,float& lo,float& hi)
+{
+    if(dp==0)
+    {
+        if(!(min<p0&&p0<max))
+            hi=lo;
+        return;
+    }
+    float x1=(min-p0)/dp;
+    float x2=(max-p0)/dp;
+    if(dp<0)
+        std::swap(x1,x2);
+    lo=std::max(lo,x1);
+    hi=std::min(hi,x2);
+}
+
+/// \brief Returns the pixel of img at the 16.16 fixed point position u,v (pixel centers are at .5) interpolated
+/// between its four neighbours. Positions outside of the image use the nearest border pixel.
+inline color sample_bilinear(const image_view& img,int u,int v)
+{
+    const int w=img.width();
+    const int h=img.height();
+    u-=1<<15;
+    v-=1<<15;
+    const int fu=(u>>8)&255;
+    const int fv=(v>>8)&255;
+    int x0=u>>16;
+    int y0=v>>16;
+    const int x1=std::min(std::max(x0+1,0),w-1);
+    const int y1=std::min(std::max(y0+1,0),h-1);
+    x0=std::min(std::max(x0,0),w-1);
+    y0=std::min(std::max(y0,0),h-1);
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const uint8_t* d=img.data();
+    const int count=img.plane_stride();
+    const int stride=img.stride();
+    const int i00=x0+y0*stride;
+    const int i10=x1+y0*stride;
+    const int i01=x0+y1*stride;
+    const int i11=x1+y1*stride;
+    uint8_t c[4];
+    for(int channel=0;channel<4;channel++,d+=count)
+    {
+        int top=(d[i00]*(256-fu)+d[i10]*fu+128)>>8;
+        int bottom=(d[i01]*(256-fu)+d[i11]*fu+128)>>8;
+        c[channel]=(top*(256-fv)+bottom*fv+128)>>8;
+    }
+    return color(c[2],c[1],c[0],c[3]);
+#else
+    const uint32_t* d=img.data();
+    const int stride=img.stride();
+    const uint32_t p00=d[x0+y0*stride];
+    const uint32_t p10=d[x1+y0*stride];
+    const uint32_t p01=d[x0+y1*stride];
+    const uint32_t p11=d[x1+y1*stride];
+    color ret(0,0,0,0);
+#ifdef LFGUI_SSE2
+    const __m128i v0=_mm_setzero_si128();
+    const __m128i v128=_mm_set1_epi32(128);
+    // the pixel pairs as 16 bit, reordered to left/right pairs per channel for the multiply-add
+    __m128i top=_mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(p00),_mm_cvtsi32_si128(p10)),v0);
+    __m128i bottom=_mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(p01),_mm_cvtsi32_si128(p11)),v0);
+    top=_mm_unpacklo_epi16(top,_mm_unpackhi_epi64(top,top));
+    bottom=_mm_unpacklo_epi16(bottom,_mm_unpackhi_epi64(bottom,bottom));
+    const __m128i weights_u=_mm_set1_epi32((256-fu)|(fu<<16));
+    top=_mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(top,weights_u),v128),8);
+    bottom=_mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(bottom,weights_u),v128),8);
+    // the same with the rows
+    __m128i rows=_mm_packs_epi32(top,bottom);
+    rows=_mm_unpacklo_epi16(rows,_mm_unpackhi_epi64(rows,rows));
+    __m128i c=_mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(rows,_mm_set1_epi32((256-fv)|(fv<<16))),v128),8);
+    c=_mm_packs_epi32(c,c);
+    ret.value=_mm_cvtsi128_si32(_mm_packus_epi16(c,c));
+#else
+    for(int channel=0;channel<4;channel++)
+    {
+        const int shift=channel*8;
+        int top=(((p00>>shift)&255)*(256-fu)+((p10>>shift)&255)*fu+128)>>8;
+        int bottom=(((p01>>shift)&255)*(256-fu)+((p11>>shift)&255)*fu+128)>>8;
+        ret.value|=uint32_t((top*(256-fv)+bottom*fv+128)>>8)<<shift;
+    }
+#endif
+    return ret;
+#endif
+}
+
+/// \brief Returns the pixel of img at the 16.16 fixed point position u,v, clamped to the image.
+inline color sample_nearest(const image_view& img,int u,int v)
+{
+    const int x=std::min(std::max(u>>16,0),img.width()-1);
+    const int y=std::min(std::max(v>>16,0),img.height()-1);
+    return img.get_pixel(x,y);
+}
+
+}   // namespace
+
+void image::draw_image_transformed(const image_view& img,const affine_matrix& m,sampling s,bool antialiased)
+{
+    if(_recording)
+    {
+        _count_draw(0,0,0,0);
+        const auto v=recorded_view(*_recording,img);
+        return _record([=](image& i){i.draw_image_transformed(image_view(*v.first,v.second),m,s,antialiased);});
+    }
+    _invalidate_opacity();
+    const int w=img.width();
+    const int h=img.height();
+    if(w<1||h<1||!m.invertible())
+        return;
+    const affine_matrix inv=m.inverted();
+
+    // bounding box of the transformed image, one pixel larger for the faded borders
+    float min_x=1e30f,min_y=1e30f,max_x=-1e30f,max_y=-1e30f;
+    for(point_float p:{m.map(0,0),m.map(w,0),m.map(0,h),m.map(w,h)})
+    {
+        min_x=std::min(min_x,p.x);
+        min_y=std::min(min_y,p.y);
+        max_x=std::max(max_x,p.x);
+        max_y=std::max(max_y,p.y);
+    }
+    const int x_begin=std::max(0,int(std::floor(min_x))-1);
+    const int y_begin=std::max(0,int(std::floor(min_y))-1);
+    const int x_end=std::min(width(),int(std::ceil(max_x))+1);
+    const int y_end=std::min(height(),int(std::ceil(max_y))+1);
+    if(x_begin>=x_end||y_begin>=y_end)
+        return;
+    _count_draw(x_begin,y_begin,x_end-x_begin,y_end-y_begin);
+
+    // How much u and v change when moving one target pixel away from their borders. The borders are faded from 0 to 1
+    // over one target pixel centered on the border, so margin_u/v source pixels around the image are drawn too.
+    const float grad_u=std::sqrt(inv.a*inv.a+inv.b*inv.b);
+    const float grad_v=std::sqrt(inv.c*inv.c+inv.d*inv.d);
+    const float margin_u=antialiased?grad_u*0.5f:0;
+    const float margin_v=antialiased?grad_v*0.5f:0;
+    const int du=int(inv.a*65536);
+    const int dv=int(inv.c*65536);
+
+    for(int y=y_begin;y<y_end;y++)
+    {
+        // source position of the center of pixel 0 of this row, moving right adds inv.a to u and inv.c to v
+        const float u0=inv.a*0.5f+inv.b*(y+0.5f)+inv.tx;
+        const float v0=inv.c*0.5f+inv.d*(y+0.5f)+inv.ty;
+
+        float lo=x_begin-1;
+        float hi=x_end;
+        clip_span(u0,inv.a,-margin_u,w+margin_u,lo,hi);
+        clip_span(v0,inv.c,-margin_v,h+margin_v,lo,hi);
+        const int span_begin=std::max(x_begin,int(std::floor(lo))+1);
+        const int span_end=std::min(x_end,int(std::ceil(hi)));
+        if(span_begin>=span_end)
+            continue;
+        // the part of the span that is fully covered
+        float inner_lo=x_begin-1;
+        float inner_hi=x_end;
+        clip_span(u0,inv.a,margin_u,w-margin_u,inner_lo,inner_hi);
+        clip_span(v0,inv.c,margin_v,h-margin_v,inner_lo,inner_hi);
+        const int inner_begin=std::max(span_begin,int(std::ceil(inner_lo)));
+        const int inner_end=std::min(span_end,int(std::floor(inner_hi))+1);
+
+        int u=int((u0+span_begin*inv.a)*65536);
+        int v=int((v0+span_begin*inv.c)*65536);
+        for(int x=span_begin;x<span_end;x++,u+=du,v+=dv)
+        {
+            color c=s==sampling::bilinear?sample_bilinear(img,u,v):sample_nearest(img,u,v);
+            if(x<inner_begin||x>=inner_end)
+            {
+                // coverage of the pixel by the image: distance to the nearest border in target pixels
+                const float fu=u/65536.0f;
+                const float fv=v/65536.0f;
+                float coverage=1;
+                if(antialiased)
+                {
+                    float distance=std::min(std::min(fu,w-fu)/grad_u,std::min(fv,h-fv)/grad_v)+0.5f;
+                    coverage=std::min(1.0f,std::max(0.0f,distance));
+                }
+                else if(fu<0||fu>=w||fv<0||fv>=h)
+                    coverage=0;
+                const int cov=int(coverage*256);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+                c=color((c.r*cov)>>8,(c.g*cov)>>8,(c.b*cov)>>8,(c.a*cov)>>8);
+#else
+                c.a=(c.a*cov)>>8;
+#endif
+            }
+            if(!c.a)
+                continue;
+            const int index=x+y*stride();
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+            // the samples are premultiplied already: d=s+d*(1-a)
+            const int a_neg=255-c.a;
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+            uint8_t* d=_pixels()+index;
+            const int channel_size=plane_stride();
+            d[0]=std::min(255,c.b+((d[0]*a_neg*32897)>>23));
+            d[channel_size]=std::min(255,c.g+((d[channel_size]*a_neg*32897)>>23));
+            d[channel_size*2]=std::min(255,c.r+((d[channel_size*2]*a_neg*32897)>>23));
+            d[channel_size*3]=c.a+((d[channel_size*3]*a_neg*32897)>>23);
+#else
+            color& d=((color*)_pixels())[index];
+            d=color(std::min(255,c.r+((d.r*a_neg*32897)>>23)),
+                    std::min(255,c.g+((d.g*a_neg*32897)>>23)),
+                    std::min(255,c.b+((d.b*a_neg*32897)>>23)),
+                    c.a+((d.a*a_neg*32897)>>23));
+#endif
+#else
+            _blend_pixel(index,c);
+#endif
+        }
+    }
+}
+
 void image::draw_image_corners_stretched(int border_width,const image& img)
 {
     int img_w=img.width();
@@ -1496,109 +2063,242 @@ void image::draw_image_corners_stretched(int border_width,const image& img)
 //std::cerr<<"border_width "<<border_width<<" "<<width()<<"x"<<height()<<" w "<<img_w<<" h "<<img_h<<std::endl;
     if(width()<border_width*2||height()<border_width*2)
         throw std::logic_error("lfgui::image::draw_image_corners_stretched ERROR: border_width is too large for this image");
+    if(_recording)
+    {
+        const std::shared_ptr<const image> s=_recording->snapshot(img);
+        return _record([=](image& i){i.draw_image_corners_stretched(border_width,*s);});
+    }
+
+    // the parts are scaled straight from views of img, without cropped copies
+    auto part=[&img](int x,int y,int w,int h){return img.view(lfgui::rect(x,y,w,h));};
 
     // draw corners
-    draw_image(0,0,img.cropped(0,0,img_w/2,img_h/2).scale(border_width,border_width));                                                      // top left
+    draw_image(0,0,part(0,0,img_w/2,img_h/2).scaled(border_width,border_width));                                                        // top left
 
-    draw_image(width()-border_width,0,img.cropped(img_w/2,0,img_w/2,img_h/2).scale(border_width,border_width));                             // top right
-    draw_image(0,height()-border_width,img.cropped(0,img_h/2,img_w/2,img_h/2).scale(border_width,border_width));                            // bottom left
-    draw_image(width()-border_width,height()-border_width,img.cropped(img_w/2,img_h/2,img_w/2,img_h/2).scale(border_width,border_width));   // bottom right
+    draw_image(width()-border_width,0,part(img_w/2,0,img_w/2,img_h/2).scaled(border_width,border_width));                               // top right
+    draw_image(0,height()-border_width,part(0,img_h/2,img_w/2,img_h/2).scaled(border_width,border_width));                              // bottom left
+    draw_image(width()-border_width,height()-border_width,part(img_w/2,img_h/2,img_w/2,img_h/2).scaled(border_width,border_width));     // bottom right
 
     // draw borders
-    draw_image(border_width,0,img.cropped(img_w/2,0,1,img_h/2).scale(width()-border_width*2,border_width));                                 // top
-    draw_image(border_width,height()-border_width,img.cropped(img_w/2,img_h/2,1,img_h/2).scale(width()-border_width*2,border_width));       // bottom
-    draw_image(0,border_width,img.cropped(0,img_h/2,img_w/2,1).scale(border_width,height()-border_width*2));                                // left
-    draw_image(width()-border_width,border_width,img.cropped(img_w/2,img_h/2,img_w/2,1).scale(border_width,height()-border_width*2));       // right
+    draw_image(border_width,0,part(img_w/2,0,1,img_h/2).scaled(width()-border_width*2,border_width));                                   // top
+    draw_image(border_width,height()-border_width,part(img_w/2,img_h/2,1,img_h/2).scaled(width()-border_width*2,border_width));         // bottom
+    draw_image(0,border_width,part(0,img_h/2,img_w/2,1).scaled(border_width,height()-border_width*2));                                  // left
+    draw_image(width()-border_width,border_width,part(img_w/2,img_h/2,img_w/2,1).scaled(border_width,height()-border_width*2));         // right
 
     // draw center
-    draw_image(border_width,border_width,img.cropped(img_w/2,img_h/2,1,1).scale(width()-border_width*2,height()-border_width*2));
+    draw_image(border_width,border_width,part(img_w/2,img_h/2,1,1).scaled(width()-border_width*2,height()-border_width*2));
 }
 
 void image::fill(color c)
 {
-    int size=count();
+    _count_draw(0,0,width(),height());
+    if(_recording)
+        return _record([=](image& i){i.fill(c);});
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+    c=c.premultiplied();
+#endif
+    // contiguous images are filled as if they were one long row
+    const int rows=contiguous()?std::min(1,height()):height();
+    const int size=contiguous()?count():width();
+    auto pixels=data();
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* d=data();
-    memset(d,c.b,size);
-    d+=size;
-    memset(d,c.g,size);
-    d+=size;
-    memset(d,c.r,size);
-    d+=size;
-    memset(d,c.a,size);
+    const int plane=plane_stride();
+    for(int y=0;y<rows;y++)
+    {
+        uint8_t* d=pixels+size_t(y)*stride();
+        memset(d,c.b,size);
+        d+=plane;
+        memset(d,c.g,size);
+        d+=plane;
+        memset(d,c.r,size);
+        d+=plane;
+        memset(d,c.a,size);
+    }
 #else
-    uint32_t* d=data();
-    uint32_t* d_end=d+size;
-    for(;d<=d_end;d++)
-        *d=c.value;
+    for(int y=0;y<rows;y++)
+    {
+        uint32_t* d=pixels+size_t(y)*stride();
+        uint32_t* d_end=d+size;
+#ifdef LFGUI_SSE2
+        // pool buffers are aligned (see memory_pool), foreign ones get their first pixels filled separately
+        for(;d<d_end&&(uintptr_t(d)&15);d++)
+            *d=c.value;
+        const __m128i v=_mm_set1_epi32(int(c.value));
+        for(;d+4<=d_end;d+=4)
+            _mm_store_si128((__m128i*)d,v);
+#endif
+        for(;d<d_end;d++)
+            *d=c.value;
+    }
 #endif
 }
 
-image::~image(){}
-
-image& image::multiply(color c)
+void image::clear(uint8_t value)
 {
-    int size=count();
+    if(_recording)
+        return _record([=](image& i){i.clear(value);});
+    if(contiguous())
+    {
+        memset(data(),value,size_t(count())*4);
+        return;
+    }
+    auto pixels=data();
+    for(int y=0;y<height();y++)
+    {
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* d=data();
-    for(int i=0;i<size;i++)
+        for(int channel=0;channel<4;channel++)
+            memset(pixels+size_t(y)*stride()+size_t(channel)*plane_stride(),value,width());
+#else
+        memset(pixels+size_t(y)*stride(),value,size_t(width())*4);
+#endif
+    }
+}
+
+image& image::premultiply()
+{
+    if(_recording)
     {
-        *d=(*d)*c.b/255;
-        d++;
+        _record([](image& i){i.premultiply();});
+        return *this;
     }
-    for(int i=0;i<size;i++)
+    const int rows=contiguous()?std::min(1,height()):height();
+    const int size=contiguous()?count():width();
+    auto pixels=data();
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const int plane=plane_stride();
+    for(int y=0;y<rows;y++)
     {
-        *d=(*d)*c.g/255;
-        d++;
+        uint8_t* d=pixels+size_t(y)*stride();
+        for(int i=0;i<size;i++)
+        {
+            int a=d[i+plane*3];
+            for(int channel=0;channel<3;channel++)
+                d[i+plane*channel]=(d[i+plane*channel]*a+128)*257>>16;
+        }
     }
-    for(int i=0;i<size;i++)
+#else
+    for(int y=0;y<rows;y++)
     {
-        *d=(*d)*c.r/255;
-        d++;
+        color* d=(color*)pixels+size_t(y)*stride();
+        color* d_end=d+size;
+        for(;d<d_end;d++)
+            *d=d->premultiplied();
     }
+#endif
     return *this;
+}
+
+image& image::unpremultiply()
+{
+    if(_recording)
+    {
+        _record([](image& i){i.unpremultiply();});
+        return *this;
+    }
+    const int rows=contiguous()?std::min(1,height()):height();
+    const int size=contiguous()?count():width();
+    auto pixels=data();
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const int plane=plane_stride();
+    for(int y=0;y<rows;y++)
+    {
+        uint8_t* d=pixels+size_t(y)*stride();
+        for(int i=0;i<size;i++)
+        {
+            int a=d[i+plane*3];
+            for(int channel=0;channel<3;channel++)
+                d[i+plane*channel]=a?std::min(255,(d[i+plane*channel]*255+a/2)/a):0;
+        }
+    }
 #else
-    color* d=(color*)data();
-    color* d_end=d+size;
-    for(;d<d_end;d++)
+    for(int y=0;y<rows;y++)
     {
-        d->r=d->r*c.r/255;
-        d->g=d->g*c.g/255;
-        d->b=d->b*c.b/255;
+        color* d=(color*)pixels+size_t(y)*stride();
+        color* d_end=d+size;
+        for(;d<d_end;d++)
+            *d=d->unpremultiplied();
     }
 #endif
     return *this;
 }
 
-image& image::add(color c)
+image::~image(){}
+
+image& image::multiply(color c)
 {
-    int size=count();
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    auto d=data();
-    for(int i=0;i<size;i++)
+    if(_recording)
     {
-        *d=std::min(255,(*d)+c.b);
-        d++;
+        _record([=](image& i){i.multiply(c);});
+        return *this;
     }
-    for(int i=0;i<size;i++)
+    const int rows=contiguous()?std::min(1,height()):height();
+    const int size=contiguous()?count():width();
+    auto pixels=data();
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const int plane=plane_stride();
+    for(int y=0;y<rows;y++)
     {
-        *d=std::min(255,(*d)+c.g);
-        d++;
+        uint8_t* d=pixels+size_t(y)*stride();
+        for(int i=0;i<size;i++)
+            d[i]=d[i]*c.b/255;
+        d+=plane;
+        for(int i=0;i<size;i++)
+            d[i]=d[i]*c.g/255;
+        d+=plane;
+        for(int i=0;i<size;i++)
+            d[i]=d[i]*c.r/255;
     }
-    for(int i=0;i<size;i++)
+#else
+    for(int y=0;y<rows;y++)
     {
-        *d=std::min(255,(*d)+c.r);
-        d++;
+        color* d=(color*)pixels+size_t(y)*stride();
+        color* d_end=d+size;
+        for(;d<d_end;d++)
+        {
+            d->r=d->r*c.r/255;
+            d->g=d->g*c.g/255;
+            d->b=d->b*c.b/255;
+        }
     }
+#endif
     return *this;
+}
+
+image& image::add(color c)
+{
+    if(_recording)
+    {
+        _record([=](image& i){i.add(c);});
+        return *this;
+    }
+    const int rows=contiguous()?std::min(1,height()):height();
+    const int size=contiguous()?count():width();
+    auto pixels=data();
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const int plane=plane_stride();
+    for(int y=0;y<rows;y++)
+    {
+        uint8_t* d=pixels+size_t(y)*stride();
+        for(int i=0;i<size;i++)
+            d[i]=std::min(255,d[i]+c.b);
+        d+=plane;
+        for(int i=0;i<size;i++)
+            d[i]=std::min(255,d[i]+c.g);
+        d+=plane;
+        for(int i=0;i<size;i++)
+            d[i]=std::min(255,d[i]+c.r);
+    }
 #else
-    color* d=(color*)data();
-    color* d_end=d+size;
-    for(;d<d_end;d++)
+    for(int y=0;y<rows;y++)
     {
-        d->r=std::min(255,d->r+c.r);
-        d->g=std::min(255,d->g+c.g);
-        d->b=std::min(255,d->b+c.b);
+        color* d=(color*)pixels+size_t(y)*stride();
+        color* d_end=d+size;
+        for(;d<d_end;d++)
+        {
+            d->r=std::min(255,d->r+c.r);
+            d->g=std::min(255,d->g+c.g);
+            d->b=std::min(255,d->b+c.b);
+        }
     }
 #endif
     return *this;
@@ -1638,9 +2338,27 @@ void image::draw_character(int x,int y,unsigned int character,const color& color
 {
     y+=f.ascend(font_size);
     const font::bitmap& b=f.get_glyph_cached(character,font_size);
-    for(int y2=0;y2<b.height();y2++)
-        for(int x2=0;x2<b.width();x2++)
-            blend_pixel_safe(x+x2+b.x0,y+y2+b.y0,color.alpha_multiplied(b.data[x2+y2*b.width()]));
+    _count_draw(x+b.x0,y+b.y0,b.width(),b.height());
+    if(_recording)
+    {
+        // the glyph cache of the font is only used by this thread, the replay gets a copy of the glyph
+        const int x0=x+b.x0;
+        const int y0=y+b.y0;
+        const int w=b.width();
+        const int h=b.height();
+        const std::vector<uint8_t> coverage(b.data,b.data+size_t(w)*h);
+        const lfgui::color c=color;
+        return _record([=](image& i){i._draw_coverage(x0,y0,w,h,coverage.data(),c);});
+    }
+    _draw_coverage(x+b.x0,y+b.y0,b.width(),b.height(),b.data,color);
+}
+
+void image::_draw_coverage(int x,int y,int w,int h,const uint8_t* coverage,color c)
+{
+    _invalidate_opacity();
+    for(int y2=0;y2<h;y2++)
+        for(int x2=0;x2<w;x2++)
+            _blend_pixel_safe(x+x2,y+y2,c.alpha_multiplied(coverage[x2+y2*w]));
 }
 
 void image::draw_path(const std::vector<point>& vec,color _color,bool connect_last_point_with_first)
@@ -1663,8 +2381,300 @@ void image::draw_path(const std::vector<point>& vec,color _color,bool connect_la
     }
 }
 
+void image::draw_path(const std::vector<point_float>& vec,color c,const stroke_style& style,bool closed)
+{
+    if(vec.empty())
+        return;
+    if(_recording)
+    {
+        _count_draw(0,0,0,0);
+        return _record([=](image& i){i.draw_path(vec,c,style,closed);});
+    }
+    if(style.width<=1)
+    {
+        // thin lines are drawn with Wu's algorithm, the end point weights add up where two segments meet
+        if(vec.size()==1)
+            draw_line_antialiased(vec[0],vec[0],c.alpha_multiplied(style.width));
+        for(size_t i=1;i<vec.size();i++)
+            draw_line_antialiased(vec[i-1],vec[i],c.alpha_multiplied(style.width));
+        if(closed&&vec.size()>2)
+            draw_line_antialiased(vec.back(),vec[0],c.alpha_multiplied(style.width));
+        return;
+    }
+    static thread_local rasterizer r;
+    r.clear();
+    r.add_stroke(vec,style,closed);
+    if(statistics&&!r.empty())
+    {
+        lfgui::rect bounds=r.bounds();
+        _count_draw(bounds.x,bounds.y,bounds.width,bounds.height);
+    }
+    r.fill(*this,c,fill_rule::non_zero,true);
+}
+
+void image::fill_path(const path& p,color c,fill_rule rule)
+{
+    if(_recording)
+    {
+        _count_draw(0,0,0,0);
+        return _record([=](image& i){i.fill_path(p,c,rule);});
+    }
+    static thread_local rasterizer r;
+    r.clear();
+    r.add_path(p);
+    if(statistics&&!r.empty())
+    {
+        lfgui::rect bounds=r.bounds();
+        _count_draw(bounds.x,bounds.y,bounds.width,bounds.height);
+    }
+    r.fill(*this,c,rule,true);
+}
+
+void image::stroke_path(const path& p,color c,const stroke_style& style)
+{
+    if(_recording)
+    {
+        _count_draw(0,0,0,0);
+        return _record([=](image& i){i.stroke_path(p,c,style);});
+    }
+    if(style.width<=1)
+    {
+        p.flatten(0.25f,[&](const point_float* points,size_t count,bool closed)
+        {
+            draw_path(std::vector<point_float>(points,points+count),c,style,closed);
+        });
+        return;
+    }
+    static thread_local rasterizer r;
+    r.clear();
+    r.add_stroke(p,style);
+    if(statistics&&!r.empty())
+    {
+        lfgui::rect bounds=r.bounds();
+        _count_draw(bounds.x,bounds.y,bounds.width,bounds.height);
+    }
+    r.fill(*this,c,fill_rule::non_zero,true);
+}
+
+namespace
+{
+
+/// \brief Returns the signed distance of px,py to a rounded rectangle around cx,cy with the half size hx,hy and the
+/// corner radius r, negative inside.
+inline float rounded_rect_distance(float px,float py,float cx,float cy,float hx,float hy,float r)
+{
+    const float qx=std::abs(px-cx)-(hx-r);
+    const float qy=std::abs(py-cy)-(hy-r);
+    const float ox=std::max(qx,0.f);
+    const float oy=std::max(qy,0.f);
+    return std::sqrt(ox*ox+oy*oy)+std::min(std::max(qx,qy),0.f)-r;
+}
+
+/// \brief Converts a signed distance into the part of a pixel covered, 0-255.
+inline uint8_t distance_coverage(float d)
+{
+    return uint8_t(std::min(1.f,std::max(0.f,0.5f-d))*255+0.5f);
+}
+
+/// \brief Calls row(y,x,length,coverage,middle_begin,middle_end) for every row of the area from left,top to
+/// right,bottom that is inside the image, with coverage holding the 0-255 coverage of the length pixels starting at x.
+/// coverage_at(px,py) is only called for the pixels within margin of the left and right side of the area. The pixels
+/// of the middle part of a row from middle_begin to middle_end have the same coverage as the center of the row.
+template<typename C,typename R>
+void coverage_rows(const image& img,float left,float top,float right,float bottom,float margin,const C& coverage_at,
+                   const R& row)
+{
+    const int x_begin=std::max(0,int(std::floor(left)));
+    const int x_end=std::min(img.width(),int(std::ceil(right)));
+    const int y_begin=std::max(0,int(std::floor(top)));
+    const int y_end=std::min(img.height(),int(std::ceil(bottom)));
+    if(x_begin>=x_end||y_begin>=y_end)
+        return;
+    // the pixels with their center inside [left+margin,right-margin]
+    const int middle_begin=std::min(x_end,std::max(x_begin,int(std::ceil(left+margin-0.5f))));
+    const int middle_end=std::max(middle_begin,std::min(x_end,int(std::floor(right-margin-0.5f))+1));
+    const float center=(left+right)/2;
+
+    static thread_local std::vector<uint8_t> buffer;
+    buffer.resize(x_end-x_begin);
+    uint8_t* coverage=buffer.data();
+    for(int y=y_begin;y<y_end;y++)
+    {
+        const float py=y+0.5f;
+        for(int x=x_begin;x<middle_begin;x++)
+            coverage[x-x_begin]=coverage_at(x+0.5f,py);
+        if(middle_end>middle_begin)
+            memset(coverage+middle_begin-x_begin,coverage_at(center,py),middle_end-middle_begin);
+        for(int x=middle_end;x<x_end;x++)
+            coverage[x-x_begin]=coverage_at(x+0.5f,py);
+        row(y,x_begin,x_end-x_begin,coverage,middle_begin,middle_end);
+    }
+}
+
+/// \brief Blends a row from coverage_rows() with one color. A long middle part that is empty or fully covered is
+/// skipped or filled without coverage.
+inline void blend_coverage_row(image& img,color c,int y,int x,int length,const uint8_t* coverage,int middle_begin,
+                               int middle_end)
+{
+    const uint8_t middle=middle_end>middle_begin?coverage[middle_begin-x]:1;
+    if(middle_end-middle_begin<16||(middle!=0&&middle!=255))
+    {
+        img.blend_span(x,y,length,c,coverage);
+        return;
+    }
+    img.blend_span(x,y,middle_begin-x,c,coverage);
+    if(middle)
+        img.blend_span(middle_begin,y,middle_end-middle_begin,c);
+    img.blend_span(middle_end,y,x+length-middle_end,c,coverage+middle_end-x);
+}
+
+/// \brief An approximation of the error function with a maximum error of 5e-4 (Abramowitz and Stegun 7.1.27).
+inline float shadow_erf(float x)
+{
+    const float a=std::abs(x);
+    float t=1+(0.278393f+(0.230389f+0.078108f*(a*a))*a)*a;
+    t*=t;
+    const float r=1-1/(t*t);
+    return x<0?-r:r;
+}
+
+}   // namespace
+
+void image::draw_rounded_rect(float x,float y,float w,float h,float radius,color c)
+{
+    _count_draw(int(std::floor(x)),int(std::floor(y)),int(std::ceil(w))+1,int(std::ceil(h))+1);
+    if(!(w>0&&h>0)||c.a==0)
+        return;
+    if(_recording)
+        return _record([=](image& i){i.draw_rounded_rect(x,y,w,h,radius,c);});
+    const float r=std::max(0.f,std::min(radius,std::min(w,h)/2));
+    const float cx=x+w/2;
+    const float cy=y+h/2;
+    coverage_rows(*this,x,y,x+w,y+h,r+1,
+                  [&](float px,float py){return distance_coverage(rounded_rect_distance(px,py,cx,cy,w/2,h/2,r));},
+                  [&](int py,int px,int length,const uint8_t* coverage,int middle_begin,int middle_end)
+                  {
+                      blend_coverage_row(*this,c,py,px,length,coverage,middle_begin,middle_end);
+                  });
+}
+
+void image::draw_rounded_rect(float x,float y,float w,float h,float radius,const gradient& g)
+{
+    _count_draw(int(std::floor(x)),int(std::floor(y)),int(std::ceil(w))+1,int(std::ceil(h))+1);
+    if(_recording)
+        return _record([=](image& i){i.draw_rounded_rect(x,y,w,h,radius,g);});
+    _invalidate_opacity();
+    if(!(w>0&&h>0))
+        return;
+    const float r=std::max(0.f,std::min(radius,std::min(w,h)/2));
+    const float cx=x+w/2;
+    const float cy=y+h/2;
+    const bool vertical=g.vertical();
+    coverage_rows(*this,x,y,x+w,y+h,r+1,
+                  [&](float px,float py){return distance_coverage(rounded_rect_distance(px,py,cx,cy,w/2,h/2,r));},
+                  [&](int py,int px,int length,const uint8_t* coverage,int middle_begin,int middle_end)
+                  {
+                      if(vertical)
+                      {
+                          const color c=g.at(g.t(cx,py+0.5f));
+                          if(c.a)
+                              blend_coverage_row(*this,c,py,px,length,coverage,middle_begin,middle_end);
+                          return;
+                      }
+                      for(int i=0;i<length;i++)
+                          if(coverage[i])
+                              _blend_pixel(px+i,py,g.at(g.t(px+i+0.5f,py+0.5f)).alpha_multiplied(int(coverage[i])));
+                  });
+}
+
+void image::draw_rounded_rect_border(float x,float y,float w,float h,float radius,float thickness,color c)
+{
+    _count_draw(int(std::floor(x)),int(std::floor(y)),int(std::ceil(w))+1,int(std::ceil(h))+1);
+    if(!(w>0&&h>0&&thickness>0)||c.a==0)
+        return;
+    if(_recording)
+        return _record([=](image& i){i.draw_rounded_rect_border(x,y,w,h,radius,thickness,c);});
+    const float r=std::max(0.f,std::min(radius,std::min(w,h)/2));
+    const float cx=x+w/2;
+    const float cy=y+h/2;
+    // the coverage of the shape minus the coverage of the shape shrunk by thickness
+    coverage_rows(*this,x,y,x+w,y+h,std::max(r,thickness)+1,
+                  [&](float px,float py)
+                  {
+                      const float d=rounded_rect_distance(px,py,cx,cy,w/2,h/2,r);
+                      return uint8_t(distance_coverage(d)-distance_coverage(d+thickness));
+                  },
+                  [&](int py,int px,int length,const uint8_t* coverage,int middle_begin,int middle_end)
+                  {
+                      blend_coverage_row(*this,c,py,px,length,coverage,middle_begin,middle_end);
+                  });
+}
+
+void image::draw_box_shadow(float x,float y,float w,float h,float radius,float blur,color c)
+{
+    const float sigma=blur/2;
+    if(!(sigma>0.05f))
+    {
+        draw_rounded_rect(x,y,w,h,radius,c);
+        return;
+    }
+    const float reach=3*sigma;
+    _count_draw(int(std::floor(x-reach)),int(std::floor(y-reach)),int(std::ceil(w+reach*2))+1,
+                int(std::ceil(h+reach*2))+1);
+    if(!(w>0&&h>0)||c.a==0)
+        return;
+    if(_recording)
+        return _record([=](image& i){i.draw_box_shadow(x,y,w,h,radius,blur,c);});
+    const float r=std::max(0.f,std::min(radius,std::min(w,h)/2));
+    const float hx=w/2;
+    const float hy=h/2;
+    const float cx=x+hx;
+    const float cy=y+hy;
+    const float scale=0.70710678f/sigma;
+    const float gauss_factor=0.39894228f/sigma;
+    const float gauss_exponent=-0.5f/(sigma*sigma);
+
+    // The blurred shape is integrated exactly along x with the error function and with four samples along y. The x
+    // part is 1 for pixels further than reach inside the straight sides, so the margin is reach outside plus reach
+    // and the corner radius inside. The samples only depend on the row and are computed once per row.
+    float row_y=-1;
+    float half_width[4];    // the half width of the shape at each sample, scaled for shadow_erf()
+    float weight[4];
+    coverage_rows(*this,x-reach,y-reach,x+w+reach,y+h+reach,reach*2+r+1,
+                  [&](float px,float py)
+                  {
+                      if(py!=row_y)
+                      {
+                          row_y=py;
+                          py-=cy;
+                          const float start=std::min(py+hy,std::max(py-hy,-reach));
+                          const float end=std::min(py+hy,std::max(py-hy,reach));
+                          const float step=(end-start)/4;
+                          float sample=start+step/2;
+                          for(int i=0;i<4;i++)
+                          {
+                              const float delta=std::min(hy-r-std::abs(py-sample),0.f);
+                              half_width[i]=(hx-r+std::sqrt(std::max(0.f,r*r-delta*delta)))*scale;
+                              weight[i]=0.5f*gauss_factor*std::exp(sample*sample*gauss_exponent)*step;
+                              sample+=step;
+                          }
+                      }
+                      px=(px-cx)*scale;
+                      float value=0;
+                      for(int i=0;i<4;i++)
+                          value+=(shadow_erf(px+half_width[i])-shadow_erf(px-half_width[i]))*weight[i];
+                      return uint8_t(std::min(1.f,std::max(0.f,value))*255+0.5f);
+                  },
+                  [&](int py,int px,int length,const uint8_t* coverage,int middle_begin,int middle_end)
+                  {
+                      blend_coverage_row(*this,c,py,px,length,coverage,middle_begin,middle_end);
+                  });
+}
+
 image image::rotated90() const
 {
+    if(!contiguous())
+        return copy().rotated90();
     image ret(height(),width());
 
     const int w=width();
@@ -1672,7 +2682,7 @@ image image::rotated90() const
     const int count=w*h;
 
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* source=data();
+    const uint8_t* source=const_data();
     uint8_t* target=ret.data();
 
     for(int y=0;y<h;y++)
@@ -1686,7 +2696,7 @@ image image::rotated90() const
             target[j+count*3]=source[i+count*3];
         }
 #else
-    uint32_t* source=data();
+    const uint32_t* source=const_data();
     uint32_t* target=ret.data();
 
     for(int y=0;y<h;y++)
@@ -1702,49 +2712,45 @@ image image::rotated90() const
 
 image& image::rotate180()
 {
+    if(_recording)
+    {
+        _record([](image& i){i.rotate180();});
+        return *this;
+    }
     const int w=width();
     const int h=height();
-    const int count=w*h;
+    const int row=stride();
 
+    // every pixel of the upper half is swapped with the mirrored one, the middle row of odd heights only up to its
+    // center, so no pair is swapped twice
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
     uint8_t* source=data();
-    const int end=count*4-1;
-    uint8_t temp[4];
-    for(int y=0;y<h;y++)
-        for(int x=0;x<w;x++)
-        {
-            int i=x+y*w;
-            temp[0]=source[i];
-            temp[1]=source[i+count];
-            temp[2]=source[i+count*2];
-            temp[3]=source[i+count*3];
-            source[i]=source[end-(i+count*3)];
-            source[i+count]=source[end-(i+count*2)];
-            source[i+count*2]=source[end-(i+count)];
-            source[i+count*3]=source[end-i];
-            source[end-i]=temp[3];
-            source[end-(i+count)]=temp[2];
-            source[end-(i+count*2)]=temp[1];
-            source[end-(i+count*3)]=temp[0];
-        }
+    const int plane=plane_stride();
 #else
     uint32_t* source=data();
-    const int end=count-1;
-    uint32_t temp;
-    for(int y=0;y<h;y++)
-        for(int x=0;x<w;x++)
+#endif
+    for(int y=0;y<(h+1)/2;y++)
+    {
+        const int x_end=y==h-1-y?w/2:w;
+        for(int x=0;x<x_end;x++)
         {
-            int i=x+y*w;
-            temp=source[i];
-            source[i]=source[end-i];
-            source[end-i]=temp;
-        }
+            const int i=x+y*row;
+            const int j=(w-1-x)+(h-1-y)*row;
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+            for(int channel=0;channel<4;channel++)
+                std::swap(source[i+plane*channel],source[j+plane*channel]);
+#else
+            std::swap(source[i],source[j]);
 #endif
+        }
+    }
     return *this;
 }
 
 image image::rotated270() const
 {
+    if(!contiguous())
+        return copy().rotated270();
     image ret(height(),width());
 
     const int w=width();
@@ -1752,7 +2758,7 @@ image image::rotated270() const
     const int count=w*h;
 
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* source=data();
+    const uint8_t* source=const_data();
     uint8_t* target=ret.data();
     const int end=count*4-1;
     for(int y=0;y<h;y++)
@@ -1766,7 +2772,7 @@ image image::rotated270() const
             target[end-j]=source[i+count*3];
         }
 #else
-    uint32_t* source=data();
+    const uint32_t* source=const_data();
     uint32_t* target=ret.data();
     const int end=count-1;
     for(int y=0;y<h;y++)
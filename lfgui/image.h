@@ -7,8 +7,10 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <atomic>
 #include <functional>
 #include <cstring>
+#include <climits>
 #include <assert.h>
 
 #include "general.h"
@@ -17,6 +19,143 @@
 namespace lfgui
 {
 
+class path;
+class image_view;
+class display_list;
+
+/// \brief How image::draw_image_transformed() reads the source image.
+enum class sampling
+{
+    nearest,    ///< \brief the source pixel the target pixel center falls into, sharp but blocky
+    bilinear    ///< \brief interpolates between the four nearest source pixels
+};
+
+/// \brief Decides which areas of a polygon are inside when its edges cross each other or it contains holes.
+enum class fill_rule
+{
+    non_zero,   ///< \brief inside where the edges wind around a point in sum at least once, direction matters
+    even_odd    ///< \brief inside where a ray from the point crosses an odd number of edges
+};
+
+/// \brief The shape of the corners where two segments of a stroked path meet.
+enum class line_join
+{
+    miter,      ///< \brief the outer edges are extended until they meet, limited by stroke_style::miter_limit
+    round,      ///< \brief a circle around the corner
+    bevel       ///< \brief the outer corners of the segments are connected with a straight line
+};
+
+/// \brief The shape of the ends of a stroked path that is not closed.
+enum class line_cap
+{
+    butt,       ///< \brief ends exactly at the end points
+    round,      ///< \brief a half circle around the end points
+    square      ///< \brief extended by half the width beyond the end points
+};
+
+/// \brief How image::draw_path() and rasterizer::add_stroke() outline a path.
+struct stroke_style
+{
+    float width=1;
+    line_join join=line_join::round;
+    line_cap cap=line_cap::round;
+    /// \brief miter joins longer than miter_limit times the width are drawn as bevel joins
+    float miter_limit=4;
+
+    stroke_style(float width=1,line_join join=line_join::round,line_cap cap=line_cap::round,float miter_limit=4)
+        : width(width),join(join),cap(cap),miter_limit(miter_limit){}
+};
+
+/// \brief A linear or radial color gradient, used by image::draw_rounded_rect(). The colors are interpolated between
+/// start_color at t=0 and end_color at t=1 and are constant beyond.
+struct gradient
+{
+    enum class kind_type
+    {
+        linear,     ///< \brief t goes from 0 at start to 1 at end, constant perpendicular to the line between them
+        radial      ///< \brief t goes from 0 at start (the center) to 1 at the distance of end from the center
+    };
+
+    kind_type kind=kind_type::linear;
+    point_float start;
+    point_float end;
+    color start_color;
+    color end_color;
+
+    static gradient linear(point_float start,color start_color,point_float end,color end_color)
+    {
+        gradient g;
+        g.start=start;
+        g.end=end;
+        g.start_color=start_color;
+        g.end_color=end_color;
+        return g;
+    }
+    static gradient radial(point_float center,float radius,color center_color,color outer_color)
+    {
+        gradient g=linear(center,center_color,point_float(center.x+radius,center.y),outer_color);
+        g.kind=kind_type::radial;
+        return g;
+    }
+
+    /// \brief Returns the gradient parameter at x,y, clamped to 0-1.
+    float t(float x,float y)const
+    {
+        const float dx=end.x-start.x;
+        const float dy=end.y-start.y;
+        const float length_squared=dx*dx+dy*dy;
+        if(length_squared<=0)
+            return 1;
+        float t;
+        if(kind==kind_type::linear)
+            t=((x-start.x)*dx+(y-start.y)*dy)/length_squared;
+        else
+            t=std::sqrt(((x-start.x)*(x-start.x)+(y-start.y)*(y-start.y))/length_squared);
+        return std::min(1.f,std::max(0.f,t));
+    }
+    /// \brief Returns the color at the gradient parameter t.
+    color at(float t)const
+    {
+        const int f=int(t*256+0.5f);
+        return color(start_color.r+(((end_color.r-start_color.r)*f)>>8),
+                     start_color.g+(((end_color.g-start_color.g)*f)>>8),
+                     start_color.b+(((end_color.b-start_color.b)*f)>>8),
+                     start_color.a+(((end_color.a-start_color.a)*f)>>8));
+    }
+    /// \brief Returns true if the color only changes from top to bottom, so each row has a single color.
+    bool vertical()const{return kind==kind_type::linear&&start.x==end.x;}
+};
+
+/// \brief A horizontal run of pixels in one row of an image that are all fully transparent, all fully opaque or mixed.
+struct opacity_span
+{
+    enum kind_type : uint8_t
+    {
+        transparent,    ///< \brief all alpha values are 0
+        opaque,         ///< \brief all alpha values are 255
+        mixed           ///< \brief anything else, may contain transparent or opaque runs shorter than min_length
+    };
+    /// \brief Transparent and opaque runs shorter than this are part of a mixed span, skipping or copying them
+    /// wouldn't pay off.
+    static const int min_length=8;
+
+    int begin;          ///< \brief the x coordinate of the first pixel
+    int end;            ///< \brief the x coordinate after the last pixel
+    kind_type kind;
+};
+
+/// \brief The opacity spans of all rows of an image, see image::opacity_spans(). The spans of row y are
+/// spans[row_begin[y]] to spans[row_begin[y+1]-1], they cover the row from left to right without gaps and two
+/// neighbouring spans never have the same kind.
+struct opacity_index
+{
+    std::vector<int> row_begin;
+    std::vector<opacity_span> spans;
+
+    const opacity_span* row(int y)const{return spans.data()+row_begin[y];}
+    const opacity_span* row_end(int y)const{return spans.data()+row_begin[y+1];}
+};
+
 /// \brief Contains and offers various image drawing and manipulation functions.
 /// The pixel data can be in two different formats:
 /// Default (when LFGUI_SEPARATE_COLOR_CHANNELS is not defined):
@@ -24,6 +163,11 @@ namespace lfgui
 /// When LFGUI_SEPARATE_COLOR_CHANNELS is defined:
 /// The pixel data starts with all the blue channel values of all pixels, then all green, all red and all alpha values
 /// (BBB...GGG...RRR...AAA...).
+/// The pixel data of images that don't use foreign memory comes from memory_pool::global(), it's aligned to 64 bytes
+/// and reused by the next image of about the same size once the image is destroyed.
+/// Rows start stride() pixels apart and color planes plane_stride() pixels apart. Images allocated here have no
+/// padding, images of foreign memory (like a framebuffer with aligned rows) and sub_image()s can have some.
+/// An image constructed with a display_list has no pixels and records the draw calls instead, see display_list.
 class image
 {
 public:
@@ -33,10 +177,15 @@ public:
 
     /// \brief Tries to load an image from the given filename.
     explicit image(const std::string& filename);
+    /// \brief Use an existing memory area for the image data, the image draws directly into it. stride is the distance
+    /// between the starts of two rows in pixels and plane_stride the distance between the starts of two color planes
+    /// in pixels with LFGUI_SEPARATE_COLOR_CHANNELS, 0 means no padding.
+    image(void* data,int width,int height,int stride=0,int plane_stride=0);
     /// \brief Constructs an image with the given width and height.
-    /// \brief Use an existing memory area for the image data.
-    image(void* data,int width,int height);
     explicit image(int width=0,int height=0);
+    /// \brief Constructs an image without pixels that records all draw calls into list instead of drawing them, see
+    /// display_list. The list has to outlive the image.
+    image(display_list& list,int width,int height);
     //image(const image& o);
     //image& operator=(const image& o);
     image(const image& o)=delete;
@@ -46,34 +195,89 @@ public:
     image& operator=(image&& o);
     ~image();
 
+    /// \brief The memory layout of the pixel data of all images, chosen at compile time: planar with
+    /// LFGUI_SEPARATE_COLOR_CHANNELS, packed RGBA with LFGUI_PACKED_RGBA and packed BGRA otherwise. The drawing
+    /// functions are compiled for this layout only. A wrapper should choose the layout of its graphics API so that
+    /// the frame can be uploaded without conversion, other layouts are converted with convert_pixels().
+    ///
+    /// With LFGUI_PREMULTIPLIED_ALPHA defined the pixel data has premultiplied alpha (the color channels are already
+    /// multiplied by the alpha). Loaded images are premultiplied once in image(filename), drawing an image is then
+    /// d=s+d*(1-a) for all four channels and blending is associative, so cached layers can be composited in any
+    /// order. The drawing functions still take colors with straight alpha, set_pixel(), get_pixel() and data()
+    /// access the stored (premultiplied) values.
+#if defined(LFGUI_SEPARATE_COLOR_CHANNELS)
+    static constexpr pixel_format format=pixel_format::planar_bgra;
+#elif defined(LFGUI_PACKED_RGBA)
+    static constexpr pixel_format format=pixel_format::rgba;
+#else
+    static constexpr pixel_format format=pixel_format::bgra;
+#endif
+
     int width()const{return width_;}
     int height()const{return height_;}
     point size()const{return point(width(),height());}
     /// \brief Returns the pixel count which is width()*height().
     int count()const{return width()*height();}
-    /// \brief Returns a pointer to the pixel data.
+    /// \brief The distance between the starts of two rows in pixels. Pixel x,y is at x+y*stride().
+    int stride()const{return _stride?_stride:width();}
+    /// \brief The distance between the starts of two color planes in pixels, only used with
+    /// LFGUI_SEPARATE_COLOR_CHANNELS.
+    int plane_stride()const{return _plane_stride?_plane_stride:stride()*height();}
+    /// \brief Returns true if the rows (and planes) follow each other without padding, so the pixel data can be
+    /// treated as one block of count()*4 bytes.
+    bool contiguous()const{return stride()==width()&&plane_stride()==count();}
+    /// \brief Returns the display_list this image records into, nullptr if it draws.
+    display_list* recording()const{return _recording;}
+    /// \brief Returns a number that is different for every state of the pixels of all images: it changes when this
+    /// image is changed (like the opacity spans, see opacity_spans()) and is never the same for two images. Used by
+    /// display_list::snapshot() to copy images that are drawn in many frames only once.
+    uint64_t version()const;
+    /// \brief Returns a pointer to the pixel data for writing, pixel x,y is at x+y*stride(). The pixels count as
+    /// changed, the opacity spans are computed again when needed (see opacity_spans()), so don't keep the pointer to
+    /// write through it later. Recording images (see recording()) have no pixel data, the functions reading or
+    /// changing the pixels directly (data(), get_pixel(), copy(), resizing, cropping) can't be used on them.
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    uint8_t* data() const {return image_data.get();}
+    uint8_t* data(){_invalidate_opacity();return _pixels();}
 #else
-    uint32_t* data() const {return (uint32_t*)image_data.get();}
+    uint32_t* data(){_invalidate_opacity();return _pixels();}
 #endif
+    /// \brief Returns a pointer to the pixel data for reading. Unlike data() it leaves the opacity spans valid.
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const uint8_t* const_data() const {return image_data.get();}
+#else
+    const uint32_t* const_data() const {return (const uint32_t*)image_data.get();}
+#endif
+
+    /// \brief Returns the runs of transparent, opaque and mixed pixels of every row. They are computed from the alpha
+    /// channel the first time they are needed after the pixels have changed, which every non-const function and
+    /// data() count as. draw_image() uses them to skip transparent runs, copy opaque ones and blend only the rest.
+    /// Building them is thread safe, changing the image while another thread draws it is not.
+    const opacity_index& opacity_spans()const;
+    /// \brief Returns a large (not necessarily the largest) rectangle in which all pixels are opaque, computed from
+    /// opacity_spans(). Empty if there is none. Used to declare the opaque area of a widget, see
+    /// widget::set_opaque_rect().
+    lfgui::rect opaque_rect()const;
 
 
     /// \brief Scales this image. Uses "nearest" scaling.
     image& resize_nearest(int w,int h);
-    /// \brief Scales this image. Uses linear scaling.
+    /// \brief Scales this image. Uses linear scaling (see resample()).
     image& resize_linear(int w,int h);
-    /// \brief Scales this image. Uses cubic scaling.
+    /// \brief Scales this image. Uses cubic scaling, which is sharper than linear scaling (see resample()).
     image& resize_cubic(int w,int h);
+    /// \brief Scales this image. Uses Lanczos scaling, the sharpest but slowest filter (see resample()).
+    image& resize_lanczos(int w,int h);
     /// \brief Scales this image. Same as resize_linear().
     image& scale(int w,int h){return resize_linear(w,h);}
 
     /// \brief Returns a scaled version of this image. Uses "nearest" scaling.
     image resized_nearest(int w,int h)const{image ret=copy();ret.resize_nearest(w,h);return ret;}
     /// \brief Returns a scaled version of this image. Uses linear scaling.
-    image resized_linear(int w,int h)const{image ret=copy();ret.resize_linear(w,h);return ret;}
+    image resized_linear(int w,int h)const;
     /// \brief Returns a scaled version of this image. Uses cubic scaling.
-    image resized_cubic(int w,int h)const{image ret=copy();ret.resize_cubic(w,h);return ret;}
+    image resized_cubic(int w,int h)const;
+    /// \brief Returns a scaled version of this image. Uses Lanczos scaling.
+    image resized_lanczos(int w,int h)const;
     /// \brief Returns a scaled version of this image. Same as resize_linear().
     image scaled(int w,int h)const{return resized_linear(w,h);}
     /// \brief Returns a scaled version of this image. Same as resize_linear().
@@ -94,8 +298,15 @@ public:
 
     /// \brief Crops the image to the given size.
     image& crop(int x,int y,int w,int h);
-    /// \brief Returns a cropped version of this image.
-    image cropped(int x,int y,int w,int h)const{image ret=copy();ret.crop(x,y,w,h);return ret;}
+    /// \brief Returns a cropped version of this image. Only the cropped pixels are copied.
+    image cropped(int x,int y,int w,int h)const;
+    /// \brief Returns a view of the given area of this image (clipped to it) that can be drawn or scaled without
+    /// copying the pixels first. The view refers to this image and is invalid once it changes or is destroyed.
+    image_view view(const lfgui::rect& area)const;
+    /// \brief Returns an image of the given area of this image (clipped to it) that draws into the pixels of this
+    /// image, so a part can be rendered without a temporary image and a copy. Drawing into it counts as changing this
+    /// image. It is invalid once this image is resized, moved or destroyed.
+    image sub_image(const lfgui::rect& area);
 
     /// \brief Multiplies the color of every pixel with the given color. Can be used to colorize the image. Alpha is
     /// not affected.
@@ -111,112 +322,81 @@ public:
     /// colorized image. The alpha is not changed.
     image added(color c)const{image ret=copy();ret.add(c);return ret;}
 
+    /// \brief Multiplies the color channels of every pixel with its alpha. Done automatically for loaded images
+    /// with LFGUI_PREMULTIPLIED_ALPHA, see format.
+    image& premultiply();
+    /// \brief The inverse of premultiply(). Loses precision with small alpha values.
+    image& unpremultiply();
+
+    /// \brief Sets the pixel at position x,y to the given color.
     void set_pixel(int x,int y,color c)
     {
-        int i=x+y*width();
-
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-        uint8_t* d=data();
-        int count=width()*height();
-        d[i]=c.b;
-        d[i+count]=c.g;
-        d[i+count*2]=c.r;
-        d[i+count*3]=c.a;
-#else
-        uint32_t* d=data();
-        d[i]=c.value;
-#endif
+        if(_recording)
+            return _record([=](image& i){i.set_pixel(x,y,c);});
+        _invalidate_opacity();
+        _set_pixel(x,y,c);
     }
-
     /// \brief Blends the pixel at position x,y with the given color. Blending means that the given color is drawn on
     /// top using the colors alpha.
-    inline void blend_pixel(int index,int channel_size,uint8_t b,uint8_t g,uint8_t r,uint8_t a)
+    void blend_pixel(int index,int channel_size,uint8_t b,uint8_t g,uint8_t r,uint8_t a)
     {
-        //if(x<0||y<0||x>=width()||y>=height()) // useful for debugging
-        //    throw lfgui::exception("");
-        if(a==0)
-            return;
-
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-        uint8_t* d=data();
-        d+=index;
-        if(a==255)
-        {
-            *d=b;
-            d+=channel_size;
-            *d=g;
-            d+=channel_size;
-            *d=r;
-            d+=channel_size;
-            *d=255;
-            return;
-        }
-
-        *d=(int((*d)*(255-a)+b*a)*(257))>>16;
-        d+=channel_size;
-        *d=(int((*d)*(255-a)+g*a)*(257))>>16;
-        d+=channel_size;
-        *d=(int((*d)*(255-a)+r*a)*(257))>>16;
-        d+=channel_size;
-        auto alpha=(*d)+a;
-        *d=alpha>255?255:alpha;
-#else
-        color* d=((color*)data())+index;
-        if(a==255)
-        {
-            *d=lfgui::color(r,g,b,255);
-            return;
-        }
-        auto alpha=d->a+a;
-        *d=lfgui::color(((d->r*int(255-a)+r*a)*(257))>>16,
-                        ((d->g*int(255-a)+g*a)*(257))>>16,
-                        ((d->b*int(255-a)+b*a)*(257))>>16,
-                        alpha>255?255:alpha);
-#endif
+        if(_recording)
+            return blend_pixel(index%stride(),index/stride(),color(r,g,b,a));
+        _invalidate_opacity();
+        _blend_pixel(index,channel_size,b,g,r,a);
     }
     /// \brief Blends the pixel at position x,y with the given color. Blending means that the given color is drawn on
     /// top using the colors alpha.
-    inline void blend_pixel(int index,color c)
+    void blend_pixel(int index,color c)
     {
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-        blend_pixel(index,width()*height(),c.b,c.g,c.r,c.a);
-#else
-        blend_pixel(index,0,c.b,c.g,c.r,c.a);
-#endif
+        if(_recording)
+            return blend_pixel(index%stride(),index/stride(),c);
+        _invalidate_opacity();
+        _blend_pixel(index,c);
     }
     /// \brief Blends the pixel at position x,y with the given color. Blending means that the given color is drawn on
     /// top using the colors alpha.
-    inline void blend_pixel(int x,int y,color c)
+    void blend_pixel(int x,int y,color c)
     {
-        blend_pixel(x+y*width(),c);
+        if(_recording)
+            return _record([=](image& i){i.blend_pixel(x,y,c);});
+        _invalidate_opacity();
+        _blend_pixel(x,y,c);
     }
+    /// \brief Same as blend_pixel(), does nothing if x,y is outside of the image.
     void blend_pixel_safe(int x,int y,color c)
     {
-        if(x<0||y<0||x>=width()||y>=height())
-            return;
-        blend_pixel(x,y,c);
+        if(_recording)
+            return _record([=](image& i){i.blend_pixel_safe(x,y,c);});
+        _invalidate_opacity();
+        _blend_pixel_safe(x,y,c);
     }
+    /// \brief Blends length pixels of row y starting at x with the given color, clipped to the image. If coverage is
+    /// given, it contains length values from 0 (pixel not covered) to 255 (fully covered) that are multiplied with the
+    /// alpha of the color. Used by rasterizers to fill a horizontal run of pixels at once.
+    void blend_span(int x,int y,int length,color c,const uint8_t* coverage=nullptr);
 
     color get_pixel(int x,int y) const
     {
-        int i=x+y*width();
+        int i=x+y*stride();
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-        uint8_t* d=data();
-        int count=width()*height();
+        const uint8_t* d=const_data();
+        int count=plane_stride();
         return color(*(d+i+count*2),*(d+i+count),*(d+i),*(d+i+count*3));
 #else
-        color* d=(color*)data();
+        const color* d=(const color*)const_data();
         return d[i];
 #endif
     }
-    /// \brief Returns the pixel at the position given by an offset. offset=x+y*width()
+    /// \brief Returns the pixel at the position given by an offset. offset=x+y*stride()
     color get_pixel(int offset) const
     {
 #ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-        int count=width()*height();
-        return color(*(data()+offset+count*2),*(data()+offset+count),*(data()+offset),*(data()+offset+count*3));
+        int count=plane_stride();
+        const uint8_t* d=const_data();
+        return color(*(d+offset+count*2),*(d+offset+count),*(d+offset),*(d+offset+count*3));
 #else
-        color* d=(color*)data();
+        const color* d=(const color*)const_data();
         return d[offset];
 #endif
     }
@@ -228,6 +408,8 @@ public:
     void draw_line(int x1,int y1,int x2,int y2,color _color);
     /// \brief Draws a line with the given thickness. The drawn color gets more transparent when further away from the
     /// center of the line. This can be adjusted with the fading parameter where 1 is no fading and 0 fading starting in the center.
+    /// The fading covers at least one pixel, so lines without fading are antialiased. Only the pixels near the line
+    /// are visited.
     void draw_line(int x1,int y1,int x2,int y2,color _color,float thickness,float fading=0.7);
     void draw_line(point start,point end,color _color)
     {
@@ -239,8 +421,19 @@ public:
     {
         draw_line(start.x,start.y,end.x,end.y,_color,width,fading_start);
     }
+    /// \brief Draws an antialiased line with a width of one pixel from a to b (Xiaolin Wu's algorithm). The points
+    /// are in the coordinates of the rasterizer: 0,0 is the top left corner of the first pixel, 0.5,0.5 its center.
+    void draw_line_antialiased(point_float a,point_float b,color _color);
     /// \brief Draw a path along the given points. The last point is connected with the first if connect_last_point_with_first is set to true.
     void draw_path(const std::vector<point>& vec,color _color,bool connect_last_point_with_first=false);
+    /// \brief Draws an antialiased path along the given points with the width, joins and caps of style. The outline
+    /// is filled as one shape, so overlapping segments are not blended twice. Paths with a width of one pixel or
+    /// less are drawn with draw_line_antialiased(). The points are in the coordinates of the rasterizer.
+    void draw_path(const std::vector<point_float>& vec,color _color,const stroke_style& style,bool closed=false);
+    /// \brief Fills the area enclosed by the subpaths of p antialiased. Open subpaths are closed for filling.
+    void fill_path(const path& p,color _color,fill_rule rule=fill_rule::non_zero);
+    /// \brief Draws the outline of p antialiased with the width, joins and caps of style.
+    void stroke_path(const path& p,color _color,const stroke_style& style);
     void draw_rect(int x,int y,int width,int height,color color);
     void draw_rect(rect rectangle,color color)
     {
@@ -253,8 +446,25 @@ public:
         draw_line(x+width,y       ,x+width,y+height,color,thickness,fading_start);  //  right
         draw_line(x      ,y+height,x+width,y+height,color,thickness,fading_start);  // bottom
     }
-    /// \brief Draws a filled polygon.
-    void draw_polygon(const std::vector<point>& vec,color color);
+    /// \brief Draws an antialiased rectangle with corners rounded with the given radius (limited to half the width and
+    /// height). The coverage comes from the signed distance to the shape. Only the pixels near the left and right
+    /// border and the rounded corners are evaluated, the rest of each row is filled as one span.
+    void draw_rounded_rect(float x,float y,float w,float h,float radius,color c);
+    /// \brief Draws a rounded rectangle filled with a gradient. Gradients whose color only changes from top to bottom
+    /// are drawn row by row like a single color, others per pixel.
+    void draw_rounded_rect(float x,float y,float w,float h,float radius,const gradient& g);
+    /// \brief Draws the border of a rounded rectangle with the given thickness, inside the rectangle.
+    void draw_rounded_rect_border(float x,float y,float w,float h,float radius,float thickness,color c);
+    /// \brief Draws the shadow of a rounded rectangle: the shape blurred with a gaussian of the given blur radius
+    /// (about two standard deviations), computed analytically (see
+    /// https://madebyevan.com/shaders/fast-rounded-rectangle-shadows/). The shadow reaches 1.5 times blur beyond the
+    /// rectangle. Usually drawn offset below a widget.
+    void draw_box_shadow(float x,float y,float w,float h,float radius,float blur,color c);
+    /// \brief Draws a filled polygon. Pixels are inside if their center is, or with antialiased the color is weighted
+    /// by how much of each pixel the polygon covers. Only the rows covered by the polygon are touched. Use a rasterizer
+    /// directly for subpixel precise corners, several polygons at once or holes.
+    void draw_polygon(const std::vector<point>& vec,color color,bool antialiased=false,
+                      fill_rule rule=fill_rule::even_odd);
     /// \brief Fills the whole image with one color.
     void fill(color color);
 
@@ -271,8 +481,11 @@ public:
         return text_length(str,font_size,0,end_character);
     }
 
-    /// \brief Draws another image onto this one.
+    /// \brief Draws another image onto this one. An area with a width or height of 0 extends to the right or bottom
+    /// of img.
     void draw_image(int x,int y,const image& img,lfgui::rect area=lfgui::rect());
+    /// \brief Draws a view (of a part of another image or of foreign pixel data) onto this image.
+    void draw_image(int x,int y,const image_view& img);
     /// \brief Draws another image onto this one.
     void draw_image(int x,int y,const image& img,float opacity);
     /// \brief Draws another image onto this one.
@@ -281,26 +494,274 @@ public:
     void draw_image(point p,const image& img,float opacity){draw_image(p.x,p.y,img,opacity);}
 
     void draw_image_multiplied(int x,int y,const image& img,lfgui::rect area=lfgui::rect());
+    void draw_image_multiplied(int x,int y,const image_view& img);
 
     /// \brief Draws another image onto this one.
-    void draw_image_solid(int x,int y,const image& img);
+    void draw_image_solid(int x,int y,const image_view& img);
     /// \brief Draws another image onto this one.
-    void draw_image_solid(point p,const image& img){draw_image_solid(p.x,p.y,img);}
+    void draw_image_solid(point p,const image_view& img){draw_image_solid(p.x,p.y,img);}
+
+    /// \brief Draws img transformed by m, which maps coordinates of img (0,0 is the top left corner of its first pixel,
+    /// img.width(),img.height() the bottom right corner of its last pixel) to coordinates of this image. Every target
+    /// pixel inside the transformed image is sampled directly from img, so rotating or zooming a sprite allocates
+    /// nothing. With antialiased the borders of img are faded out over one target pixel. Nothing is drawn if m is not
+    /// invertible.
+    void draw_image_transformed(const image_view& img,const affine_matrix& m,sampling s=sampling::bilinear,
+                                bool antialiased=true);
 
     /// \brief Fills this image with the given image, it is stretched to act as a border with "stretched filling".
     void draw_image_corners_stretched(int border_width,const image& img);
 
     /// \brief Fills the image with the given value.
-    void clear(uint8_t value=0)
-    {
-        memset(data(),value,count()*4);
-    }
+    void clear(uint8_t value=0);
 
     /// \brief Returns a rect with the size of this image.
     lfgui::rect rect()const{return lfgui::rect(0,0,width(),height());}
 
     /// \brief Used to set a function used to load images. This function is set by the wrappers.
     static std::function<image(std::string)> load;
+
+    /// \brief Draw calls and pixels counted while image::statistics is set.
+    struct draw_statistics
+    {
+        uint64_t calls=0;   ///< \brief lines, rectangles, polygons, images, fills and glyphs drawn
+        uint64_t pixels=0;  ///< \brief sum of the bounding boxes of all draw calls, clipped to the target image
+    };
+    /// \brief If set, all draw calls on any image in the current thread are counted here. Used to find out what a
+    /// widget paints (see gui::set_paint_profiling()). Unset by default, the counting costs one branch then.
+    /// Draw calls on a recording image are counted when they are recorded, paths, polygons and transformed images
+    /// without their pixels.
+    static thread_local draw_statistics* statistics;
+
+private:
+    /// \brief The opacity spans, valid if _opacity_state is 2. 0 means the pixels changed since they were computed,
+    /// 1 that the image has been drawn once since then.
+    mutable std::unique_ptr<opacity_index> _opacity;
+    mutable std::atomic<int> _opacity_state{0};
+    /// \brief See version(), 0 if the pixels changed since the last call, the next call takes a new number then.
+    mutable std::atomic<uint64_t> _version{0};
+    int _stride=0;                  ///< \brief 0 if the rows have no padding, see stride()
+    int _plane_stride=0;            ///< \brief 0 if the planes have no padding, see plane_stride()
+    const image* _parent=nullptr;   ///< \brief the image whose pixels a sub_image() uses
+    display_list* _recording=nullptr;
+
+    void _invalidate_opacity()const
+    {
+        _opacity_state.store(0,std::memory_order_relaxed);
+        _version.store(0,std::memory_order_relaxed);
+        if(_parent)
+            _parent->_invalidate_opacity();
+    }
+    /// \brief Takes mw as the new, unpadded pixel data of size w,h.
+    void _replace_data(memory_wrapper&& mw,int w,int h);
+    /// \brief Appends a draw call to the display_list of a recording image.
+    void _record(std::function<void(image&)> command);
+    /// \brief Blends color with the alpha multiplied by the w*h coverage values (0-255) onto the area starting at
+    /// x,y, clipped to the image. Draws the glyphs of draw_character().
+    void _draw_coverage(int x,int y,int w,int h,const uint8_t* coverage,color c);
+    /// \brief data() without marking the pixels as changed.
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    uint8_t* _pixels(){return image_data.get();}
+#else
+    uint32_t* _pixels(){return (uint32_t*)image_data.get();}
+#endif
+    /// \brief Returns the opacity spans for draw_image(), or nullptr the first time the image is drawn after it
+    /// changed. Images that are changed before every draw, like cached layers, are so never scanned for nothing.
+    const opacity_index* _opacity_for_drawing()const;
+
+    /// \brief The per pixel functions without marking the pixels as changed (see opacity_spans()), for the drawing
+    /// functions that do that once.
+    void _set_pixel(int x,int y,color c)
+    {
+        int i=x+y*stride();
+
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+        uint8_t* d=_pixels();
+        int count=plane_stride();
+        d[i]=c.b;
+        d[i+count]=c.g;
+        d[i+count*2]=c.r;
+        d[i+count*3]=c.a;
+#else
+        uint32_t* d=_pixels();
+        d[i]=c.value;
+#endif
+    }
+
+    inline void _blend_pixel(int index,int channel_size,uint8_t b,uint8_t g,uint8_t r,uint8_t a)
+    {
+        //if(x<0||y<0||x>=width()||y>=height()) // useful for debugging
+        //    throw lfgui::exception("");
+        if(a==0)
+            return;
+
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+        uint8_t* d=_pixels();
+        d+=index;
+        if(a==255)
+        {
+            *d=b;
+            d+=channel_size;
+            *d=g;
+            d+=channel_size;
+            *d=r;
+            d+=channel_size;
+            *d=255;
+            return;
+        }
+
+        *d=(int((*d)*(255-a)+b*a)*(257))>>16;
+        d+=channel_size;
+        *d=(int((*d)*(255-a)+g*a)*(257))>>16;
+        d+=channel_size;
+        *d=(int((*d)*(255-a)+r*a)*(257))>>16;
+        d+=channel_size;
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        *d=(int((*d)*(255-a)+255*a)*(257))>>16;
+#else
+        auto alpha=(*d)+a;
+        *d=alpha>255?255:alpha;
+#endif
+#else
+        color* d=((color*)_pixels())+index;
+        if(a==255)
+        {
+            *d=lfgui::color(r,g,b,255);
+            return;
+        }
+        // with premultiplied alpha the destination is already premultiplied and d*(1-a)+s*a stays the same
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        int alpha=((d->a*int(255-a)+255*a)*(257))>>16;
+#else
+        auto alpha=d->a+a;
+#endif
+        *d=lfgui::color(((d->r*int(255-a)+r*a)*(257))>>16,
+                        ((d->g*int(255-a)+g*a)*(257))>>16,
+                        ((d->b*int(255-a)+b*a)*(257))>>16,
+                        alpha>255?255:alpha);
+#endif
+    }
+    inline void _blend_pixel(int index,color c)
+    {
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+        _blend_pixel(index,plane_stride(),c.b,c.g,c.r,c.a);
+#else
+        _blend_pixel(index,0,c.b,c.g,c.r,c.a);
+#endif
+    }
+    inline void _blend_pixel(int x,int y,color c)
+    {
+        _blend_pixel(x+y*stride(),c);
+    }
+    void _blend_pixel_safe(int x,int y,color c)
+    {
+        if(x<0||y<0||x>=width()||y>=height())
+            return;
+        _blend_pixel(x,y,c);
+    }
+
+    /// \brief draw_rect() without counting the draw call.
+    void _fill_rect(int x,int y,int width,int height,color c);
+
+    /// \brief Counts a draw call covering the given area, if statistics is set.
+    void _count_draw(int x,int y,int w,int h)const
+    {
+        if(!statistics)
+            return;
+        statistics->calls++;
+        lfgui::rect r=lfgui::rect(x,y,w,h).intersected(rect());
+        if(!r.empty())
+            statistics->pixels+=uint64_t(r.area());
+    }
+};
+
+/// \brief A read only view of a rectangular area of an image or of foreign pixel data in the layout of
+/// image::format, with a row stride. It doesn't own the pixels and creating one copies nothing, so crops and sub-rects
+/// can be drawn and scaled directly and padded buffers of a wrapper or embedder can be drawn without converting them
+/// to an image first. The pixels have to stay valid and unchanged while the view is used.
+/// Drawing a view of an image uses the opacity spans of the image (see image::opacity_spans()).
+class image_view
+{
+public:
+    image_view()=default;
+    /// \brief Views the whole image.
+    image_view(const image& img)
+        : image_view(img.const_data(),img.width(),img.height(),img.stride(),img.plane_stride()){_source=&img;}
+    /// \brief Views the given area of img, clipped to it.
+    image_view(const image& img,const lfgui::rect& area) : image_view(image_view(img).sub(area)){}
+    /// \brief Views foreign pixel data. stride is the distance between the starts of two rows in pixels and
+    /// plane_stride the distance between the starts of two color planes in pixels with LFGUI_SEPARATE_COLOR_CHANNELS,
+    /// 0 means no padding.
+    image_view(const void* data,int width,int height,int stride=0,int plane_stride=0)
+        : _data((const uint8_t*)data),_width(width),_height(height),_stride(stride?stride:width),
+          _plane_stride(plane_stride?plane_stride:(stride?stride:width)*height){}
+
+    int width()const{return _width;}
+    int height()const{return _height;}
+    point size()const{return point(width(),height());}
+    bool empty()const{return _width<1||_height<1;}
+    /// \brief The distance between the starts of two rows in pixels.
+    int stride()const{return _stride;}
+    /// \brief The distance between the starts of two color planes in pixels, only used with
+    /// LFGUI_SEPARATE_COLOR_CHANNELS.
+    int plane_stride()const{return _plane_stride;}
+    /// \brief Returns the first pixel. Pixel x,y is at x+y*stride().
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const uint8_t* data()const{return _data;}
+#else
+    const uint32_t* data()const{return (const uint32_t*)_data;}
+#endif
+    /// \brief The viewed image or nullptr if the view is of foreign data.
+    const image* source()const{return _source;}
+    /// \brief The position of the first pixel in source().
+    point origin()const{return _origin;}
+    /// \brief Returns a rect with the size of this view.
+    lfgui::rect rect()const{return lfgui::rect(0,0,width(),height());}
+
+    /// \brief Returns a view of the given area of this view, clipped to it.
+    image_view sub(lfgui::rect area)const
+    {
+        area=area.intersected(rect());
+        if(area.empty())
+            return image_view();
+        image_view ret=*this;
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+        ret._data+=area.x+size_t(area.y)*_stride;
+#else
+        ret._data+=(area.x+size_t(area.y)*_stride)*4;
+#endif
+        ret._width=area.width;
+        ret._height=area.height;
+        ret._origin=_origin+point(area.x,area.y);
+        return ret;
+    }
+
+    color get_pixel(int x,int y)const
+    {
+        const int i=x+y*stride();
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+        const uint8_t* d=data()+i;
+        return color(d[_plane_stride*2],d[_plane_stride],d[0],d[_plane_stride*3]);
+#else
+        return ((const color*)data())[i];
+#endif
+    }
+
+    /// \brief Copies the viewed pixels into a new image.
+    image copy()const;
+    /// \brief Returns a scaled copy of the viewed pixels, see image::resized_linear().
+    image scaled(int w,int h)const;
+    /// \brief Returns a scaled copy of the viewed pixels, see image::resized_linear().
+    image scaled(lfgui::point p)const{return scaled(p.x,p.y);}
+
+private:
+    const uint8_t* _data=nullptr;
+    int _width=0;
+    int _height=0;
+    int _stride=0;
+    int _plane_stride=0;
+    const image* _source=nullptr;
+    point _origin;
 };
 
 }   // namespace lfgui
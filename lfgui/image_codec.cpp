@@ -0,0 +1,786 @@
+#include "image_codec.h"
+#include "pixel_conversion.h"
+
+#include <fstream>
+#include <iterator>
+#include <cctype>
+#include <cstdlib>
+#include <climits>
+
+namespace lfgui
+{
+
+namespace
+{
+
+/// \brief Returns true if an image of the given size may be decoded. Larger images are rejected before anything is
+/// allocated for them: a few bytes of header could otherwise request gigabytes, and image::count()*4 has to fit into
+/// an int.
+bool valid_image_size(uint32_t width,uint32_t height)
+{
+    static_assert((size_t(1)<<28)<=INT_MAX/4,"count()*4 of the largest image has to fit into an int");
+    return width>0&&height>0&&width<=(1<<16)&&height<=(1<<16)&&size_t(width)*height<=(size_t(1)<<28);
+}
+
+uint32_t read_be32(const uint8_t* p)
+{
+    return (uint32_t(p[0])<<24)|(uint32_t(p[1])<<16)|(uint32_t(p[2])<<8)|uint32_t(p[3]);
+}
+
+void write_be32(std::vector<uint8_t>& out,uint32_t v)
+{
+    out.push_back(v>>24);
+    out.push_back(v>>16);
+    out.push_back(v>>8);
+    out.push_back(v);
+}
+
+// ---- inflate (RFC 1950/1951), based on the canonical Huffman decoding of zlib's puff.c ----
+
+struct bit_reader
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    uint32_t buffer=0;
+    int count=0;
+    bool overflow=false;
+
+    bit_reader(const uint8_t* p,const uint8_t* end) : p(p),end(end){}
+
+    int bits(int n)
+    {
+        while(count<n)
+        {
+            if(p==end)
+            {
+                overflow=true;
+                return 0;
+            }
+            buffer|=uint32_t(*p++)<<count;
+            count+=8;
+        }
+        int ret=buffer&((1u<<n)-1);
+        buffer>>=n;
+        count-=n;
+        return ret;
+    }
+
+    /// \brief Drops the remaining bits of the current byte.
+    void align(){buffer=0;count=0;}
+};
+
+struct huffman
+{
+    short count[16];    // number of codes per length
+    short symbol[288];  // symbols ordered by code
+};
+
+/// \brief Builds the decoding tables from the code lengths. Returns false on an over-subscribed code.
+bool build_huffman(huffman& h,const short* lengths,int n)
+{
+    std::fill(h.count,h.count+16,0);
+    for(int i=0;i<n;i++)
+        h.count[lengths[i]]++;
+    if(h.count[0]==n)
+        return true;
+
+    int left=1;
+    for(int len=1;len<16;len++)
+    {
+        left<<=1;
+        left-=h.count[len];
+        if(left<0)
+            return false;
+    }
+
+    short offsets[16];
+    offsets[1]=0;
+    for(int len=1;len<15;len++)
+        offsets[len+1]=offsets[len]+h.count[len];
+    for(int i=0;i<n;i++)
+        if(lengths[i])
+            h.symbol[offsets[lengths[i]]++]=i;
+    return true;
+}
+
+int decode_symbol(bit_reader& br,const huffman& h)
+{
+    int code=0;
+    int first=0;
+    int index=0;
+    for(int len=1;len<16;len++)
+    {
+        code|=br.bits(1);
+        int count=h.count[len];
+        if(code-count<first)
+            return h.symbol[index+(code-first)];
+        index+=count;
+        first+=count;
+        first<<=1;
+        code<<=1;
+        if(br.overflow)
+            return -1;
+    }
+    return -1;
+}
+
+bool inflate_codes(bit_reader& br,std::vector<uint8_t>& out,size_t max_size,const huffman& lencode,
+                   const huffman& distcode)
+{
+    static const short length_base[29]={3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+    static const short length_extra[29]={0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+    static const short dist_base[30]={1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,
+                                      4097,6145,8193,12289,16385,24577};
+    static const short dist_extra[30]={0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+    for(;;)
+    {
+        int symbol=decode_symbol(br,lencode);
+        if(symbol<0||br.overflow)
+            return false;
+        if(symbol<256)
+        {
+            if(out.size()>=max_size)
+                return false;
+            out.push_back(symbol);
+        }
+        else if(symbol==256)
+            return true;
+        else
+        {
+            symbol-=257;
+            if(symbol>=29)
+                return false;
+            int len=length_base[symbol]+br.bits(length_extra[symbol]);
+            symbol=decode_symbol(br,distcode);
+            if(symbol<0||symbol>=30)
+                return false;
+            size_t dist=dist_base[symbol]+br.bits(dist_extra[symbol]);
+            if(br.overflow||dist>out.size()||size_t(len)>max_size-out.size())
+                return false;
+            size_t from=out.size()-dist;
+            for(int i=0;i<len;i++)  // may overlap, so byte by byte
+                out.push_back(out[from+i]);
+        }
+    }
+}
+
+/// Fails if the stream holds more than max_size bytes, so a small stream can't make it allocate without limit.
+bool inflate_zlib(const uint8_t* data,size_t size,std::vector<uint8_t>& out,size_t max_size)
+{
+    if(size<2||(data[0]&0x0F)!=8||((data[0]<<8)|data[1])%31!=0||(data[1]&0x20))
+        return false;
+    bit_reader br(data+2,data+size);
+
+    // built once, the initialization of a local static is thread-safe
+    static const struct fixed_codes
+    {
+        huffman lencode;
+        huffman distcode;
+        fixed_codes()
+        {
+            short lengths[288];
+            int i=0;
+            for(;i<144;i++) lengths[i]=8;
+            for(;i<256;i++) lengths[i]=9;
+            for(;i<280;i++) lengths[i]=7;
+            for(;i<288;i++) lengths[i]=8;
+            build_huffman(lencode,lengths,288);
+            for(i=0;i<30;i++) lengths[i]=5;
+            build_huffman(distcode,lengths,30);
+        }
+    } fixed;
+
+    int last;
+    do
+    {
+        last=br.bits(1);
+        int type=br.bits(2);
+        if(br.overflow)
+            return false;
+        if(type==0)         // stored
+        {
+            br.align();
+            if(br.end-br.p<4)
+                return false;
+            unsigned len=br.p[0]|(br.p[1]<<8);
+            unsigned nlen=br.p[2]|(br.p[3]<<8);
+            br.p+=4;
+            if(len!=(~nlen&0xFFFF)||size_t(br.end-br.p)<len||len>max_size-out.size())
+                return false;
+            out.insert(out.end(),br.p,br.p+len);
+            br.p+=len;
+        }
+        else if(type==1)    // fixed Huffman codes
+        {
+            if(!inflate_codes(br,out,max_size,fixed.lencode,fixed.distcode))
+                return false;
+        }
+        else if(type==2)    // dynamic Huffman codes
+        {
+            static const short order[19]={16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+            int nlen=br.bits(5)+257;
+            int ndist=br.bits(5)+1;
+            int ncode=br.bits(4)+4;
+            if(nlen>286||ndist>30)
+                return false;
+
+            short lengths[320]={0};
+            for(int i=0;i<ncode;i++)
+                lengths[order[i]]=br.bits(3);
+            huffman lencode,distcode;
+            if(!build_huffman(lencode,lengths,19))
+                return false;
+
+            int index=0;
+            while(index<nlen+ndist)
+            {
+                int symbol=decode_symbol(br,lencode);
+                if(symbol<0)
+                    return false;
+                if(symbol<16)
+                {
+                    lengths[index++]=symbol;
+                    continue;
+                }
+                short len=0;
+                int repeat;
+                if(symbol==16)
+                {
+                    if(index==0)
+                        return false;
+                    len=lengths[index-1];
+                    repeat=3+br.bits(2);
+                }
+                else if(symbol==17)
+                    repeat=3+br.bits(3);
+                else
+                    repeat=11+br.bits(7);
+                if(index+repeat>nlen+ndist)
+                    return false;
+                while(repeat--)
+                    lengths[index++]=len;
+            }
+            if(lengths[256]==0||br.overflow)
+                return false;
+            if(!build_huffman(lencode,lengths,nlen)||!build_huffman(distcode,lengths+nlen,ndist))
+                return false;
+            if(!inflate_codes(br,out,max_size,lencode,distcode))
+                return false;
+        }
+        else
+            return false;
+    }
+    while(!last);
+    return true;
+}
+
+// ---- PNG ----
+
+int paeth(int a,int b,int c)
+{
+    int p=a+b-c;
+    int pa=std::abs(p-a);
+    int pb=std::abs(p-b);
+    int pc=std::abs(p-c);
+    if(pa<=pb&&pa<=pc)
+        return a;
+    if(pb<=pc)
+        return b;
+    return c;
+}
+
+/// \brief Reverses the PNG row filters in place. Each row starts with its filter type byte.
+bool png_unfilter(uint8_t* data,int stride,int rows,int bpp)
+{
+    uint8_t* prior=0;
+    for(int y=0;y<rows;y++)
+    {
+        int filter=data[0];
+        uint8_t* row=data+1;
+        switch(filter)
+        {
+        case 0:
+            break;
+        case 1:
+            for(int i=bpp;i<stride;i++)
+                row[i]+=row[i-bpp];
+            break;
+        case 2:
+            if(prior)
+                for(int i=0;i<stride;i++)
+                    row[i]+=prior[i];
+            break;
+        case 3:
+            for(int i=0;i<stride;i++)
+                row[i]+=((i>=bpp?row[i-bpp]:0)+(prior?prior[i]:0))/2;
+            break;
+        case 4:
+            for(int i=0;i<stride;i++)
+                row[i]+=paeth(i>=bpp?row[i-bpp]:0,prior?prior[i]:0,(prior&&i>=bpp)?prior[i-bpp]:0);
+            break;
+        default:
+            return false;
+        }
+        prior=row;
+        data+=stride+1;
+    }
+    return true;
+}
+
+/// \brief Returns the index-th raw sample of a row with the given bit depth.
+int png_sample(const uint8_t* row,int index,int depth)
+{
+    if(depth==8)
+        return row[index];
+    if(depth==16)
+        return (row[index*2]<<8)|row[index*2+1];
+    int bit=index*depth;
+    return (row[bit>>3]>>(8-depth-(bit&7)))&((1<<depth)-1);
+}
+
+bool decode_png(const uint8_t* data,size_t size,image& img)
+{
+    static const uint8_t signature[8]={137,80,78,71,13,10,26,10};
+    if(size<8||!std::equal(signature,signature+8,data))
+        return false;
+
+    uint32_t width=0,height=0;
+    int depth=0,color_type=0,interlace=0;
+    uint8_t palette[256*4];
+    std::fill(palette,palette+sizeof(palette),255);
+    bool has_key=false;
+    int key[3]={0,0,0};     // transparent color for grey and RGB images
+    std::vector<uint8_t> compressed;
+
+    const uint8_t* p=data+8;
+    const uint8_t* end=data+size;
+    while(end-p>=12)
+    {
+        uint32_t len=read_be32(p);
+        const uint8_t* type=p+4;
+        const uint8_t* chunk=p+8;
+        if(len>0x7FFFFFFF||size_t(end-chunk)<4||len>size_t(end-chunk)-4)     // the maximum by the PNG specification
+            return false;
+        p=chunk+len+4;     // skip the CRC
+
+        if(std::equal(type,type+4,"IHDR"))
+        {
+            if(len<13)
+                return false;
+            width=read_be32(chunk);
+            height=read_be32(chunk+4);
+            depth=chunk[8];
+            color_type=chunk[9];
+            interlace=chunk[12];
+        }
+        else if(std::equal(type,type+4,"PLTE"))
+        {
+            for(uint32_t i=0;i<len/3&&i<256;i++)
+            {
+                palette[i*4]=chunk[i*3];
+                palette[i*4+1]=chunk[i*3+1];
+                palette[i*4+2]=chunk[i*3+2];
+            }
+        }
+        else if(std::equal(type,type+4,"tRNS"))
+        {
+            if(color_type==3)
+                for(uint32_t i=0;i<len&&i<256;i++)
+                    palette[i*4+3]=chunk[i];
+            else if(color_type==0&&len>=2)
+            {
+                has_key=true;
+                key[0]=(chunk[0]<<8)|chunk[1];
+            }
+            else if(color_type==2&&len>=6)
+            {
+                has_key=true;
+                for(int i=0;i<3;i++)
+                    key[i]=(chunk[i*2]<<8)|chunk[i*2+1];
+            }
+        }
+        else if(std::equal(type,type+4,"IDAT"))
+            compressed.insert(compressed.end(),chunk,chunk+len);
+        else if(std::equal(type,type+4,"IEND"))
+            break;
+    }
+
+    int channels;
+    switch(color_type)
+    {
+    case 0: channels=1; break;
+    case 2: channels=3; break;
+    case 3: channels=1; break;
+    case 4: channels=2; break;
+    case 6: channels=4; break;
+    default: return false;
+    }
+    // the allowed bit depths per color type, see the IHDR table of the PNG specification
+    bool depth_valid;
+    switch(color_type)
+    {
+    case 0: depth_valid=depth==1||depth==2||depth==4||depth==8||depth==16; break;
+    case 3: depth_valid=depth==1||depth==2||depth==4||depth==8; break;
+    default: depth_valid=depth==8||depth==16; break;
+    }
+    if(!valid_image_size(width,height)||interlace>1||!depth_valid)
+        return false;
+
+    const int bits_per_pixel=channels*depth;
+    // Adam7 passes, a non-interlaced image is a single pass over all pixel
+    static const int start_x[7]={0,4,0,2,0,1,0};
+    static const int start_y[7]={0,0,4,0,2,0,1};
+    static const int step_x[7]={8,8,4,4,2,2,1};
+    static const int step_y[7]={8,8,8,4,4,2,2};
+    const int passes=interlace?7:1;
+
+    size_t expected=0;     // the filtered rows of all passes, each with its filter byte
+    for(int pass=0;pass<passes;pass++)
+    {
+        int pw=interlace?(int(width)-start_x[pass]+step_x[pass]-1)/step_x[pass]:int(width);
+        int ph=interlace?(int(height)-start_y[pass]+step_y[pass]-1)/step_y[pass]:int(height);
+        if(pw>0&&ph>0)
+            expected+=(size_t(pw)*bits_per_pixel+7)/8*ph+ph;
+    }
+    if(expected>compressed.size()*1032+1024)     // more than deflate can expand to, no need to try
+        return false;
+    std::vector<uint8_t> raw;
+    raw.reserve(expected);
+    if(!inflate_zlib(compressed.data(),compressed.size(),raw,expected))
+        return false;
+
+    const int bpp=std::max(1,bits_per_pixel/8);
+    const int max_value=(1<<depth)-1;
+    std::vector<uint8_t> rgba(size_t(width)*height*4);
+
+    size_t offset=0;
+    for(int pass=0;pass<passes;pass++)
+    {
+        int sx=interlace?start_x[pass]:0;
+        int sy=interlace?start_y[pass]:0;
+        int dx=interlace?step_x[pass]:1;
+        int dy=interlace?step_y[pass]:1;
+        int pw=(int(width)-sx+dx-1)/dx;
+        int ph=(int(height)-sy+dy-1)/dy;
+        if(pw<=0||ph<=0)
+            continue;
+        int stride=(pw*bits_per_pixel+7)/8;
+        if(raw.size()-offset<size_t(stride+1)*ph)
+            return false;
+        uint8_t* rows=raw.data()+offset;
+        if(!png_unfilter(rows,stride,ph,bpp))
+            return false;
+        offset+=size_t(stride+1)*ph;
+
+        for(int y=0;y<ph;y++)
+        {
+            const uint8_t* row=rows+size_t(stride+1)*y+1;
+            uint8_t* target=rgba.data()+((size_t(sy)+y*dy)*width+sx)*4;
+            for(int x=0;x<pw;x++,target+=dx*4)
+            {
+                if(color_type==3)
+                {
+                    const uint8_t* c=palette+png_sample(row,x,depth)*4;
+                    std::copy(c,c+4,target);
+                    continue;
+                }
+                int s[4];
+                for(int c=0;c<channels;c++)
+                    s[c]=png_sample(row,x*channels+c,depth);
+                auto to8=[&](int v){return uint8_t(depth==16?v>>8:depth==8?v:v*255/max_value);};
+                if(channels<=2)
+                {
+                    target[0]=target[1]=target[2]=to8(s[0]);
+                    target[3]=channels==2?to8(s[1]):(has_key&&s[0]==key[0]?0:255);
+                }
+                else
+                {
+                    target[0]=to8(s[0]);
+                    target[1]=to8(s[1]);
+                    target[2]=to8(s[2]);
+                    if(channels==4)
+                        target[3]=to8(s[3]);
+                    else
+                        target[3]=(has_key&&s[0]==key[0]&&s[1]==key[1]&&s[2]==key[2])?0:255;
+                }
+            }
+        }
+    }
+
+    img=image(width,height);
+    convert_from_rgba(rgba.data(),width*4,img,rect(0,0,width,height));
+    return true;
+}
+
+// ---- QOI ----
+
+struct qoi_pixel
+{
+    uint8_t r=0,g=0,b=0,a=255;
+    bool operator==(const qoi_pixel& o)const{return r==o.r&&g==o.g&&b==o.b&&a==o.a;}
+    int hash()const{return (r*3+g*5+b*7+a*11)%64;}
+};
+
+bool decode_qoi(const uint8_t* data,size_t size,image& img)
+{
+    if(size<14+8||!std::equal(data,data+4,"qoif"))
+        return false;
+    uint32_t width=read_be32(data+4);
+    uint32_t height=read_be32(data+8);
+    // a byte of the stream decodes to at most 62 pixels (a run), a short file can't describe a large image
+    if(!valid_image_size(width,height)||size_t(width)*height>(size-14-8)*62)
+        return false;
+
+    std::vector<uint8_t> rgba(size_t(width)*height*4);
+    qoi_pixel index[64];
+    qoi_pixel px;
+    const uint8_t* p=data+14;
+    const uint8_t* end=data+size-8;   // end marker
+    int run=0;
+    for(size_t i=0;i<rgba.size();i+=4)
+    {
+        if(run>0)
+            run--;
+        else if(p<end)
+        {
+            int b1=*p++;
+            if(b1==0xFE)
+            {
+                if(end-p<3) return false;
+                px.r=p[0];px.g=p[1];px.b=p[2];
+                p+=3;
+            }
+            else if(b1==0xFF)
+            {
+                if(end-p<4) return false;
+                px.r=p[0];px.g=p[1];px.b=p[2];px.a=p[3];
+                p+=4;
+            }
+            else if((b1&0xC0)==0x00)
+                px=index[b1];
+            else if((b1&0xC0)==0x40)
+            {
+                px.r+=((b1>>4)&0x03)-2;
+                px.g+=((b1>>2)&0x03)-2;
+                px.b+=(b1&0x03)-2;
+            }
+            else if((b1&0xC0)==0x80)
+            {
+                if(p==end) return false;
+                int b2=*p++;
+                int vg=(b1&0x3F)-32;
+                px.r+=vg-8+((b2>>4)&0x0F);
+                px.g+=vg;
+                px.b+=vg-8+(b2&0x0F);
+            }
+            else
+                run=b1&0x3F;
+            index[px.hash()]=px;
+        }
+        rgba[i]=px.r;
+        rgba[i+1]=px.g;
+        rgba[i+2]=px.b;
+        rgba[i+3]=px.a;
+    }
+
+    img=image(width,height);
+    convert_from_rgba(rgba.data(),width*4,img,rect(0,0,width,height));
+    return true;
+}
+
+// ---- PPM / PGM ----
+
+/// \brief Reads the next number of a PNM header, skipping whitespace and comments.
+bool pnm_number(const uint8_t*& p,const uint8_t* end,int& value)
+{
+    for(;;)
+    {
+        while(p<end&&isspace(*p))
+            p++;
+        if(p<end&&*p=='#')
+            while(p<end&&*p!='\n')
+                p++;
+        else
+            break;
+    }
+    if(p==end||!isdigit(*p))
+        return false;
+    value=0;
+    while(p<end&&isdigit(*p)&&value<(1<<20))
+        value=value*10+(*p++-'0');
+    return true;
+}
+
+bool decode_ppm(const uint8_t* data,size_t size,image& img)
+{
+    if(size<3||data[0]!='P'||(data[1]!='5'&&data[1]!='6'))
+        return false;
+    const int channels=data[1]=='6'?3:1;
+    const uint8_t* p=data+2;
+    const uint8_t* end=data+size;
+    int width,height,max_value;
+    if(!pnm_number(p,end,width)||!pnm_number(p,end,height)||!pnm_number(p,end,max_value))
+        return false;
+    if(width<=0||height<=0||!valid_image_size(width,height)||max_value<=0||max_value>65535||p==end)
+        return false;
+    p++;    // single whitespace after the header
+
+    const int bytes=max_value>255?2:1;
+    const size_t count=size_t(width)*height;
+    if(size_t(end-p)<count*channels*bytes)
+        return false;
+
+    std::vector<uint8_t> samples(count*channels);
+    for(size_t i=0;i<samples.size();i++)
+    {
+        int v=bytes==2?(p[i*2]<<8)|p[i*2+1]:p[i];
+        samples[i]=max_value==255?v:v*255/max_value;
+    }
+    std::vector<uint8_t> rgba(count*4);
+    expand_to_rgba(samples.data(),channels,rgba.data(),count);
+
+    img=image(width,height);
+    convert_from_rgba(rgba.data(),width*4,img,rect(0,0,width,height));
+    return true;
+}
+
+std::vector<uint8_t> to_rgba(const image& img)
+{
+    std::vector<uint8_t> rgba(size_t(img.count())*4);
+    if(img.count())
+        convert_to_rgba(img,rect(0,0,img.width(),img.height()),rgba.data(),img.width()*4);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+    unpremultiply_alpha(rgba.data(),img.count());   // files store straight alpha
+#endif
+    return rgba;
+}
+
+bool ends_with(const std::string& str,const std::string& end)
+{
+    if(str.size()<end.size())
+        return false;
+    for(size_t i=0;i<end.size();i++)
+        if(tolower(str[str.size()-end.size()+i])!=end[i])
+            return false;
+    return true;
+}
+
+}   // namespace
+
+bool decode_image(const uint8_t* data,size_t size,image& img)
+{
+    if(size>=8&&data[0]==137&&data[1]=='P'&&data[2]=='N'&&data[3]=='G')
+        return decode_png(data,size,img);
+    if(size>=4&&std::equal(data,data+4,"qoif"))
+        return decode_qoi(data,size,img);
+    if(size>=2&&data[0]=='P')
+        return decode_ppm(data,size,img);
+    return false;
+}
+
+image load_image_file(const std::string& path)
+{
+    std::ifstream file(path,std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+    image img;
+    if(!file.is_open()||!decode_image(data.data(),data.size(),img))
+    {
+        std::cerr<<"LFGUI Error: The image \""<<path<<"\" could not be loaded."<<std::endl;
+        return lfgui::image(1,1);
+    }
+    return img;
+}
+
+std::vector<uint8_t> encode_qoi(const image& img)
+{
+    std::vector<uint8_t> rgba=to_rgba(img);
+    std::vector<uint8_t> out;
+    out.reserve(14+rgba.size()/2+8);
+    out.insert(out.end(),{'q','o','i','f'});
+    write_be32(out,img.width());
+    write_be32(out,img.height());
+    out.push_back(4);   // channels
+    out.push_back(0);   // sRGB with linear alpha
+
+    qoi_pixel index[64];
+    qoi_pixel prev;
+    int run=0;
+    for(size_t i=0;i<rgba.size();i+=4)
+    {
+        qoi_pixel px;
+        px.r=rgba[i];px.g=rgba[i+1];px.b=rgba[i+2];px.a=rgba[i+3];
+        if(px==prev)
+        {
+            run++;
+            if(run==62||i+4==rgba.size())
+            {
+                out.push_back(0xC0|(run-1));
+                run=0;
+            }
+            continue;
+        }
+        if(run>0)
+        {
+            out.push_back(0xC0|(run-1));
+            run=0;
+        }
+
+        int h=px.hash();
+        if(index[h]==px)
+            out.push_back(h);
+        else
+        {
+            index[h]=px;
+            if(px.a==prev.a)
+            {
+                int vr=int8_t(px.r-prev.r);
+                int vg=int8_t(px.g-prev.g);
+                int vb=int8_t(px.b-prev.b);
+                int vg_r=vr-vg;
+                int vg_b=vb-vg;
+                if(vr>-3&&vr<2&&vg>-3&&vg<2&&vb>-3&&vb<2)
+                    out.push_back(0x40|((vr+2)<<4)|((vg+2)<<2)|(vb+2));
+                else if(vg_r>-9&&vg_r<8&&vg>-33&&vg<32&&vg_b>-9&&vg_b<8)
+                {
+                    out.push_back(0x80|(vg+32));
+                    out.push_back(((vg_r+8)<<4)|(vg_b+8));
+                }
+                else
+                    out.insert(out.end(),{0xFE,px.r,px.g,px.b});
+            }
+            else
+                out.insert(out.end(),{0xFF,px.r,px.g,px.b,px.a});
+        }
+        prev=px;
+    }
+    out.insert(out.end(),{0,0,0,0,0,0,0,1});
+    return out;
+}
+
+std::vector<uint8_t> encode_ppm(const image& img)
+{
+    std::vector<uint8_t> rgba=to_rgba(img);
+    std::string header="P6\n"+std::to_string(img.width())+" "+std::to_string(img.height())+"\n255\n";
+    std::vector<uint8_t> out(header.begin(),header.end());
+    out.reserve(header.size()+size_t(img.count())*3);
+    for(size_t i=0;i<rgba.size();i+=4)
+        out.insert(out.end(),&rgba[i],&rgba[i]+3);
+    return out;
+}
+
+bool save_image(const image& img,const std::string& path)
+{
+    std::vector<uint8_t> data;
+    if(ends_with(path,".qoi"))
+        data=encode_qoi(img);
+    else if(ends_with(path,".ppm"))
+        data=encode_ppm(img);
+    else
+        return false;
+    std::ofstream file(path,std::ios::binary);
+    file.write((const char*)data.data(),data.size());
+    return bool(file);
+}
+
+}   // namespace lfgui
@@ -0,0 +1,34 @@
+#ifndef LFGUI_IMAGE_CODEC_H
+#define LFGUI_IMAGE_CODEC_H
+
+#include <vector>
+#include <string>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief Decodes a PNG, QOI or PPM/PGM (binary P6/P5) image from memory. The format is detected by the file header.
+/// PNG supports all color types and bit depths, interlacing and transparency (tRNS). 16 bit channels are reduced to
+/// 8 bit. Returns false if the data could not be decoded, img is unchanged in that case.
+/// This is a small self-contained decoder used by wrappers that can't load images themselves (see wrapper_headless).
+bool decode_image(const uint8_t* data,size_t size,image& img);
+
+/// \brief Loads an image file with decode_image(). Fails like the other wrappers by printing an error to std::cerr and
+/// returning a 1x1 image. Can be used as image::load.
+image load_image_file(const std::string& path);
+
+/// \brief Encodes the image as QOI (https://qoiformat.org/) with four channels. Lossless and fast.
+std::vector<uint8_t> encode_qoi(const image& img);
+
+/// \brief Encodes the image as a binary PPM (P6). PPM has no alpha channel, the alpha is dropped.
+std::vector<uint8_t> encode_ppm(const image& img);
+
+/// \brief Saves the image as QOI or PPM, chosen by the file extension (".qoi" or ".ppm"). Returns false if the
+/// extension is unknown or the file could not be written.
+bool save_image(const image& img,const std::string& path);
+
+}   // namespace lfgui
+
+#endif // LFGUI_IMAGE_CODEC_H
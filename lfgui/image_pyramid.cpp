@@ -0,0 +1,163 @@
+#include "image_pyramid.h"
+#include "parallel.h"
+
+namespace lfgui
+{
+
+namespace
+{
+
+#ifndef LFGUI_SEPARATE_COLOR_CHANNELS
+/// \brief Averages the pixel pairs of the rows a and b (4 bytes per pixel) into length pixels of target. The last
+/// pixel is repeated if a row has an odd number of pixels.
+void halve_rows_packed(const uint8_t* a,const uint8_t* b,uint8_t* target,int source_width)
+{
+    const int length=(source_width+1)/2;
+    int x=0;
+#ifdef LFGUI_SSE2
+    const __m128i v0=_mm_setzero_si128();
+    const __m128i v2=_mm_set1_epi16(2);
+    for(;x+4<=source_width/2;x+=4)
+    {
+        __m128i a0=_mm_loadu_si128((const __m128i*)(a+x*8));
+        __m128i a1=_mm_loadu_si128((const __m128i*)(a+x*8+16));
+        __m128i b0=_mm_loadu_si128((const __m128i*)(b+x*8));
+        __m128i b1=_mm_loadu_si128((const __m128i*)(b+x*8+16));
+        // vertical sums of pixel 0,1 / 2,3 / 4,5 / 6,7 as 16 bit
+        __m128i v01=_mm_add_epi16(_mm_unpacklo_epi8(a0,v0),_mm_unpacklo_epi8(b0,v0));
+        __m128i v23=_mm_add_epi16(_mm_unpackhi_epi8(a0,v0),_mm_unpackhi_epi8(b0,v0));
+        __m128i v45=_mm_add_epi16(_mm_unpacklo_epi8(a1,v0),_mm_unpacklo_epi8(b1,v0));
+        __m128i v67=_mm_add_epi16(_mm_unpackhi_epi8(a1,v0),_mm_unpackhi_epi8(b1,v0));
+        // horizontal sums: even pixels plus odd pixels
+        __m128i s0=_mm_add_epi16(_mm_unpacklo_epi64(v01,v23),_mm_unpackhi_epi64(v01,v23));
+        __m128i s1=_mm_add_epi16(_mm_unpacklo_epi64(v45,v67),_mm_unpackhi_epi64(v45,v67));
+        s0=_mm_srli_epi16(_mm_add_epi16(s0,v2),2);
+        s1=_mm_srli_epi16(_mm_add_epi16(s1,v2),2);
+        _mm_storeu_si128((__m128i*)(target+x*4),_mm_packus_epi16(s0,s1));
+    }
+#endif
+    for(;x<length;x++)
+    {
+        const int x0=x*8;
+        const int x1=std::min(x*2+1,source_width-1)*4;
+        for(int c=0;c<4;c++)
+            target[x*4+c]=(a[x0+c]+a[x1+c]+b[x0+c]+b[x1+c]+2)>>2;
+    }
+}
+#else
+/// \brief Same as halve_rows_packed() for one plane with one byte per pixel.
+void halve_rows_planar(const uint8_t* a,const uint8_t* b,uint8_t* target,int source_width)
+{
+    const int length=(source_width+1)/2;
+    int x=0;
+#ifdef LFGUI_SSE2
+    const __m128i even=_mm_set1_epi16(0x00FF);
+    const __m128i v2=_mm_set1_epi16(2);
+    for(;x+16<=source_width/2;x+=16)
+    {
+        __m128i a0=_mm_loadu_si128((const __m128i*)(a+x*2));
+        __m128i a1=_mm_loadu_si128((const __m128i*)(a+x*2+16));
+        __m128i b0=_mm_loadu_si128((const __m128i*)(b+x*2));
+        __m128i b1=_mm_loadu_si128((const __m128i*)(b+x*2+16));
+        // the even and odd bytes as 16 bit values, added up to the sums of 2x2 pixels
+        __m128i s0=_mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0,even),_mm_srli_epi16(a0,8)),
+                                 _mm_add_epi16(_mm_and_si128(b0,even),_mm_srli_epi16(b0,8)));
+        __m128i s1=_mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1,even),_mm_srli_epi16(a1,8)),
+                                 _mm_add_epi16(_mm_and_si128(b1,even),_mm_srli_epi16(b1,8)));
+        s0=_mm_srli_epi16(_mm_add_epi16(s0,v2),2);
+        s1=_mm_srli_epi16(_mm_add_epi16(s1,v2),2);
+        _mm_storeu_si128((__m128i*)(target+x),_mm_packus_epi16(s0,s1));
+    }
+#endif
+    for(;x<length;x++)
+    {
+        const int x0=x*2;
+        const int x1=std::min(x*2+1,source_width-1);
+        target[x]=(a[x0]+a[x1]+b[x0]+b[x1]+2)>>2;
+    }
+}
+#endif
+
+}   // namespace
+
+image_pyramid::image_pyramid(const image& img)
+{
+    _levels.push_back(img.copy());
+    _build();
+}
+
+image_pyramid::image_pyramid(image&& img)
+{
+    _levels.push_back(std::move(img));
+    _build();
+}
+
+void image_pyramid::_build()
+{
+    if(_levels[0].count()<1)
+        return;
+    while(_levels.back().width()>1||_levels.back().height()>1)
+        _levels.push_back(halved(_levels.back()));
+}
+
+int image_pyramid::level_index(int w,int h)const
+{
+    int i=0;
+    while(i+1<levels()&&_levels[i+1].width()>=w&&_levels[i+1].height()>=h)
+        i++;
+    return i;
+}
+
+const image& image_pyramid::scaled(int w,int h)const
+{
+    if(_levels.empty()||w<1||h<1)
+    {
+        _cached=image();
+        _cached_level=-1;
+        return _cached;
+    }
+    const int i=level_index(w,h);
+    const image& l=_levels[i];
+    if(l.width()==w&&l.height()==h)
+        return l;
+    if(_cached_level!=i||_cached.width()!=w||_cached.height()!=h)
+    {
+        _cached=l.resized_linear(w,h);
+        _cached_level=i;
+    }
+    return _cached;
+}
+
+image image_pyramid::halved(const image& img)
+{
+    const int w=img.width();
+    const int h=img.height();
+    const size_t stride=img.stride();
+    image ret((w+1)/2,(h+1)/2);
+    if(!ret.count())
+        return ret;
+    const int rows_per_thread=std::max(1,(1<<16)/ret.width());
+    parallel_for(0,ret.height(),rows_per_thread,[&](int begin,int end)
+    {
+        for(int y=begin;y<end;y++)
+        {
+            const int y0=y*2;
+            const int y1=std::min(y*2+1,h-1);
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+            for(int plane=0;plane<4;plane++)
+            {
+                const uint8_t* s=img.const_data()+size_t(plane)*img.plane_stride();
+                uint8_t* t=ret.data()+size_t(plane)*ret.count();
+                halve_rows_planar(s+y0*stride,s+y1*stride,t+size_t(y)*ret.width(),w);
+            }
+#else
+            const uint8_t* s=(const uint8_t*)img.const_data();
+            uint8_t* t=(uint8_t*)ret.data();
+            halve_rows_packed(s+y0*stride*4,s+y1*stride*4,t+size_t(y)*ret.width()*4,w);
+#endif
+        }
+    });
+    return ret;
+}
+
+}   // namespace lfgui
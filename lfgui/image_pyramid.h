@@ -0,0 +1,60 @@
+#ifndef LFGUI_IMAGE_PYRAMID_H
+#define LFGUI_IMAGE_PYRAMID_H
+
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief An image together with box-filtered versions of half, quarter, ... of its size (mip levels), built once.
+/// Scaling an image down by a large factor with resize_linear() reads every source pixel. With a pyramid the level
+/// that is at most twice as large as the requested size is used as the source instead, so the cost of scaled()
+/// and draw() is proportional to the output size. Meant for images that are drawn at many or changing sizes, like
+/// large icons or thumbnails.
+///
+/// Example:
+/// \code
+/// lfgui::image_pyramid icon(lfgui::image("icon_2048.png"));
+/// ...
+/// icon.draw(target,10,10,32,32);
+/// \endcode
+class image_pyramid
+{
+    std::vector<image> _levels;
+    mutable image _cached;          ///< \brief the result of the last scaled(), reused when the size doesn't change
+    mutable int _cached_level=-1;
+
+public:
+    image_pyramid()=default;
+    /// \brief Builds the pyramid, keeps a copy of img as level 0.
+    explicit image_pyramid(const image& img);
+    /// \brief Builds the pyramid, takes img as level 0.
+    explicit image_pyramid(image&& img);
+
+    /// \brief Returns the number of levels. Level 0 is the original image, the last level is 1x1.
+    int levels()const{return int(_levels.size());}
+    /// \brief Returns the given level, the size of level i is the size of level i-1 halved and rounded up.
+    const image& level(int i)const{return _levels[i];}
+    /// \brief Returns the smallest level that is at least as large as w x h in both dimensions, level 0 when
+    /// enlarging.
+    int level_index(int w,int h)const;
+
+    /// \brief Returns the image scaled to w x h: the level chosen with level_index() scaled with resize_linear().
+    /// The result of the last call is cached, so asking for the same size again costs nothing.
+    const image& scaled(int w,int h)const;
+    /// \brief Draws the image scaled to w x h at x,y into target (see scaled()).
+    void draw(image& target,int x,int y,int w,int h)const{target.draw_image(x,y,scaled(w,h));}
+
+    /// \brief Returns an image with half the size (rounded up) where every pixel is the average of 2x2 pixels of img.
+    /// A missing last column or row of images with an odd size is replaced by the one before.
+    static image halved(const image& img);
+
+private:
+    void _build();
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_IMAGE_PYRAMID_H
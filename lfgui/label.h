@@ -36,11 +36,11 @@ public:
     label(const std::string& text,int text_size) : label(0,0,100,20,text,{0,0,0},text_size){}
 
     std::string text(){return _text;}
-    void set_text(const std::string& t){_text=t;}
+    void set_text(const std::string& t){_text=t;set_dirty();}
     color text_color(){return _text_color;}
-    void set_text_color(color c){_text_color=c;}
+    void set_text_color(color c){_text_color=c;set_dirty();}
     int text_size(){return _text_size;}
-    void set_text_size(int s){_text_size=s;}
+    void set_text_size(int s){_text_size=s;set_dirty();}
 };
 
 }   // namespace lfgui
@@ -38,7 +38,7 @@ bool widget::_insert_event_mouse_press(const event_mouse& event)
         }
         if(on_mouse_press)
         {
-            dirty=true;
+            set_dirty();
             ret=on_mouse_press.call(event);
         }
     }
@@ -60,7 +60,7 @@ bool widget::_insert_event_mouse_release(const event_mouse& event)
     {
         if(on_mouse_release)
         {
-            dirty=true;
+            set_dirty();
             ret=on_mouse_release.call(event);
         }
         ret=true;
@@ -68,13 +68,13 @@ bool widget::_insert_event_mouse_release(const event_mouse& event)
 
     if(_gui->_held_widget&&_gui->_held_widget==_gui->_hovering_over_widget)
     {
-        _gui->_held_widget->dirty=true;
+        _gui->_held_widget->set_dirty();
         _gui->_held_widget->on_mouse_click.call(event.translated(to_global(point(0,0))).translated(_gui->_held_widget->to_local(point(0,0))));
     }
 
     if(_gui->_held_widget)
     {
-        _gui->_held_widget->dirty=true;
+        _gui->_held_widget->set_dirty();
         _gui->_held_widget->on_mouse_click_somewhere.call(event.translated(to_global(point(0,0))).translated(_gui->_held_widget->to_local(point(0,0))));
     }
 
@@ -89,7 +89,7 @@ bool widget::_insert_event_mouse_move(const event_mouse& event)
     if(_gui->_held_widget)
         if(_gui->_held_widget->on_mouse_drag)
         {
-            _gui->_held_widget->dirty=true;
+            _gui->_held_widget->set_dirty();
             _gui->_held_widget->on_mouse_drag.call(event.translated(to_global(point(0,0))).translated(_gui->_held_widget->to_local(point(0,0))));
             return true;
         }
@@ -106,7 +106,7 @@ bool widget::_insert_event_mouse_move(const event_mouse& event)
     {
         if(on_mouse_move)
         {
-            dirty=true;
+            set_dirty();
             on_mouse_move.call(event);
         }
         return true;
@@ -132,7 +132,7 @@ bool widget::_insert_event_mouse_wheel(const event_mouse& event)
     {
         if(on_mouse_wheel)
         {
-            dirty=true;
+            set_dirty();
             on_mouse_wheel.call(event);
         }
         return true;
@@ -144,7 +144,7 @@ void widget::_insert_event_key_press(const event_key& event)
 {
     if(_gui->_focus_widget)
     {
-        _gui->_focus_widget->dirty=true;
+        _gui->_focus_widget->set_dirty();
         _gui->_focus_widget->on_key_press.call(event);
     }
 }
@@ -153,7 +153,7 @@ void widget::_insert_event_key_release(const event_key& event)
 {
     if(_gui->_focus_widget)
     {
-        _gui->_focus_widget->dirty=true;
+        _gui->_focus_widget->set_dirty();
         _gui->_focus_widget->on_key_release.call(event);
     }
 }
@@ -164,22 +164,64 @@ void widget::resize(int width,int height)
     height_=height;
     for(auto& e:children)
         e->update_geometry();
-    dirty=true;
+    set_dirty();
 }
 
 void widget::redraw(image& img,int offset_x,int offset_y)
 {
+    if(_gui==this)
+    {
+        _gui->process_posted();
+        _gui->_damage.clear();
+        _gui->_painted.clear();
+        asset_loader::global().poll();
+        std::vector<lfgui::rect> occluders;
+        _find_occluded(offset_x,offset_y,occluders);
+    }
+
     if(!visible())
+    {
+        if(_dirty&&_gui)   // just hidden, the area it covered has changed
+            _gui->add_damage(_drawn_rect);
+        _drawn_rect=lfgui::rect();
+        _redraw_damaged=false;
+        _clear_dirty();
         return;
+    }
     STK_STACKTRACE
 
+    // A widget is repainted completely if it is dirty itself or its parent has been repainted. The old and the new area
+    // are damaged (the widget could have moved). Areas inside of a damaged parent are already covered by the parent.
+    lfgui::rect drawn(offset_x,offset_y,width(),height());
+    bool parent_damaged=parent&&parent->_redraw_damaged;
+    _redraw_damaged=_dirty||parent_damaged;
+    if(_redraw_damaged&&_gui)
+    {
+        if(!parent_damaged||!parent->_drawn_rect.contains(_drawn_rect))
+            _gui->add_damage(_drawn_rect);
+        if(!parent_damaged||!parent->_drawn_rect.contains(drawn))
+            _gui->add_damage(drawn);
+    }
+    _drawn_rect=drawn;
+    // cleared before painting, so that set_dirty() calls made during this frame (an animation restarting itself in
+    // on_paint, a sibling drawn already) are kept for the next one
+    _dirty=false;
+    _dirty_descendant=false;
+
     if(size()!=size_old&&on_resize)
         on_resize.call(size());
     size_old=size();
 
-    // draw this
-    if(on_paint)
-        on_paint.call(event_paint(img,offset_x,offset_y,*this));
+    // draw this, unless widgets drawn later cover it
+    if(_backdrop_blur>0&&!_occluded)
+        gaussian_blur(img,drawn,_backdrop_blur);
+    if(on_paint&&!_occluded)
+    {
+        if(_gui&&_gui->_paint_profiling)
+            _paint_profiled(img,offset_x,offset_y);
+        else
+            on_paint.call(event_paint(img,offset_x,offset_y,*this));
+    }
 
     // draw children
     for(std::unique_ptr<widget>& e:children)
@@ -188,11 +230,147 @@ void widget::redraw(image& img,int offset_x,int offset_y)
         e->redraw(img,p.x,p.y);
     }
 
-    dirty=false;
-    if(redraw_every_n_seconds)
+    if(_gui==this&&_gui->_paint_overlay)
+        _gui->_draw_paint_overlay(img);
+
+    if(_redraw_every_n_seconds)
         redraw_timer.reset();
 }
 
+namespace
+{
+
+/// \brief Returns true if r is completely inside the union of the given rectangles. The parts of r not covered yet
+/// are cut out one rectangle after the other, gives up (false) if they get too many.
+bool covered(const lfgui::rect& r,const std::vector<lfgui::rect>& rects)
+{
+    std::vector<lfgui::rect> rest(1,r);
+    std::vector<lfgui::rect> next;
+    for(const lfgui::rect& o:rects)
+    {
+        next.clear();
+        for(const lfgui::rect& e:rest)
+        {
+            const lfgui::rect i=e.intersected(o);
+            if(i.empty())
+            {
+                next.push_back(e);
+                continue;
+            }
+            if(i.top()>e.top())
+                next.push_back(lfgui::rect(e.x,e.y,e.width,i.top()-e.top()));
+            if(i.bottom()<e.bottom())
+                next.push_back(lfgui::rect(e.x,i.bottom(),e.width,e.bottom()-i.bottom()));
+            if(i.left()>e.left())
+                next.push_back(lfgui::rect(e.x,i.y,i.left()-e.left(),i.height));
+            if(i.right()<e.right())
+                next.push_back(lfgui::rect(i.right(),i.y,e.right()-i.right(),i.height));
+        }
+        rest.swap(next);
+        if(rest.empty())
+            return true;
+        if(rest.size()>32)
+            return false;
+    }
+    return false;
+}
+
+}   // namespace
+
+void widget::_find_occluded(int offset_x,int offset_y,std::vector<lfgui::rect>& occluders)
+{
+    if(!visible())
+        return;
+    for(auto it=children.rbegin();it!=children.rend();it++)
+    {
+        point p=(*it)->geometry.calc_pos(width(),height())+point(offset_x,offset_y);
+        (*it)->_find_occluded(p.x,p.y,occluders);
+    }
+    _occluded=!occluders.empty()&&covered(lfgui::rect(offset_x,offset_y,width(),height()),occluders);
+    lfgui::rect o=opaque_rect();
+    if(!o.empty())
+        occluders.push_back(lfgui::rect(o.x+offset_x,o.y+offset_y,o.width,o.height));
+}
+
+void widget::_paint_profiled(image& img,int offset_x,int offset_y)
+{
+    image::draw_statistics statistics;
+    image::draw_statistics* statistics_outer=image::statistics;
+    image::statistics=&statistics;
+    auto start=std::chrono::steady_clock::now();
+    on_paint.call(event_paint(img,offset_x,offset_y,*this));
+    double seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    image::statistics=statistics_outer;
+
+    _paint_cost.paints++;
+    _paint_cost.seconds+=seconds;
+    _paint_cost.last_seconds=seconds;
+    _paint_cost.pixels+=statistics.pixels;
+    _paint_cost.draw_calls+=statistics.calls;
+    if(_gui->_paint_overlay)
+        _gui->_painted.emplace_back(_drawn_rect,seconds);
+}
+
+void widget::_collect_paint_costs(std::vector<paint_report_entry>& report)const
+{
+    if(_paint_cost.paints)
+        report.push_back(paint_report_entry{this,uid,_paint_cost});
+    for(auto& e:children)
+        e->_collect_paint_costs(report);
+}
+
+void widget::_reset_paint_costs()
+{
+    _paint_cost=paint_cost();
+    for(auto& e:children)
+        e->_reset_paint_costs();
+}
+
+void widget::_clear_dirty()
+{
+    _dirty=false;
+    if(!_dirty_descendant)
+        return;
+    _dirty_descendant=false;
+    for(auto& e:children)
+        e->_clear_dirty();
+}
+
+void widget::set_dirty()
+{
+    _dirty=true;
+    // Stop at the first parent that is already flagged, all parents above it are flagged as well.
+    for(widget* w=parent;w&&!w->_dirty_descendant;w=w->parent)
+        w->_dirty_descendant=true;
+}
+
+bool widget::need_redraw()
+{
+    if(_gui==this)
+    {
+        _gui->process_posted();
+        asset_loader::global().poll();
+    }
+    if(_gui)
+        for(widget* w:_gui->_timed_widgets)
+            if(!w->_dirty&&w->visible()&&w->_redraw_every_n_seconds<w->redraw_timer.until_now())
+                w->set_dirty();
+    return _dirty||_dirty_descendant;
+}
+
+void widget::set_redraw_every_n_seconds(float seconds)
+{
+    bool was_timed=_redraw_every_n_seconds!=0;
+    _redraw_every_n_seconds=seconds;
+    if(!_gui||was_timed==(seconds!=0))
+        return;
+    auto& timed=_gui->_timed_widgets;
+    if(seconds!=0)
+        timed.push_back(this);
+    else
+        timed.erase(std::remove(timed.begin(),timed.end(),this),timed.end());
+}
+
 widget* widget::_add_child(std::unique_ptr<widget>&& w)
 {
     if(_gui)
@@ -200,11 +378,38 @@ widget* widget::_add_child(std::unique_ptr<widget>&& w)
     children.emplace_back(std::move(w));
     std::unique_ptr<widget>& ret=children.back();
     ret->parent=this;
-    ret->_gui=_gui;
-    dirty=true;
+    ret->_set_gui(_gui);
+    ret->set_dirty();
+    set_dirty();
     return ret.get();
 }
 
+void widget::remove_child(widget* w)
+{
+    for(size_t i=0;i<children.size();i++)
+        if(children[i].get()==w)
+        {
+            if(_gui)
+                _gui->add_damage(w->_drawn_rect);
+            children.erase(children.begin()+i);
+            set_dirty();
+            return;
+        }
+}
+
+void widget::_set_gui(gui* g)
+{
+    if(g&&_redraw_every_n_seconds!=0)
+    {
+        auto& timed=g->_timed_widgets;
+        if(std::find(timed.begin(),timed.end(),this)==timed.end())
+            timed.push_back(this);
+    }
+    _gui=g;
+    for(auto& e:children)
+        e->_set_gui(g);
+}
+
 void widget::focus()
 {
     _gui->set_focus(this);
@@ -226,6 +431,11 @@ widget::~widget()
         _gui->_hovering_over_widget=0;
     if(_gui->_hovering_over_widget_old==this)
         _gui->_hovering_over_widget_old=0;
+    if(_redraw_every_n_seconds!=0&&_gui!=this)
+    {
+        auto& timed=_gui->_timed_widgets;
+        timed.erase(std::remove(timed.begin(),timed.end(),this),timed.end());
+    }
 }
 
 void widget::raise() const
@@ -242,6 +452,7 @@ void widget::raise() const
 
     for(;next!=parent->children.end();it++,next++)
         it->swap(*next);
+    parent->set_dirty();
 }
 
 bool widget::_check_mouse_hover(point p) const
@@ -276,30 +487,97 @@ void gui::insert_event_mouse_move(int mouse_x,int mouse_y)
         if(_hovering_over_widget_old&&_hovering_over_widget_old->on_mouse_leave)
         {
             _hovering_over_widget_old->on_mouse_leave.call(em.translated(_hovering_over_widget_old->to_local(point(0,0))));
-            _hovering_over_widget_old->dirty=true;
+            _hovering_over_widget_old->set_dirty();
         }
         if(_hovering_over_widget&&_hovering_over_widget->on_mouse_enter)
         {
             _hovering_over_widget->on_mouse_enter.call(em.translated(_hovering_over_widget->to_local(point(0,0))));
-            _hovering_over_widget->dirty=true;
+            _hovering_over_widget->set_dirty();
         }
     }
     _hovering_over_widget_old=_hovering_over_widget;
 }
 
+size_t gui::process_posted()
+{
+    return _posted.drain([this](posted_event& e)
+    {
+        switch(e.kind)
+        {
+        case posted_event::type::task:
+            e.task();
+            break;
+        case posted_event::type::mouse_press:
+            insert_event_mouse_press(e.x,e.y,e.button,e.button_state);
+            break;
+        case posted_event::type::mouse_release:
+            insert_event_mouse_release(e.x,e.y,e.button,e.button_state);
+            break;
+        case posted_event::type::mouse_move:
+            insert_event_mouse_move(e.x,e.y);
+            break;
+        case posted_event::type::mouse_wheel:
+            insert_event_mouse_wheel(e.x,e.y);
+            break;
+        case posted_event::type::key_press:
+            insert_event_key_press(lfgui::key(e.button),e.character);
+            break;
+        case posted_event::type::key_release:
+            insert_event_key_release(lfgui::key(e.button),e.character);
+            break;
+        }
+    });
+}
+
+std::vector<paint_report_entry> gui::paint_report()const
+{
+    std::vector<paint_report_entry> ret;
+    _collect_paint_costs(ret);
+    std::stable_sort(ret.begin(),ret.end(),[](const paint_report_entry& a,const paint_report_entry& b)
+    {
+        return a.cost.seconds>b.cost.seconds;
+    });
+    return ret;
+}
+
+void gui::_draw_paint_overlay(image& img)
+{
+    double max_seconds=0;
+    for(auto& e:_painted)
+        max_seconds=std::max(max_seconds,e.second);
+    for(auto& e:_painted)
+    {
+        float t=max_seconds>0?e.second/max_seconds:0;
+        img.draw_rect(e.first,color(255*t,255*(1-t),0,64));
+    }
+
+    // outline the repainted areas, the outline is gone with the next frame if the area isn't repainted again
+    const color magenta(255,0,255,200);
+    for(const lfgui::rect& r:_damage)
+    {
+        img.draw_rect(r.x,r.y,r.width,2,magenta);
+        img.draw_rect(r.x,r.bottom()-2,r.width,2,magenta);
+        img.draw_rect(r.x,r.y+2,2,r.height-4,magenta);
+        img.draw_rect(r.right()-2,r.y+2,2,r.height-4,magenta);
+    }
+
+    // the tint covers the whole frame, not only the damaged areas
+    add_damage(lfgui::rect(0,0,img.width(),img.height()));
+}
+
 void gui::set_focus(widget* w)
 {
     if(_focus_widget==w)
         return;
     if(_focus_widget&&_focus_widget->on_focus_out)
     {
-        _focus_widget->dirty=true;
+        _focus_widget->set_dirty();
         _focus_widget->on_focus_out.call();
     }
     _focus_widget=w;
     if(_focus_widget&&_focus_widget->on_focus_in)
     {
-        _focus_widget->dirty=true;
+        _focus_widget->set_dirty();
         _focus_widget->on_focus_in.call();
     }
 }
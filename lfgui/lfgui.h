@@ -10,6 +10,10 @@
 #include <algorithm>
 
 #include "image.h"
+#include "path.h"
+#include "blur.h"
+#include "asset_loader.h"
+#include "event_queue.h"
 #include "key.h"
 #include "signal.h"
 #include "../stk_timer.h"
@@ -116,6 +120,25 @@ enum class mouse_cursor
 
 class gui;
 
+/// \brief What the on_paint handlers of a widget cost, measured while paint profiling is enabled (see
+/// gui::set_paint_profiling()). Only the widget itself is measured, its children have their own costs.
+struct paint_cost
+{
+    uint32_t paints=0;          ///< \brief number of measured paints
+    double seconds=0;           ///< \brief total time spent in on_paint
+    double last_seconds=0;      ///< \brief time spent in on_paint during the last paint
+    uint64_t pixels=0;          ///< \brief total pixels touched by the draw calls, see image::draw_statistics
+    uint64_t draw_calls=0;      ///< \brief total draw calls, see image::draw_statistics
+};
+
+/// \brief One line of gui::paint_report().
+struct paint_report_entry
+{
+    const widget* w;
+    std::string uid;
+    paint_cost cost;
+};
+
 /// \brief Represents a widget.
 class widget
 {
@@ -129,11 +152,18 @@ protected:
     bool _visible=true;
     int width_=0;
     int height_=0;
+    bool _dirty=true;                   ///< \brief See dirty().
+    bool _dirty_descendant=false;       ///< \brief Set if any (direct or indirect) child of this widget is dirty.
+    float _redraw_every_n_seconds=0;    ///< \brief See set_redraw_every_n_seconds().
+    float _backdrop_blur=0;             ///< \brief See set_backdrop_blur().
+    std::shared_ptr<int> _alive=std::make_shared<int>(0);  ///< \brief Expires with this widget, see when_loaded().
+    lfgui::rect _drawn_rect;            ///< \brief The area of the image covered by this widget during the last redraw.
+    bool _redraw_damaged=false;         ///< \brief Set during redraw() if the area of this widget has been repainted.
+    lfgui::rect _opaque_rect;           ///< \brief See set_opaque_rect().
+    bool _opaque=false;                 ///< \brief See set_opaque().
+    bool _occluded=false;               ///< \brief See occluded().
+    paint_cost _paint_cost;             ///< \brief See paint_costs().
 public:
-    /// \brief Determines if this widget and all its children are fully redrawn the next time redraw() gets called.
-    bool dirty=true;
-    /// \brief Can be set to a time amount in seconds to (at least) redraw this widget and all its children every N seconds.
-    float redraw_every_n_seconds=0;
     /// \brief Used to measure the time since the last redraw.
     stk::timer redraw_timer=stk::timer("",false);
     widget_geometry geometry;   ///< The geometry used to position and size this widget.
@@ -201,33 +231,75 @@ public:
     void resize(int width,int height);
     /// \brief Resizes this widget to the given size. Calls on_resize();
     void resize(point size){resize(size.x,size.y);}
-    widget* set_pos(int x,int y,float x_percent=0,float y_percent=0){geometry.set_pos(x,y,x_percent,y_percent);return this;}
+    widget* set_pos(int x,int y,float x_percent=0,float y_percent=0){geometry.set_pos(x,y,x_percent,y_percent);set_dirty();return this;}
     widget* set_size(int x,int y,float x_percent=0,float y_percent=0){geometry.set_size(x,y,x_percent,y_percent);resize(geometry.calc_size(parent?parent->width():0,parent?parent->height():0));return this;}
-    widget* set_offset(float x_percent,float y_percent){geometry.set_offset(x_percent,y_percent);return this;}
+    widget* set_offset(float x_percent,float y_percent){geometry.set_offset(x_percent,y_percent);set_dirty();return this;}
     widget* set_pos_min(int x,int y,float x_percent=0,float y_percent=0){geometry.set_pos_min(x,y,x_percent,y_percent);return this;}
     widget* set_size_min(int x,int y,float x_percent=0,float y_percent=0){geometry.set_size_min(x,y,x_percent,y_percent);resize(geometry.calc_size(parent?parent->width():0,parent?parent->height():0));return this;}
     widget* set_pos_max(int x,int y,float x_percent=0,float y_percent=0){geometry.set_pos_max(x,y,x_percent,y_percent);return this;}
     widget* set_size_max(int x,int y,float x_percent=0,float y_percent=0){geometry.set_size_max(x,y,x_percent,y_percent);resize(geometry.calc_size(parent?parent->width():0,parent?parent->height():0));return this;}
 
-    bool need_redraw()
-    {
-        if(redraw_every_n_seconds!=0&&redraw_every_n_seconds<redraw_timer.until_now())
-            dirty=true;
-        if(dirty)
-            return true;
-        for(auto& e:children)
-            if(e->need_redraw())
-                return true;
-        return false;
-    }
+    /// \brief Returns true if this widget or any of its children is dirty. Doesn't visit the children, the dirty state
+    /// is propagated upwards by set_dirty(). Only the widgets using set_redraw_every_n_seconds() are checked. On the
+    /// gui this also swaps in the assets that finished loading, see when_loaded().
+    bool need_redraw();
+
+    /// \brief Returns true if this widget and all its children are fully redrawn the next time redraw() gets called.
+    bool dirty()const{return _dirty;}
+    /// \brief Marks this widget as dirty and all its parents as having a dirty descendant. Should be called when
+    /// something changed that requires this widget to be redrawn.
+    void set_dirty();
 
     /// \brief Sets the dirty flag of all children.
     void dirty_children()
     {
         for(auto& e:children)
-            e->dirty=true;
+            e->set_dirty();
+    }
+
+    /// \brief Returns the interval set with set_redraw_every_n_seconds(). 0 means disabled.
+    float redraw_every_n_seconds()const{return _redraw_every_n_seconds;}
+    /// \brief Can be set to a time amount in seconds to (at least) redraw this widget and all its children every N
+    /// seconds. 0 disables the timed redraw.
+    void set_redraw_every_n_seconds(float seconds);
+
+    /// \brief Calls f with the asset once it has been loaded by asset_loader::global() and marks this widget as
+    /// dirty. Right away if it's already loaded, otherwise from the gui thread when the gui polls the loader (in
+    /// need_redraw() and redraw()). Not called if this widget has been destroyed in the meantime.
+    template<typename T,typename F>
+    void when_loaded(const asset<T>& a,F f)
+    {
+        std::weak_ptr<int> alive=_alive;
+        asset_loader::global().when_ready(a,[this,alive,f](T& value)
+        {
+            if(alive.expired())
+                return;
+            f(value);
+            set_dirty();
+        });
     }
 
+    /// \brief Returns the blur set with set_backdrop_blur(). 0 means disabled.
+    float backdrop_blur()const{return _backdrop_blur;}
+    /// \brief Blurs what has been drawn behind this widget (its parents and the siblings before it) inside the area of
+    /// this widget with a gaussian of the given standard deviation before on_paint is called, for frosted glass
+    /// panels. Only the area of this widget is changed, so the damage stays the same. 0 disables the blur.
+    void set_backdrop_blur(float sigma){_backdrop_blur=sigma;set_dirty();}
+
+    /// \brief Declares that on_paint covers the given area (in local coordinates) with opaque pixels. Widgets drawn
+    /// before this one that are completely behind opaque areas aren't painted, see occluded(). Empty by default. See
+    /// image::opaque_rect() to get the area from the image a widget draws.
+    void set_opaque_rect(lfgui::rect r){_opaque_rect=r;set_dirty();}
+    /// \brief Declares the whole widget as opaque, it follows the size of the widget. See set_opaque_rect().
+    void set_opaque(bool opaque=true){_opaque=opaque;set_dirty();}
+    /// \brief Returns the area declared with set_opaque_rect() or set_opaque(), clipped to this widget.
+    lfgui::rect opaque_rect()const{return (_opaque?rect():_opaque_rect).intersected(rect());}
+    /// \brief Returns true if the last redraw skipped painting this widget because the opaque areas of the widgets
+    /// drawn after it (its children, later siblings and the later siblings of its parents) covered it completely.
+    /// The children are checked on their own. Widgets are expected to paint only inside their area, like the damage
+    /// tracking does.
+    bool occluded()const{return _occluded;}
+
     void update_geometry()
     {
         point p;
@@ -274,21 +346,12 @@ public:
     }
 
     /// \brief Removes the given child widget.
-    void remove_child(widget* w)
-    {
-        for(size_t i=0;i<children.size();i++)
-            if(children[i].get()==w)
-            {
-                children.erase(children.begin()+i);
-                return;
-            }
-        dirty=true;
-    }
+    void remove_child(widget* w);
 
     /// \brief Moves this widget.
-    widget* translate(int x,int y){geometry.pos_absolute.x+=x;geometry.pos_absolute.y+=y;return this;}
+    widget* translate(int x,int y){geometry.pos_absolute.x+=x;geometry.pos_absolute.y+=y;set_dirty();return this;}
     /// \brief Moves this widget.
-    widget* translate(point p){geometry.pos_absolute+=p;return this;}
+    widget* translate(point p){geometry.pos_absolute+=p;set_dirty();return this;}
     /// \brief Changes the size by adding x and y.
     widget* adjust_size(int x,int y)
     {
@@ -358,14 +421,41 @@ public:
     /// \brief Returns true if this widget is not displayed or false if it is.
     bool hidden()const{return !_visible;}
     /// \brief Sets if this widget is displayed or not.
-    void set_visible(bool visible=true){_visible=visible;dirty=true;}
+    void set_visible(bool visible=true){_visible=visible;set_dirty();}
     /// \brief Same as set_visible(false);.
     void hide(){set_visible(false);}
     /// \brief Same as set_visible(true);.
     void show(){set_visible(true);}
 
+    /// \brief Returns what painting this widget cost so far. Only measured while paint profiling is enabled, see
+    /// gui::set_paint_profiling().
+    const paint_cost& paint_costs()const{return _paint_cost;}
+
+    /// \brief Returns the number of all direct and indirect children.
+    size_t descendant_count()const
+    {
+        size_t ret=children.size();
+        for(auto& e:children)
+            ret+=e->descendant_count();
+        return ret;
+    }
+
 protected:
     widget* _add_child(std::unique_ptr<widget>&& w);
+    /// \brief Sets the gui of this widget and all its children. Registers widgets with a timed redraw at the gui.
+    void _set_gui(gui* g);
+    /// \brief Clears the dirty flags of this widget and all flagged children without drawing anything.
+    void _clear_dirty();
+    /// \brief Sets the occluded flag of this widget and all its children, front to back: visits the widgets in the
+    /// reverse drawing order and collects the opaque areas drawn after each widget in occluders (in image
+    /// coordinates).
+    void _find_occluded(int offset_x,int offset_y,std::vector<lfgui::rect>& occluders);
+    /// \brief Calls on_paint and measures its time and draw calls into _paint_cost.
+    void _paint_profiled(image& img,int offset_x,int offset_y);
+    /// \brief Appends the paint costs of this widget and all its children to report.
+    void _collect_paint_costs(std::vector<paint_report_entry>& report)const;
+    /// \brief Resets the paint costs of this widget and all its children.
+    void _reset_paint_costs();
 
     static std::string generate_uid()
     {
@@ -389,6 +479,15 @@ class gui : public widget
     widget* _hovering_over_widget=0;        ///< \brief The widget currently under the mouse.
     widget* _hovering_over_widget_old=0;    ///< \brief The widget currently under the mouse during the last check.
     widget* _focus_widget=0;                ///< \brief The widget that has keyboard focus.
+    std::vector<widget*> _timed_widgets;    ///< \brief Widgets with set_redraw_every_n_seconds() set. Checked by need_redraw().
+    std::vector<lfgui::rect> _damage;       ///< \brief See damage().
+    bool _paint_profiling=false;            ///< \brief See set_paint_profiling().
+    bool _paint_overlay=false;              ///< \brief See set_paint_overlay().
+    std::vector<std::pair<lfgui::rect,double>> _painted;   ///< \brief Area and paint time of the widgets in this frame.
+    event_queue _posted;                    ///< \brief Events and tasks from other threads, see post().
+
+    /// \brief Draws the debug overlay, see set_paint_overlay().
+    void _draw_paint_overlay(image& img);
     static gui* instance;                   ///< \brief Used by the load functions.
 public:
     point mouse_old_pos=point(0,0);  // for mouse movement
@@ -403,6 +502,11 @@ public:
         gui::instance=this;
     }
 
+    ~gui()
+    {
+        children.clear();   // destroy the children while this gui is still complete, they unregister themselves here
+    }
+
     /// \brief Used by a wrapper to inject a mouse press event.
     void insert_event_mouse_press(int mouse_x,int mouse_y,uint32_t event_button,uint32_t button_state)
     {
@@ -445,6 +549,88 @@ public:
         _insert_event_key_release(ek);
     }
 
+    /// \brief Thread safe. Queues a task to be run on the thread of this gui at the start of the next frame, when
+    /// need_redraw() or redraw() gets called. The way for other threads (like a game simulation) to change widgets,
+    /// which must only be touched by the gui thread. Returns false if the queue is full, the task is dropped then
+    /// (counted as rejected in posted_stats()).
+    bool post(std::function<void()> task)
+    {
+        posted_event e;
+        e.task=std::move(task);
+        return _posted.push(std::move(e));
+    }
+    /// \brief Thread safe version of insert_event_mouse_press(), see post().
+    bool post_event_mouse_press(int mouse_x,int mouse_y,uint32_t event_button,uint32_t button_state)
+    {
+        return _post_event(posted_event::type::mouse_press,mouse_x,mouse_y,event_button,button_state);
+    }
+    /// \brief Thread safe version of insert_event_mouse_release(), see post().
+    bool post_event_mouse_release(int mouse_x,int mouse_y,uint32_t event_button,uint32_t button_state)
+    {
+        return _post_event(posted_event::type::mouse_release,mouse_x,mouse_y,event_button,button_state);
+    }
+    /// \brief Thread safe version of insert_event_mouse_move(), see post(). Consecutive moves are merged.
+    bool post_event_mouse_move(int mouse_x,int mouse_y)
+    {
+        return _post_event(posted_event::type::mouse_move,mouse_x,mouse_y);
+    }
+    /// \brief Thread safe version of insert_event_mouse_wheel(), see post(). Consecutive wheel events are merged.
+    bool post_event_mouse_wheel(int delta_wheel_x,int delta_wheel_y)
+    {
+        return _post_event(posted_event::type::mouse_wheel,delta_wheel_x,delta_wheel_y);
+    }
+    /// \brief Thread safe version of insert_event_key_press(), see post().
+    bool post_event_key_press(lfgui::key key,std::string character_unicode)
+    {
+        return _post_event(posted_event::type::key_press,0,0,uint32_t(key),0,std::move(character_unicode));
+    }
+    /// \brief Thread safe version of insert_event_key_release(), see post().
+    bool post_event_key_release(lfgui::key key,std::string character_unicode)
+    {
+        return _post_event(posted_event::type::key_release,0,0,uint32_t(key),0,std::move(character_unicode));
+    }
+    /// \brief Runs the posted tasks and inserts the posted events in the order they were posted. Called by
+    /// need_redraw() and redraw() of the gui, so a wrapper doesn't need to. Returns the number of events taken from the
+    /// queue.
+    size_t process_posted();
+    /// \brief Thread safe. Returns the counters of the queue behind post(): rejected events mean the gui thread falls
+    /// behind the producers, coalesced ones are mouse moves and wheel events merged into the following one.
+    event_queue::statistics posted_stats()const{return _posted.stats();}
+
+    /// \brief Marks an area of the image as changed during the current redraw. Called by the widgets while redrawing.
+    void add_damage(lfgui::rect r)
+    {
+        if(!r.empty())
+            _damage.push_back(r);
+    }
+    /// \brief Returns the areas of the image that have been changed by the last redraw. A wrapper only needs to
+    /// convert and upload these, see plan_upload(). The list is reset when the redraw of the gui starts.
+    const std::vector<lfgui::rect>& damage()const{return _damage;}
+
+    /// \brief Enables measuring the on_paint handlers of all widgets: time, touched pixels and draw calls. Adds the
+    /// overhead of two clock reads per painted widget. See paint_report().
+    void set_paint_profiling(bool enabled=true){_paint_profiling=enabled;}
+    /// \brief Returns true if the paint costs of the widgets are measured, see set_paint_profiling().
+    bool paint_profiling()const{return _paint_profiling;}
+    /// \brief Returns the paint costs of all widgets measured so far, the most expensive (in total time) first.
+    /// Widgets that haven't been painted while profiling are not listed.
+    std::vector<paint_report_entry> paint_report()const;
+    /// \brief Resets the paint costs of all widgets.
+    void reset_paint_costs(){_reset_paint_costs();}
+
+    /// \brief Enables a debug overlay: every widget gets tinted from green to red by the time its on_paint took
+    /// (red is the most expensive widget in the frame) and the areas that have been repainted in the frame are
+    /// outlined in magenta, so they flash on changes. Enables paint profiling as well.
+    void set_paint_overlay(bool enabled=true)
+    {
+        _paint_overlay=enabled;
+        if(enabled)
+            _paint_profiling=true;
+        set_dirty();
+    }
+    /// \brief Returns true if the debug overlay is drawn, see set_paint_overlay().
+    bool paint_overlay()const{return _paint_overlay;}
+
     /// \brief Returns bool if the mouse is hovering over the given widget.
     bool mouse_hovering_over(const widget* w)const{return w==_hovering_over_widget;}
     /// \brief Returns the widget that is currently being held (down) by the mouse or 0 if none is held.
@@ -456,6 +642,20 @@ public:
 
     /// \brief Sets the current mouse cursor to the given cursor.
     virtual void set_cursor(mouse_cursor){}
+
+private:
+    bool _post_event(posted_event::type kind,int x,int y,uint32_t button=0,uint32_t button_state=0,
+                     std::string character=std::string())
+    {
+        posted_event e;
+        e.kind=kind;
+        e.x=x;
+        e.y=y;
+        e.button=button;
+        e.button_state=button_state;
+        e.character=std::move(character);
+        return _posted.push(std::move(e));
+    }
 };
 
 }   // namespace lfgui
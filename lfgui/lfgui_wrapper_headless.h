@@ -0,0 +1,198 @@
+#ifndef LFGUI_WRAPPER_HEADLESS
+#define LFGUI_WRAPPER_HEADLESS
+
+#include "lfgui.h"
+#include "frame_pipeline.h"
+#include "image_codec.h"
+#include "pixel_conversion.h"
+#include "profiler.h"
+
+namespace lfgui
+{
+namespace wrapper_headless
+{
+
+/// \brief A LFGUI wrapper without any window, graphics API or engine. The frame is rendered into the image img owned
+/// by this gui and events are injected by calling the functions of this class. Images are loaded with the built-in
+/// decoder (see decode_image()). Used for benchmarks, regression tests and generating screenshots.
+///
+/// Example usage:
+/// \code
+/// lfgui::ressource_path::set("lfgui_data/");
+/// lfgui::wrapper_headless::gui gui(800,600);
+/// setup_sample_gui(&gui);
+/// gui.update();
+/// gui.click(100,50);
+/// gui.update();
+/// gui.save_frame("frame.qoi");
+/// \endcode
+class gui : public lfgui::gui
+{
+    lfgui::mouse_cursor _cursor=lfgui::mouse_cursor::arrow;
+    uint32_t _buttons=0;    ///< \brief The currently held mouse buttons.
+    int _frames=0;
+    std::unique_ptr<lfgui::frame_pipeline> _pipeline;   ///< \brief See set_render_thread().
+public:
+    static const uint32_t button_left=1;
+    static const uint32_t button_right=2;
+    static const uint32_t button_middle=4;
+
+    gui(int width,int height) : lfgui::gui(width,height)
+    {
+        lfgui::image::load=lfgui::load_image_file;
+        lfgui::asset_loader::global().set_decoder(lfgui::load_image_file,true);
+        on_resize([this](point p){img=image(p.x,p.y);img.clear();});   // called in the middle of redraw()
+        img=image(width,height);
+    }
+
+    int width()const{return lfgui::widget::width();}
+    int height()const{return lfgui::widget::height();}
+
+    void redraw(image&,int,int) override
+    {
+        LFGUI_PROFILE_ZONE("GUI redraw");
+        image& target=_pipeline?_pipeline->begin_frame(width(),height()):img;
+        target.clear();
+        lfgui::widget::redraw(target,0,0);
+        _frames++;
+        if(_pipeline)
+            _pipeline->submit(damage());
+    }
+
+    /// \brief Renders the frames on a separate thread: the widgets are painted into a display list and the render
+    /// thread draws it while the next frame is painted (see lfgui::frame_pipeline). frame() waits for the render
+    /// thread. Off by default.
+    void set_render_thread(bool enabled)
+    {
+        if(enabled==bool(_pipeline))
+            return;
+        if(!enabled)
+        {
+            _pipeline->wait();
+            if(_pipeline->stats().rendered)
+                img=_pipeline->frame().copy();
+            _pipeline.reset();
+            return;
+        }
+        _pipeline.reset(new lfgui::frame_pipeline());
+    }
+    /// \brief Returns the render thread, if enabled with set_render_thread().
+    lfgui::frame_pipeline* pipeline(){return _pipeline.get();}
+
+    /// \brief Renders a new frame if anything changed (see need_redraw()). Returns true if a frame has been rendered.
+    bool update()
+    {
+        if(!need_redraw())
+            return false;
+        redraw(img,0,0);
+        return true;
+    }
+
+    /// \brief Renders a new frame even if nothing changed.
+    void render(){redraw(img,0,0);}
+
+    /// \brief Returns the number of frames rendered so far.
+    int frames()const{return _frames;}
+
+    /// \brief Returns the last rendered frame.
+    const image& frame()const
+    {
+        if(!_pipeline)
+            return img;
+        _pipeline->wait();
+        // img keeps the frame rendered before the render thread has been enabled
+        return _pipeline->stats().rendered?_pipeline->frame():img;
+    }
+
+    /// \brief Returns the last rendered frame as RGBA with 8 bit per channel and straight (not premultiplied) alpha.
+    std::vector<uint8_t> grab_rgba()const
+    {
+        const image& f=frame();
+        std::vector<uint8_t> ret(size_t(f.count())*4);
+        if(f.count())
+            lfgui::convert_to_rgba(f,f.rect(),ret.data(),f.width()*4);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        lfgui::unpremultiply_alpha(ret.data(),f.count());
+#endif
+        return ret;
+    }
+
+    /// \brief Saves the last rendered frame as QOI or PPM, chosen by the extension. See lfgui::save_image().
+    bool save_frame(const std::string& path)const{return lfgui::save_image(frame(),path);}
+
+    /// \brief Returns the mouse cursor the gui would currently display.
+    lfgui::mouse_cursor cursor()const{return _cursor;}
+    void set_cursor(mouse_cursor c) override{_cursor=c;}
+
+    /// \brief Moves the mouse to the given position.
+    void mouse_move(int x,int y){insert_event_mouse_move(x,y);}
+
+    /// \brief Moves the mouse to the given position and presses the given button there.
+    void mouse_press(int x,int y,uint32_t button=button_left)
+    {
+        mouse_move(x,y);
+        _buttons|=button;
+        insert_event_mouse_press(x,y,button,_buttons);
+    }
+
+    /// \brief Moves the mouse to the given position and releases the given button there.
+    void mouse_release(int x,int y,uint32_t button=button_left)
+    {
+        mouse_move(x,y);
+        _buttons&=~button;
+        insert_event_mouse_release(x,y,button,_buttons);
+    }
+
+    /// \brief Presses and releases the given button at the given position.
+    void click(int x,int y,uint32_t button=button_left)
+    {
+        mouse_press(x,y,button);
+        mouse_release(x,y,button);
+    }
+
+    /// \brief Presses the given button at (from_x,from_y), moves the mouse in the given number of steps to
+    /// (to_x,to_y) and releases the button there.
+    void drag(int from_x,int from_y,int to_x,int to_y,int steps=8,uint32_t button=button_left)
+    {
+        mouse_press(from_x,from_y,button);
+        for(int i=1;i<=steps;i++)
+            mouse_move(from_x+(to_x-from_x)*i/steps,from_y+(to_y-from_y)*i/steps);
+        mouse_release(to_x,to_y,button);
+    }
+
+    /// \brief Moves the mouse wheel at the current mouse position.
+    void wheel(int delta_x,int delta_y){insert_event_mouse_wheel(delta_x,delta_y);}
+
+    /// \brief Presses and releases the given key. character is the entered text in UTF-8, if any.
+    void key(lfgui::key k,const std::string& character=std::string())
+    {
+        insert_event_key_press(k,character);
+        insert_event_key_release(k,character);
+    }
+
+    /// \brief Types the given text into the widget with keyboard focus, one key event per byte. Only ASCII is mapped
+    /// to a key, other bytes are sent with Key_None.
+    void type_text(const std::string& text)
+    {
+        for(char c:text)
+        {
+            if(c=='\n')
+                key(lfgui::Key_Return,"\n");
+            else if(c=='\t')
+                key(lfgui::Key_Tab,"\t");
+            else if(c=='\b')
+                key(lfgui::Key_Backspace);
+            else if(c>='a'&&c<='z')
+                key(lfgui::key(c-'a'+'A'),std::string(1,c));
+            else if(c>=0x20&&c<0x7F)
+                key(lfgui::key(c),std::string(1,c));
+            else
+                key(lfgui::Key_None,std::string(1,c));
+        }
+    }
+};
+
+}   // namespace wrapper_headless
+}   // namespace lfgui
+
+#endif // LFGUI_WRAPPER_HEADLESS
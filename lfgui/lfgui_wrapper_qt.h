@@ -17,6 +17,9 @@
 #endif
 
 #include "lfgui.h"
+#include "frame_pipeline.h"
+#include "pixel_conversion.h"
+#include "profiler.h"
 #include "../stk_debugging.h"
 #include "../stk_timer.h"
 
@@ -38,27 +41,21 @@ inline lfgui::image load_image(const std::string& path)
         return lfgui::image(1,1);
     }
 
-    qimage.convertToFormat(QImage::Format_ARGB32);
+    qimage=qimage.convertToFormat(QImage::Format_ARGB32);
     image img(qimage.width(),qimage.height());
-
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-    auto count=qimage.width()*qimage.height();
-    uint8_t* data=qimage.bits();
-    uint8_t* d=img.data();
-    for(int i=0;i<count;i++,data+=4)
-    {
-        d[i]=data[0];
-        d[i+count]=data[1];
-        d[i+count*2]=data[2];
-        d[i+count*3]=data[3];
-    }
-#else
-    memcpy(img.data(),qimage.bits(),qimage.width()*qimage.height()*4);
-#endif
+    lfgui::convert_pixels(qimage.constBits(),qimage.bytesPerLine(),lfgui::pixel_format::bgra,img,img.rect());
 
     return img;
 }
 
+/// \brief The QImage format the frames are presented with. Premultiplied frames can be drawn by QPainter without a
+/// conversion.
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+const QImage::Format frame_format=QImage::Format_ARGB32_Premultiplied;
+#else
+const QImage::Format frame_format=QImage::Format_ARGB32;
+#endif
+
 /// \brief The LFGUI Qt Wrapper. It is also a QWidget and can therefore be simply used as a QWidget.
 class gui : public lfgui::gui,public QWidget
 {
@@ -66,23 +63,25 @@ public:
     QImage qimage;
     QTimer *timer;  ///< a Qt timer used to do stuff like making a blinking cursor
     stk::timer fps_timer;
+    std::unique_ptr<lfgui::frame_pipeline> pipeline;   ///< \brief See set_render_thread(). Destroyed before qimage.
 
-    gui(int width=1,int height=1) : lfgui::gui(width,height),qimage(width,height,QImage::Format_ARGB32)
+    gui(int width=1,int height=1) : lfgui::gui(width,height),qimage(width,height,frame_format)
     {
         lfgui::image::load=lfgui::wrapper_qt::load_image;
+        lfgui::asset_loader::global().set_decoder(lfgui::wrapper_qt::load_image,true);  // QImage is reentrant
         setMouseTracking(true);
         setFocusPolicy(Qt::StrongFocus);
         timer=new QTimer(this);
         fps_timer.reset();
         connect(timer,&QTimer::timeout,[this]{check_redraw();});
         timer->start(1000.0/(max_fps*4.0));
-        on_resize([this](point p){img=std::move(image(p.x,p.y));});
+        on_resize([this](point p){img=std::move(image(p.x,p.y));img.clear();});   // called in the middle of redraw()
         img=std::move(image(width,height));
     }
 
     void check_redraw()
     {
-        if(fps_timer.until_now()>1.0/max_fps)
+        if(fps_timer.until_now()>1.0/max_fps&&need_redraw())   // idle frames are skipped completely
         {
             redraw(img,0,0);
             fps_timer.reset();
@@ -102,61 +101,37 @@ std::cout<<"set_max_fps "<<max_fps<<std::endl;
     int width()const{return lfgui::widget::width();}
     int height()const{return lfgui::widget::height();}
 
-    void redraw(image&,int,int) override
+    /// \brief Renders the frames and converts them into the QImage on a separate thread while the widgets paint the
+    /// next frame into a display list and the events are handled, see lfgui::frame_pipeline. Worth it on multi-core
+    /// machines with large windows. Off by default.
+    void set_render_thread(bool enabled)
     {
-//stk::timer _("REDRAW");
-        STK_PROFILER_POINT("GUI redraw");
-        img.clear();
-        lfgui::widget::redraw(img,0,0);
-
-{
-//stk::timer _("REDRAW");
-//STK_PROFILER_POINT("Qt redraw")
-#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
-        uint8_t* data=qimage.bits();
-        int count=qimage.width()*qimage.height();
-        int count2=count*2;
-        int count3=count*3;
-        uint8_t* p=img.data();
+        if(enabled==bool(pipeline))
+            return;
+        if(!enabled)
         {
-            int i=0;
-#ifdef __SSE2__
-            for(;i<count/64*64;i+=16,data+=64)
-            {
-                __m128i ib=_mm_loadu_si128((__m128i*)(p+i));
-                __m128i ig=_mm_loadu_si128((__m128i*)(p+i+count));
-                __m128i ir=_mm_loadu_si128((__m128i*)(p+i+count2));
-                __m128i ia=_mm_loadu_si128((__m128i*)(p+i+count3));
-
-                __m128i b0r0b7r7=_mm_unpacklo_epi8(ib,ir);
-                __m128i g0a0g7a7=_mm_unpacklo_epi8(ig,ia);
-                __m128i o1=_mm_unpacklo_epi8(b0r0b7r7,g0a0g7a7);
-                __m128i o2=_mm_unpackhi_epi8(b0r0b7r7,g0a0g7a7);
-                __m128i b8r8bFrF=_mm_unpackhi_epi8(ib,ir);
-                __m128i g8a8gFaF=_mm_unpackhi_epi8(ig,ia);
-                __m128i o3=_mm_unpacklo_epi8(b8r8bFrF,g8a8gFaF);
-                __m128i o4=_mm_unpackhi_epi8(b8r8bFrF,g8a8gFaF);
-
-                _mm_storeu_si128((__m128i*)(data),o1);
-                _mm_storeu_si128((__m128i*)(data+16),o2);
-                _mm_storeu_si128((__m128i*)(data+32),o3);
-                _mm_storeu_si128((__m128i*)(data+48),o4);
-            }
-#endif
-            for(;i<count;i++,data+=4)
-            {
-                data[0]=p[i];
-                data[1]=p[i+count];
-                data[2]=p[i+count2];
-                data[3]=p[i+count3];
-            }
+            pipeline.reset();
+            return;
         }
-#else
-        memcpy(qimage.bits(),img.data(),qimage.width()*qimage.height()*4);
-#endif
-}
+        pipeline.reset(new lfgui::frame_pipeline([this](const image& frame,const std::vector<lfgui::rect>&)
+        {
+            _convert(frame);
+        }));
+    }
+
+    void redraw(image&,int,int) override
+    {
+        LFGUI_PROFILE_ZONE("GUI redraw");
+        image& target=pipeline?pipeline->begin_frame(width(),height()):img;
+        target.clear();
+        lfgui::widget::redraw(target,0,0);
+
+        if(pipeline)
+            pipeline->submit(damage());
+        else
+            _convert(img);
 {
-        STK_PROFILER_POINT("Qt repaint")
+        LFGUI_PROFILE_ZONE("Qt repaint");
         //repaint();
         update();
 }
@@ -164,9 +139,11 @@ std::cout<<"set_max_fps "<<max_fps<<std::endl;
 
     void resizeEvent(QResizeEvent* e) override
     {
-        dirty=true;
+        set_dirty();
         QWidget::resizeEvent(e);
-        qimage=QImage(QWidget::width(),QWidget::height(),QImage::Format_ARGB32);
+        if(pipeline)
+            pipeline->wait();
+        qimage=QImage(QWidget::width(),QWidget::height(),frame_format);
         lfgui::widget::resize(QWidget::width(),QWidget::height());
     }
 
@@ -174,6 +151,8 @@ std::cout<<"set_max_fps "<<max_fps<<std::endl;
     {
     //stk::timer _("Qt paintEvent");
         QWidget::paintEvent(e);
+        if(pipeline)
+            pipeline->wait();
 
         QPainter painter(this);
         painter.drawImage(0,0,qimage);
@@ -278,6 +257,18 @@ std::cout<<"set_max_fps "<<max_fps<<std::endl;
         else
             setCursor(Qt::ArrowCursor);
     }
+
+private:
+    /// \brief Converts frame into qimage. Called on the render thread if there is one.
+    void _convert(const image& frame)
+    {
+        // QImage::Format_ARGB32(_Premultiplied) is BGRA in memory, building with the default pixel format avoids any
+        // conversion
+        LFGUI_PROFILE_ZONE("Qt convert");
+        const lfgui::rect r=frame.rect().intersected(lfgui::rect(0,0,qimage.width(),qimage.height()));
+        if(!r.empty())
+            lfgui::convert_pixels(frame,r,lfgui::pixel_format::bgra,qimage.bits(),qimage.bytesPerLine());
+    }
 };
 
 }       // namespace wrapper_qt
@@ -18,6 +18,7 @@
 #include <Urho3D/Core/Profiler.h>
 
 #include "lfgui.h"
+#include "pixel_conversion.h"
 
 namespace lfgui
 {
@@ -48,7 +49,7 @@ inline lfgui::image load_image(std::string path);
 class gui : public lfgui::gui,public Urho3D::Object
 {
     Urho3D::SharedPtr<Urho3D::Sprite> _sprite;
-    Urho3D::SharedPtr<Urho3D::Image> _image;
+    std::vector<uint8_t> _staging;   ///< \brief RGBA copy of the currently uploaded area.
     Urho3D::SharedPtr<Urho3D::Texture2D> _texture;
     static gui*& _instance(){static gui* inst;return inst;}
     lfgui::mouse_cursor active_mouse_cursor=lfgui::mouse_cursor::arrow;
@@ -64,13 +65,16 @@ public:
         lfgui::image::load=lfgui::wrapper_urho3d::load_image;
 
         Urho3D::ResourceCache* cache=_context->GetSubsystem<Urho3D::ResourceCache>();
-        _image=new Urho3D::Image(_context);
         _sprite=_context->GetSubsystem<Urho3D::UI>()->GetRoot()->CreateChild<Urho3D::Sprite>();
         _texture=new Urho3D::Texture2D(_context);
         _texture->SetFilterMode(Urho3D::TextureFilterMode::FILTER_NEAREST);
         _texture->SetNumLevels(1);
         _sprite->SetTexture(_texture);
+#ifdef LFGUI_PREMULTIPLIED_ALPHA
+        _sprite->SetBlendMode(Urho3D::BlendMode::BLEND_PREMULALPHA);
+#else
         _sprite->SetBlendMode(Urho3D::BlendMode::BLEND_ALPHA);
+#endif
 
         SubscribeToEvent(Urho3D::E_MOUSEBUTTONDOWN,URHO3D_HANDLER(gui,e_mouse_press));
         SubscribeToEvent(Urho3D::E_MOUSEBUTTONUP,URHO3D_HANDLER(gui,e_mouse_release));
@@ -82,7 +86,7 @@ public:
         SubscribeToEvent(Urho3D::E_UPDATE,URHO3D_HANDLER(gui,e_update));
         SubscribeToEvent(Urho3D::E_SCREENMODE,URHO3D_HANDLER(gui,e_resize));
 
-        on_resize([this](point p){img=image(p.x,p.y);});
+        on_resize([this](point p){img=image(p.x,p.y);img.clear();});   // called in the middle of redraw()
         img=image(render_size.x_,render_size.y_);
     }
 
@@ -97,40 +101,39 @@ public:
         int h=height();
         int w=width();
 
+        bool resized=false;
+        if(_texture->GetWidth()!=w||_texture->GetHeight()!=h)
+        {
+            _texture->SetSize(w,h,Urho3D::Graphics::GetRGBAFormat(),Urho3D::TEXTURE_STATIC);
+            resized=true;
+        }
+
         if(visible())
         {
             img.clear();
             lfgui::widget::redraw(img,0,0);
 
-            if(_texture->GetWidth()!=width()||_texture->GetHeight()!=height())
-                _texture->SetSize(width(),height(),Urho3D::Graphics::GetRGBAFormat(),Urho3D::TEXTURE_STATIC);
-            if(_image->GetWidth()!=width()||_image->GetHeight()!=height())
-                _image->SetSize(width(),height(),4);
-
-            int count=w*h;
-            int countx2=count*2;
-            int countx3=count*3;
-            // due to the channel seperation in the first image, the pixel have to be copyed byte/color vise
-            uint8_t* data_target=_image->GetData();
-            uint8_t* data_source=this->img.data();
-            uint8_t* data_source_end=this->img.data()+count;
-            for(;data_source<data_source_end;)
+            // Only the changed areas are converted and uploaded. A resized texture has lost its content.
+            // Building LFGUI with LFGUI_PACKED_RGBA renders in the texture format, the conversion is a copy then.
+            std::vector<lfgui::rect> upload;
+            if(resized)
+                upload.push_back(lfgui::rect(0,0,w,h));
+            else
+                upload=lfgui::plan_upload(damage(),w,h);
+
+            for(const lfgui::rect& r:upload)
             {
-                *data_target=*(data_source+countx2);    // cIMG has the colors as BGRA and Urho3D as RGBA
-                data_target++;
-                *data_target=*(data_source+count);
-                data_target++;
-                *data_target=*data_source;
-                data_target++;
-                *data_target=*(data_source+countx3);
-                data_target++;
-                data_source++;
+                _staging.resize(r.area()*4);
+                lfgui::convert_to_rgba(img,r,_staging.data(),r.width*4);
+                _texture->SetData(0,r.x,r.y,r.width,r.height,_staging.data());
             }
         }
         else
-            _image->ClearInt(0);
-
-        _texture->SetData(0,0,0,w,h,_image->GetData());
+        {
+            lfgui::widget::redraw(img,0,0);    // only clears the dirty flags
+            _staging.assign(w*h*4,0);
+            _texture->SetData(0,0,0,w,h,_staging.data());
+        }
 
         if(_sprite->GetWidth()!=_texture->GetWidth()||_sprite->GetHeight()!=_texture->GetHeight())
             _sprite->SetSize(_texture->GetWidth(),_texture->GetHeight());
@@ -138,7 +141,8 @@ public:
 
     void e_update(Urho3D::StringHash eventType,Urho3D::VariantMap& eventData)
     {
-        redraw(img,0,0);
+        if(need_redraw())   // idle frames are skipped completely, the texture still contains the last frame
+            redraw(img,0,0);
 
         if(!GetSubsystem<Urho3D::UI>()->GetCursor())
             return;
@@ -276,14 +280,31 @@ inline lfgui::image load_image(std::string path)
     if(!i)  // not loaded properly. Urho3D does automatically log this in his error log.
         return lfgui::image(1,1);
 
-    image img(i->GetWidth(),i->GetHeight());
+    int w=i->GetWidth();
+    int h=i->GetHeight();
+    image img(w,h);
+    int components=i->GetComponents();
 
-    for(int y=0;y<i->GetHeight();y++)
-        for(int x=0;x<i->GetWidth();x++)
+    if(i->IsCompressed()||components<1||components>4)   // not raw 8 bit data, has to go through Urho3D::Color
+    {
+        for(int y=0;y<h;y++)
+            for(int x=0;x<w;x++)
+            {
+                Urho3D::Color c(i->GetPixel(x,y));
+                img.set_pixel(x,y,lfgui::color(c.r_*255,c.g_*255,c.b_*255,c.a_*255));
+            }
+    }
+    else if(components==4)
+        lfgui::convert_from_rgba(i->GetData(),w*4,img,lfgui::rect(0,0,w,h));
+    else
+    {
+        std::vector<uint8_t> row(w*4);
+        for(int y=0;y<h;y++)
         {
-            Urho3D::Color c(i->GetPixel(x,y));
-            img.set_pixel(x,y,lfgui::color(c.r_*255,c.g_*255,c.b_*255,c.a_*255));
+            lfgui::expand_to_rgba(i->GetData()+y*w*components,components,row.data(),w);
+            lfgui::convert_from_rgba(row.data(),w*4,img,lfgui::rect(0,y,w,1));
         }
+    }
 
     return img;
 }
@@ -8,22 +8,27 @@ lineedit::lineedit(int x,int y,int _width,int _height,const std::string& text,co
 {
     STK_STACKTRACE
     cursor_position=_text.size();
-    redraw_every_n_seconds=0.5;
-
-    int border_width=8;
+    set_redraw_every_n_seconds(0.5);
 
+    // the backgrounds are empty until their images have been loaded
+    auto stretched=[this](const image& img)
+    {
+        const int border_width=8;
+        image ret(width(),height());
+        ret.clear();
+        ret.draw_image_corners_stretched(border_width,img);
+        return ret;
+    };
+    asset_loader& loader=asset_loader::global();
+    when_loaded(loader.load_image(ressource_path::get()+"gui_torus_filled.png"),[this,stretched](const image& img)
     {
-        image img(ressource_path::get()+"gui_torus_filled.png");
-        img_background=image(width(),height());
-        img_background.clear();
-        img_background.draw_image_corners_stretched(border_width,img);
-    }
+        img_background=stretched(img);
+    });
+    when_loaded(loader.load_image(ressource_path::get()+"gui_torus_filled_highlighted.png"),
+                [this,stretched](const image& img)
     {
-        image img(ressource_path::get().append("gui_torus_filled_highlighted.png"));
-        img_background_focused=image(width(),height());
-        img_background_focused.clear();
-        img_background_focused.draw_image_corners_stretched(border_width,img);
-    }
+        img_background_focused=stretched(img);
+    });
 
     on_paint([this](lfgui::event_paint e)
     {
@@ -31,11 +31,11 @@ public:
     lineedit(int width=100,int height=20) : lineedit(0,0,width,height){}
 
     std::string text(){return _text;}
-    void set_text(const std::string& t){_text=t;}
+    void set_text(const std::string& t){_text=t;set_dirty();}
     color text_color(){return _text_color;}
-    void set_text_color(color c){_text_color=c;}
+    void set_text_color(color c){_text_color=c;set_dirty();}
     int text_size(){return _text_size;}
-    void set_text_size(int s){_text_size=s;}
+    void set_text_size(int s){_text_size=s;set_dirty();}
 };
 
 }   // namespace lfgui
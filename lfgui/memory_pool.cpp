@@ -0,0 +1,149 @@
+#include "memory_pool.h"
+
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace lfgui
+{
+
+namespace
+{
+
+void* aligned_allocate(size_t size)
+{
+#ifdef _MSC_VER
+    void* p=_aligned_malloc(size,memory_pool::alignment);
+#else
+    void* p=nullptr;
+    if(posix_memalign(&p,memory_pool::alignment,size))
+        p=nullptr;
+#endif
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void aligned_free(void* p)
+{
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+}   // namespace
+
+memory_pool::memory_pool(size_t max_cached_bytes) : _max_cached_bytes(max_cached_bytes)
+{
+}
+
+memory_pool::~memory_pool()
+{
+    _trim_to(0);
+}
+
+void* memory_pool::allocate(size_t size)
+{
+    if(!size)
+        return nullptr;
+    const size_t block=size_class(size);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it=_free.find(block);
+        if(it!=_free.end()&&!it->second.empty())
+        {
+            void* p=it->second.back();
+            it->second.pop_back();
+            _statistics.allocations++;
+            _statistics.reused++;
+            _statistics.bytes_in_use+=block;
+            _statistics.bytes_cached-=block;
+            return p;
+        }
+    }
+    void* p=aligned_allocate(block);   // outside of the lock, this can take a while for large blocks
+    std::lock_guard<std::mutex> lock(_mutex);
+    _statistics.allocations++;
+    _statistics.system_allocations++;
+    _statistics.bytes_in_use+=block;
+    return p;
+}
+
+void memory_pool::release(void* p,size_t size)
+{
+    if(!p)
+        return;
+    const size_t block=size_class(size);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _statistics.releases++;
+        _statistics.bytes_in_use-=block;
+        if(_statistics.bytes_cached+block<=_max_cached_bytes)
+        {
+            _free[block].push_back(p);
+            _statistics.bytes_cached+=block;
+            return;
+        }
+    }
+    aligned_free(p);
+}
+
+void memory_pool::trim()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _trim_to(0);
+}
+
+void memory_pool::set_max_cached_bytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _max_cached_bytes=bytes;
+    _trim_to(bytes);
+}
+
+size_t memory_pool::max_cached_bytes()const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _max_cached_bytes;
+}
+
+memory_pool::statistics memory_pool::stats()const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _statistics;
+}
+
+size_t memory_pool::size_class(size_t size)
+{
+    if(size<=alignment)
+        return alignment;
+    // four classes between each power of two and the next one
+    size_t power=alignment;
+    while(power*2<size)
+        power*=2;
+    const size_t step=power/4;
+    return (size+step-1)/step*step;
+}
+
+memory_pool& memory_pool::global()
+{
+    static memory_pool* pool=new memory_pool;
+    return *pool;
+}
+
+void memory_pool::_trim_to(size_t bytes)
+{
+    for(auto it=_free.rbegin();it!=_free.rend()&&_statistics.bytes_cached>bytes;++it)
+        while(!it->second.empty()&&_statistics.bytes_cached>bytes)
+        {
+            aligned_free(it->second.back());
+            it->second.pop_back();
+            _statistics.bytes_cached-=it->first;
+        }
+}
+
+}   // namespace lfgui
@@ -0,0 +1,75 @@
+#ifndef LFGUI_MEMORY_POOL_H
+#define LFGUI_MEMORY_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace lfgui
+{
+
+/// \brief Hands out memory blocks aligned to memory_pool::alignment bytes and keeps released blocks in free lists per
+/// size class to hand them out again, so the buffers of images that are created and destroyed constantly (temporary
+/// images, the frame of a resized window, cached layers) don't go through malloc and free each time.
+///
+/// The sizes are rounded up to size classes, four per power of two, so a block wastes less than a quarter of its size
+/// and a free block fits all sizes of its class. At most max_cached_bytes() are kept in the free lists, blocks
+/// released beyond that are freed right away. All functions are thread safe.
+class memory_pool
+{
+public:
+    /// \brief The alignment of all blocks in bytes, a cache line.
+    static const size_t alignment=64;
+
+    /// \brief Counters of a pool, see stats().
+    struct statistics
+    {
+        uint64_t allocations=0;         ///< \brief blocks handed out by allocate()
+        uint64_t reused=0;              ///< \brief allocations served from the free lists
+        uint64_t system_allocations=0;  ///< \brief blocks allocated from the system
+        uint64_t releases=0;            ///< \brief blocks given back with release()
+        size_t bytes_in_use=0;          ///< \brief the size classes of the blocks handed out and not released yet
+        size_t bytes_cached=0;          ///< \brief the size classes of the blocks in the free lists
+    };
+
+    explicit memory_pool(size_t max_cached_bytes=size_t(64)<<20);
+    /// \brief Frees the cached blocks. All blocks have to be released before.
+    ~memory_pool();
+    memory_pool(const memory_pool&)=delete;
+    memory_pool& operator=(const memory_pool&)=delete;
+
+    /// \brief Returns an aligned block of at least size bytes, nullptr if size is 0. Throws std::bad_alloc if the
+    /// system is out of memory.
+    void* allocate(size_t size);
+    /// \brief Gives a block back, size has to be the size it was allocated with.
+    void release(void* p,size_t size);
+    /// \brief Frees all cached blocks.
+    void trim();
+
+    /// \brief Sets how many bytes the free lists may keep. Cached blocks beyond the new limit are freed.
+    void set_max_cached_bytes(size_t bytes);
+    size_t max_cached_bytes()const;
+    /// \brief Returns the counters since the pool was created.
+    statistics stats()const;
+
+    /// \brief Returns the size of the blocks allocated for size bytes.
+    static size_t size_class(size_t size);
+    /// \brief The pool used by the images (see memory_wrapper). It's never destroyed, so images in static variables
+    /// can still release their buffers at exit.
+    static memory_pool& global();
+
+private:
+    mutable std::mutex _mutex;
+    std::map<size_t,std::vector<void*>> _free;     ///< \brief the free blocks by size class
+    size_t _max_cached_bytes;
+    statistics _statistics;
+
+    /// \brief Frees cached blocks, the largest first, until at most bytes are cached. Expects _mutex to be locked.
+    void _trim_to(size_t bytes);
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_MEMORY_POOL_H
@@ -0,0 +1,40 @@
+#ifndef LFGUI_PARALLEL_H
+#define LFGUI_PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace lfgui
+{
+
+/// \brief Splits [begin,end) into consecutive parts, calls f(part_begin,part_end) for each part on its own thread and
+/// waits for all of them. The calling thread works on the last part. Every part is at least min_per_thread long, so
+/// small ranges (and machines with a single core) run f(begin,end) directly on the calling thread without starting
+/// any thread. f must not throw and the parts must be independent of each other.
+template<typename F>
+void parallel_for(int begin,int end,int min_per_thread,const F& f)
+{
+    const int length=end-begin;
+    static const int cores=std::max(1u,std::thread::hardware_concurrency());    // reads a file on Linux, so only once
+    int threads=cores;
+    threads=std::min(threads,length/std::max(1,min_per_thread));
+    if(threads<=1)
+    {
+        if(length>0)
+            f(begin,end);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads-1);
+    for(int i=0;i<threads-1;i++)
+        workers.emplace_back([&f,begin,length,threads,i]{f(begin+length*i/threads,begin+length*(i+1)/threads);});
+    f(begin+length*(threads-1)/threads,end);
+    for(auto& t:workers)
+        t.join();
+}
+
+}   // namespace lfgui
+
+#endif // LFGUI_PARALLEL_H
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cmath>
+
+#include "path.h"
+
+namespace lfgui
+{
+
+path& path::move_to(float x,float y)
+{
+    _verbs.push_back(verb::move);
+    _points.emplace_back(x,y);
+    _open=true;
+    return *this;
+}
+
+path& path::line_to(float x,float y)
+{
+    if(!_open)
+        return move_to(x,y);
+    _verbs.push_back(verb::line);
+    _points.emplace_back(x,y);
+    return *this;
+}
+
+path& path::quad_to(float cx,float cy,float x,float y)
+{
+    if(!_open)
+        move_to(cx,cy);
+    _verbs.push_back(verb::quad);
+    _points.emplace_back(cx,cy);
+    _points.emplace_back(x,y);
+    return *this;
+}
+
+path& path::cubic_to(float c1x,float c1y,float c2x,float c2y,float x,float y)
+{
+    if(!_open)
+        move_to(c1x,c1y);
+    _verbs.push_back(verb::cubic);
+    _points.emplace_back(c1x,c1y);
+    _points.emplace_back(c2x,c2y);
+    _points.emplace_back(x,y);
+    return *this;
+}
+
+path& path::arc(float cx,float cy,float radius,float start_angle,float end_angle)
+{
+    line_to(cx+std::cos(start_angle)*radius,cy+std::sin(start_angle)*radius);
+    // one cubic curve per quarter circle at most, the control points are k*radius away along the tangents
+    const float sweep=end_angle-start_angle;
+    const int parts=std::max(1,int(std::ceil(std::abs(sweep)/1.5707964f-1e-4f)));
+    const float step=sweep/parts;
+    const float k=4.f/3*std::tan(step/4)*radius;
+    float angle=start_angle;
+    for(int i=0;i<parts;i++)
+    {
+        const float c0=std::cos(angle);
+        const float s0=std::sin(angle);
+        angle=start_angle+step*(i+1);
+        const float c1=std::cos(angle);
+        const float s1=std::sin(angle);
+        cubic_to(cx+c0*radius-s0*k,cy+s0*radius+c0*k,
+                 cx+c1*radius+s1*k,cy+s1*radius-c1*k,
+                 cx+c1*radius,cy+s1*radius);
+    }
+    return *this;
+}
+
+path& path::close()
+{
+    if(_open)
+    {
+        _verbs.push_back(verb::close);
+        _open=false;
+    }
+    return *this;
+}
+
+path& path::add_rect(float x,float y,float w,float h)
+{
+    return move_to(x,y).line_to(x+w,y).line_to(x+w,y+h).line_to(x,y+h).close();
+}
+
+path& path::add_rounded_rect(float x,float y,float w,float h,float radius)
+{
+    radius=std::min(radius,std::min(w,h)/2);
+    if(!(radius>0))
+        return add_rect(x,y,w,h);
+    const float pi=3.14159265f;
+    move_to(x+radius,y);
+    arc(x+w-radius,y+radius,radius,-pi/2,0);
+    arc(x+w-radius,y+h-radius,radius,0,pi/2);
+    arc(x+radius,y+h-radius,radius,pi/2,pi);
+    arc(x+radius,y+radius,radius,pi,pi*3/2);
+    return close();
+}
+
+path& path::add_ellipse(float cx,float cy,float rx,float ry)
+{
+    // a unit circle made of four cubic curves, scaled
+    const float k=0.55228475f;
+    move_to(cx+rx,cy);
+    cubic_to(cx+rx,cy+ry*k,cx+rx*k,cy+ry,cx,cy+ry);
+    cubic_to(cx-rx*k,cy+ry,cx-rx,cy+ry*k,cx-rx,cy);
+    cubic_to(cx-rx,cy-ry*k,cx-rx*k,cy-ry,cx,cy-ry);
+    cubic_to(cx+rx*k,cy-ry,cx+rx,cy-ry*k,cx+rx,cy);
+    return close();
+}
+
+void path::clear()
+{
+    _verbs.clear();
+    _points.clear();
+    _open=false;
+}
+
+path path::transformed(const affine_matrix& m)const
+{
+    path ret(*this);
+    for(point_float& p:ret._points)
+        p=m.map(p.x,p.y);
+    return ret;
+}
+
+void path::flatten(float tolerance,const std::function<void(const point_float*,size_t,bool)>& f)const
+{
+    tolerance=std::max(tolerance,1e-3f);
+    static thread_local std::vector<point_float> polyline;
+    polyline.clear();
+    auto emit=[&](bool closed)
+    {
+        if(!polyline.empty())
+            f(polyline.data(),polyline.size(),closed);
+        polyline.clear();
+    };
+    auto length=[](point_float p){return std::sqrt(p.x*p.x+p.y*p.y);};
+
+    const point_float* p=_points.data();
+    for(verb v:_verbs)
+    {
+        switch(v)
+        {
+        case verb::move:
+            emit(false);
+            polyline.push_back(*p++);
+            break;
+        case verb::line:
+            polyline.push_back(*p++);
+            break;
+        case verb::quad:
+        {
+            const point_float p0=polyline.back();
+            const point_float p1=p[0];
+            const point_float p2=p[1];
+            const float dd=length(p0-p1*2+p2);
+            const int n=std::min(1000,std::max(1,int(std::ceil(std::sqrt(dd/(4*tolerance))))));
+            for(int i=1;i<=n;i++)
+            {
+                const float t=float(i)/n;
+                const float u=1-t;
+                polyline.push_back(p0*(u*u)+p1*(2*u*t)+p2*(t*t));
+            }
+            p+=2;
+            break;
+        }
+        case verb::cubic:
+        {
+            const point_float p0=polyline.back();
+            const point_float p1=p[0];
+            const point_float p2=p[1];
+            const point_float p3=p[2];
+            const float dd=std::max(length(p0-p1*2+p2),length(p1-p2*2+p3));
+            const int n=std::min(1000,std::max(1,int(std::ceil(std::sqrt(dd*0.75f/tolerance)))));
+            for(int i=1;i<=n;i++)
+            {
+                const float t=float(i)/n;
+                const float u=1-t;
+                polyline.push_back(p0*(u*u*u)+p1*(3*u*u*t)+p2*(3*u*t*t)+p3*(t*t*t));
+            }
+            p+=3;
+            break;
+        }
+        case verb::close:
+            emit(true);
+            break;
+        }
+    }
+    emit(false);
+}
+
+}   // namespace lfgui
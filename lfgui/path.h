@@ -0,0 +1,86 @@
+#ifndef LFGUI_PATH_H
+#define LFGUI_PATH_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief A vector shape made of subpaths with straight lines and quadratic and cubic Bézier curves. Arcs are stored
+/// as cubic curves. Paths are resolution independent: they can be transformed and are only converted into straight
+/// segments (flatten()) when drawn, with a tolerance fitting the target size. Draw them with image::fill_path() and
+/// image::stroke_path() or add them to a rasterizer.
+/// The coordinates are those of the rasterizer: 0,0 is the top left corner of the first pixel.
+///
+/// Example:
+/// \code
+/// lfgui::path p;
+/// p.add_rounded_rect(10,10,120,30,8);
+/// img.fill_path(p,lfgui::color(80,120,200));
+/// img.stroke_path(p,lfgui::color(0,0,0),lfgui::stroke_style(1.5f));
+/// \endcode
+class path
+{
+public:
+    enum class verb : uint8_t
+    {
+        move,   ///< \brief starts a new subpath, one point
+        line,   ///< \brief one point
+        quad,   ///< \brief a control point and the end point
+        cubic,  ///< \brief two control points and the end point
+        close   ///< \brief connects the current subpath with its start, no point
+    };
+
+    /// \brief Starts a new subpath at x,y.
+    path& move_to(float x,float y);
+    path& move_to(point_float p){return move_to(p.x,p.y);}
+    /// \brief Adds a straight line from the current point to x,y. Starts a subpath at x,y if there is none.
+    path& line_to(float x,float y);
+    path& line_to(point_float p){return line_to(p.x,p.y);}
+    /// \brief Adds a quadratic Bézier curve from the current point with the control point cx,cy to x,y.
+    path& quad_to(float cx,float cy,float x,float y);
+    /// \brief Adds a cubic Bézier curve from the current point with the control points c1 and c2 to x,y.
+    path& cubic_to(float c1x,float c1y,float c2x,float c2y,float x,float y);
+    /// \brief Adds a circular arc around cx,cy from start_angle to end_angle (in radians, clockwise on screen as y
+    /// points downwards). It is connected with a line to the current point, if there is one.
+    path& arc(float cx,float cy,float radius,float start_angle,float end_angle);
+    /// \brief Closes the current subpath with a straight line to its start.
+    path& close();
+
+    /// \brief Adds a closed rectangle.
+    path& add_rect(float x,float y,float w,float h);
+    /// \brief Adds a closed rectangle with corners rounded with the given radius, which is limited to half the width
+    /// and height.
+    path& add_rounded_rect(float x,float y,float w,float h,float radius);
+    /// \brief Adds a closed ellipse.
+    path& add_ellipse(float cx,float cy,float rx,float ry);
+    /// \brief Adds a closed circle.
+    path& add_circle(float cx,float cy,float radius){return add_ellipse(cx,cy,radius,radius);}
+
+    void clear();
+    bool empty()const{return _verbs.empty();}
+    const std::vector<verb>& verbs()const{return _verbs;}
+    const std::vector<point_float>& points()const{return _points;}
+
+    /// \brief Returns the path with all points transformed by m. Curves stay exact, as affine transformations of
+    /// Bézier curves are the curves of the transformed control points.
+    path transformed(const affine_matrix& m)const;
+
+    /// \brief Converts the path into polylines whose points are at most tolerance away from the curves and calls
+    /// f(points,count,closed) for every subpath. The number of segments per curve depends on its curvature (Wang's
+    /// formula), so small curves need only a few.
+    void flatten(float tolerance,const std::function<void(const point_float*,size_t,bool)>& f)const;
+
+private:
+    std::vector<verb> _verbs;
+    std::vector<point_float> _points;
+    bool _open=false;           ///< \brief if there is a subpath to continue
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_PATH_H
@@ -0,0 +1,278 @@
+#include "pixel_conversion.h"
+
+#include <algorithm>
+
+namespace lfgui
+{
+
+std::vector<rect> plan_upload(const std::vector<rect>& damage,int width,int height)
+{
+    const lfgui::rect frame(0,0,width,height);
+    const int waste_allowed=64*64;  // pixel that may be uploaded additionally to save an upload call
+    std::vector<rect> ret;
+
+    for(const rect& r:damage)
+    {
+        rect clipped=r.intersected(frame);
+        if(!clipped.empty())
+            ret.push_back(clipped);
+    }
+
+    // Merge rectangles that overlap or would waste only a few pixel when united. Uniting two rectangles can create a
+    // new overlap with a third one, that's why this is repeated until nothing changes.
+    bool merged=true;
+    while(merged)
+    {
+        merged=false;
+        for(size_t i=0;i<ret.size();i++)
+            for(size_t j=i+1;j<ret.size();)
+            {
+                rect u=ret[i].united(ret[j]);
+                if(!ret[i].intersected(ret[j]).empty()||u.area()-ret[i].area()-ret[j].area()<=waste_allowed)
+                {
+                    ret[i]=u;
+                    ret.erase(ret.begin()+j);
+                    merged=true;
+                    continue;
+                }
+                j++;
+            }
+    }
+
+    int area=0;
+    for(const rect& r:ret)
+        area+=r.area();
+    if(ret.size()>32||area>frame.area()/4*3)
+        return std::vector<rect>{frame};
+    return ret;
+}
+
+void swap_red_blue(const uint8_t* source,uint8_t* target,int count)
+{
+    int i=0;
+#if defined(LFGUI_SSSE3)
+    const __m128i mask=_mm_setr_epi8(2,1,0,3,6,5,4,7,10,9,8,11,14,13,12,15);
+    for(;i<count/4*4;i+=4)
+    {
+        __m128i v=_mm_loadu_si128((const __m128i*)(source+i*4));
+        _mm_storeu_si128((__m128i*)(target+i*4),_mm_shuffle_epi8(v,mask));
+    }
+#elif defined(LFGUI_SSE2)
+    const __m128i mask_ga=_mm_set1_epi32((int)0xFF00FF00);
+    const __m128i mask_low=_mm_set1_epi32(0x000000FF);
+    for(;i<count/4*4;i+=4)
+    {
+        __m128i v=_mm_loadu_si128((const __m128i*)(source+i*4));
+        __m128i ga=_mm_and_si128(v,mask_ga);
+        __m128i low=_mm_and_si128(_mm_srli_epi32(v,16),mask_low);       // third byte to the first
+        __m128i high=_mm_slli_epi32(_mm_and_si128(v,mask_low),16);      // first byte to the third
+        _mm_storeu_si128((__m128i*)(target+i*4),_mm_or_si128(ga,_mm_or_si128(low,high)));
+    }
+#endif
+    for(;i<count;i++)
+    {
+        const uint8_t* s=source+i*4;
+        uint8_t* t=target+i*4;
+        uint8_t first=s[0];
+        uint8_t third=s[2];
+        t[0]=third;
+        t[1]=s[1];
+        t[2]=first;
+        t[3]=s[3];
+    }
+}
+
+void premultiply_alpha(uint8_t* pixels,int count)
+{
+    uint8_t* end=pixels+count*4;
+    for(;pixels<end;pixels+=4)
+    {
+        int a=pixels[3];
+        if(a==255)
+            continue;
+        pixels[0]=(pixels[0]*a+128)*257>>16;
+        pixels[1]=(pixels[1]*a+128)*257>>16;
+        pixels[2]=(pixels[2]*a+128)*257>>16;
+    }
+}
+
+void unpremultiply_alpha(uint8_t* pixels,int count)
+{
+    uint8_t* end=pixels+count*4;
+    for(;pixels<end;pixels+=4)
+    {
+        int a=pixels[3];
+        if(a==255)
+            continue;
+        if(a==0)
+        {
+            pixels[0]=pixels[1]=pixels[2]=0;
+            continue;
+        }
+        pixels[0]=std::min(255,(pixels[0]*255+a/2)/a);
+        pixels[1]=std::min(255,(pixels[1]*255+a/2)/a);
+        pixels[2]=std::min(255,(pixels[2]*255+a/2)/a);
+    }
+}
+
+void convert_pixels(const image& img,rect r,pixel_format target_format,uint8_t* target,int target_stride)
+{
+    if(target_format==pixel_format::planar_bgra)
+        throw lfgui::exception("LFGUI Error: convert_pixels() can only convert into packed pixel formats.");
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const bool rgba=target_format==pixel_format::rgba;
+    const uint8_t* d=img.const_data();
+    const int count=img.plane_stride();
+    for(int y=r.top();y<r.bottom();y++,target+=target_stride)
+    {
+        const uint8_t* b=d+size_t(y)*img.stride()+r.x;
+        const uint8_t* g=b+count;
+        const uint8_t* red=b+count*2;
+        const uint8_t* a=b+count*3;
+        const uint8_t* first=rgba?red:b;    // the channel at the lowest address of a target pixel
+        const uint8_t* third=rgba?b:red;
+        uint8_t* t=target;
+        int x=0;
+#ifdef LFGUI_SSE2
+        for(;x<r.width/16*16;x+=16,t+=64)
+        {
+            __m128i i1=_mm_loadu_si128((const __m128i*)(first+x));
+            __m128i ig=_mm_loadu_si128((const __m128i*)(g+x));
+            __m128i i3=_mm_loadu_si128((const __m128i*)(third+x));
+            __m128i ia=_mm_loadu_si128((const __m128i*)(a+x));
+
+            // interleave the first and third channel and green and alpha, then both pairs
+            __m128i c13_lo=_mm_unpacklo_epi8(i1,i3);
+            __m128i ga_lo=_mm_unpacklo_epi8(ig,ia);
+            __m128i c13_hi=_mm_unpackhi_epi8(i1,i3);
+            __m128i ga_hi=_mm_unpackhi_epi8(ig,ia);
+
+            _mm_storeu_si128((__m128i*)(t),   _mm_unpacklo_epi8(c13_lo,ga_lo));
+            _mm_storeu_si128((__m128i*)(t+16),_mm_unpackhi_epi8(c13_lo,ga_lo));
+            _mm_storeu_si128((__m128i*)(t+32),_mm_unpacklo_epi8(c13_hi,ga_hi));
+            _mm_storeu_si128((__m128i*)(t+48),_mm_unpackhi_epi8(c13_hi,ga_hi));
+        }
+#endif
+        for(;x<r.width;x++,t+=4)
+        {
+            t[0]=first[x];
+            t[1]=g[x];
+            t[2]=third[x];
+            t[3]=a[x];
+        }
+    }
+#else
+    const uint8_t* d=(const uint8_t*)img.const_data();
+    for(int y=r.top();y<r.bottom();y++,target+=target_stride)
+    {
+        const uint8_t* row=d+(size_t(y)*img.stride()+r.x)*4;
+        if(target_format==image::format)
+            std::copy(row,row+r.width*4,target);
+        else
+            swap_red_blue(row,target,r.width);
+    }
+#endif
+}
+
+void convert_pixels(const uint8_t* source,int source_stride,pixel_format source_format,image& img,rect r)
+{
+    if(source_format==pixel_format::planar_bgra)
+        throw lfgui::exception("LFGUI Error: convert_pixels() can only convert from packed pixel formats.");
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const bool rgba=source_format==pixel_format::rgba;
+    uint8_t* d=img.data();
+    const int count=img.plane_stride();
+    for(int y=r.top();y<r.bottom();y++,source+=source_stride)
+    {
+        uint8_t* b=d+size_t(y)*img.stride()+r.x;
+        uint8_t* g=b+count;
+        uint8_t* red=b+count*2;
+        uint8_t* a=b+count*3;
+        uint8_t* first=rgba?red:b;      // the channel at the lowest address of a source pixel
+        uint8_t* third=rgba?b:red;
+        const uint8_t* s=source;
+        int x=0;
+#ifdef LFGUI_SSE2
+        // 16 pixel are transposed from packed to four planes with three rounds of byte unpacking
+        for(;x<r.width/16*16;x+=16,s+=64)
+        {
+            __m128i v0=_mm_loadu_si128((const __m128i*)(s));
+            __m128i v1=_mm_loadu_si128((const __m128i*)(s+16));
+            __m128i v2=_mm_loadu_si128((const __m128i*)(s+32));
+            __m128i v3=_mm_loadu_si128((const __m128i*)(s+48));
+
+            __m128i t0=_mm_unpacklo_epi8(v0,v1);    // r0 r4 g0 g4 b0 b4 a0 a4 r1 r5 ... (for RGBA)
+            __m128i t1=_mm_unpackhi_epi8(v0,v1);    // r2 r6 g2 g6 b2 b6 a2 a6 r3 r7 ...
+            __m128i t2=_mm_unpacklo_epi8(v2,v3);
+            __m128i t3=_mm_unpackhi_epi8(v2,v3);
+
+            __m128i u0=_mm_unpacklo_epi8(t0,t1);    // r0 r2 r4 r6 g0 g2 g4 g6 b0 ...
+            __m128i u1=_mm_unpackhi_epi8(t0,t1);    // r1 r3 r5 r7 g1 g3 g5 g7 b1 ...
+            __m128i u2=_mm_unpacklo_epi8(t2,t3);
+            __m128i u3=_mm_unpackhi_epi8(t2,t3);
+
+            __m128i rg0=_mm_unpacklo_epi8(u0,u1);   // r0 .. r7 g0 .. g7
+            __m128i ba0=_mm_unpackhi_epi8(u0,u1);   // b0 .. b7 a0 .. a7
+            __m128i rg1=_mm_unpacklo_epi8(u2,u3);   // r8 .. r15 g8 .. g15
+            __m128i ba1=_mm_unpackhi_epi8(u2,u3);   // b8 .. b15 a8 .. a15
+
+            _mm_storeu_si128((__m128i*)(first+x),_mm_unpacklo_epi64(rg0,rg1));
+            _mm_storeu_si128((__m128i*)(g+x),    _mm_unpackhi_epi64(rg0,rg1));
+            _mm_storeu_si128((__m128i*)(third+x),_mm_unpacklo_epi64(ba0,ba1));
+            _mm_storeu_si128((__m128i*)(a+x),    _mm_unpackhi_epi64(ba0,ba1));
+        }
+#endif
+        for(;x<r.width;x++,s+=4)
+        {
+            first[x]=s[0];
+            g[x]=s[1];
+            third[x]=s[2];
+            a[x]=s[3];
+        }
+    }
+#else
+    uint8_t* d=(uint8_t*)img.data();
+    for(int y=r.top();y<r.bottom();y++,source+=source_stride)
+    {
+        uint8_t* row=d+(size_t(y)*img.stride()+r.x)*4;
+        if(source_format==image::format)
+            std::copy(source,source+r.width*4,row);
+        else
+            swap_red_blue(source,row,r.width);
+    }
+#endif
+}
+
+void expand_to_rgba(const uint8_t* source,int components,uint8_t* target,int count)
+{
+    if(components==4)
+    {
+        if(source!=target)
+            std::copy(source,source+count*4,target);
+        return;
+    }
+    // backwards to allow source==target
+    for(int i=count-1;i>=0;i--)
+    {
+        const uint8_t* s=source+i*components;
+        uint8_t* t=target+i*4;
+        uint8_t c0=s[0];
+        if(components==1)
+        {
+            t[0]=c0;t[1]=c0;t[2]=c0;t[3]=255;
+        }
+        else if(components==2)
+        {
+            uint8_t alpha=s[1];
+            t[0]=c0;t[1]=c0;t[2]=c0;t[3]=alpha;
+        }
+        else
+        {
+            uint8_t c1=s[1];
+            uint8_t c2=s[2];
+            t[0]=c0;t[1]=c1;t[2]=c2;t[3]=255;
+        }
+    }
+}
+
+}   // namespace lfgui
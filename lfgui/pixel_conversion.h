@@ -0,0 +1,62 @@
+#ifndef LFGUI_PIXEL_CONVERSION_H
+#define LFGUI_PIXEL_CONVERSION_H
+
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief Clips the given (damaged) rectangles to an area of width x height and merges overlapping or close ones.
+/// The returned rectangles don't overlap and are the areas that have to be converted and uploaded by a wrapper.
+/// If the rectangles cover most of the area a single rectangle with the full size is returned, as one big upload is
+/// cheaper than many small ones. Returns an empty vector if there is nothing to upload.
+/// Doesn't depend on any graphics API, wrappers only use the result to call their sub-rectangle upload functions.
+std::vector<rect> plan_upload(const std::vector<rect>& damage,int width,int height);
+
+/// \brief Converts the area r of the image into the packed format target_format (pixel_format::bgra or
+/// pixel_format::rgba). target_stride is the size of one row of the target in bytes. Works with every image::format:
+/// planar images are interleaved, packed images are copied or have red and blue swapped, with SIMD if available.
+/// The area has to be inside of the image. Throws an lfgui::exception if target_format is not packed.
+void convert_pixels(const image& img,rect r,pixel_format target_format,uint8_t* target,int target_stride);
+
+/// \brief Converts pixel data in the packed format source_format (pixel_format::bgra or pixel_format::rgba) into the
+/// area r of the image. The inverse of the other convert_pixels(). source_stride is the size of one row of the source
+/// in bytes. The area has to be inside of the image. Throws an lfgui::exception if source_format is not packed.
+void convert_pixels(const uint8_t* source,int source_stride,pixel_format source_format,image& img,rect r);
+
+/// \brief Converts the area r of the image into RGBA (red at the lowest address), as used by OpenGL, Direct3D and
+/// Urho3D textures. Same as convert_pixels() with pixel_format::rgba.
+inline void convert_to_rgba(const image& img,rect r,uint8_t* target,int target_stride)
+{
+    convert_pixels(img,r,pixel_format::rgba,target,target_stride);
+}
+
+/// \brief Converts RGBA pixel data into the area r of the image. Same as convert_pixels() with pixel_format::rgba.
+inline void convert_from_rgba(const uint8_t* source,int source_stride,image& img,rect r)
+{
+    convert_pixels(source,source_stride,pixel_format::rgba,img,r);
+}
+
+/// \brief Expands count pixels with 1 (grey), 2 (grey, alpha), 3 (RGB) or 4 (RGBA) channels to RGBA with 8 bit per
+/// channel. A missing alpha channel is set to 255. Used by the image loaders to feed convert_from_rgba().
+void expand_to_rgba(const uint8_t* source,int components,uint8_t* target,int count);
+
+/// \brief Converts count pixels in BGRA order (blue at the lowest address) to RGBA order or the other way around.
+/// The operation is the same in both directions as only the first and third byte of every pixel are swapped.
+/// source and target may be identical.
+void swap_red_blue(const uint8_t* source,uint8_t* target,int count);
+
+/// \brief Multiplies the color channels of count packed pixels (BGRA or RGBA, alpha in the fourth byte) with their
+/// alpha, in place.
+void premultiply_alpha(uint8_t* pixels,int count);
+
+/// \brief Divides the color channels of count packed pixels (BGRA or RGBA, alpha in the fourth byte) by their alpha,
+/// in place. The inverse of premultiply_alpha(), used to hand out straight alpha when LFGUI_PREMULTIPLIED_ALPHA is
+/// defined. Fully transparent pixels become black.
+void unpremultiply_alpha(uint8_t* pixels,int count);
+
+}   // namespace lfgui
+
+#endif // LFGUI_PIXEL_CONVERSION_H
@@ -0,0 +1,145 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace lfgui
+{
+namespace profiler
+{
+
+std::atomic<bool> _enabled{true};
+
+namespace
+{
+
+struct zone
+{
+    const char* name;
+    const char* file;
+    int line;
+};
+
+/// \brief The zones and the buffers of all threads that ever recorded something. The buffers are kept when their
+/// thread ends so that its events can still be exported. Never destroyed, as other threads may still record while
+/// static objects are destroyed at the end of the program.
+struct registry
+{
+    std::mutex mutex;
+    std::vector<zone> zones;
+    std::vector<std::unique_ptr<thread_buffer>> buffers;
+
+    static registry& instance()
+    {
+        static registry* r=new registry;
+        return *r;
+    }
+};
+
+std::string json_escape(const char* str)
+{
+    std::string ret;
+    for(;*str;str++)
+        if(*str=='"'||*str=='\\')
+            ret+=std::string("\\")+*str;
+        else
+            ret+=*str;
+    return ret;
+}
+
+}   // namespace
+
+uint32_t register_zone(const char* name,const char* file,int line)
+{
+    registry& r=registry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.zones.push_back(zone{name,file,line});
+    return uint32_t(r.zones.size()-1);
+}
+
+thread_buffer* _create_thread_buffer()
+{
+    registry& r=registry::instance();
+    std::unique_ptr<thread_buffer> buffer(new thread_buffer);
+    std::lock_guard<std::mutex> lock(r.mutex);
+    buffer->thread_index=uint32_t(r.buffers.size());
+    r.buffers.push_back(std::move(buffer));
+    return r.buffers.back().get();
+}
+
+void clear()
+{
+    registry& r=registry::instance();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for(auto& b:r.buffers)
+        b->cleared.store(b->written.load(std::memory_order_acquire),std::memory_order_relaxed);
+}
+
+std::string chrome_trace()
+{
+    registry& r=registry::instance();
+    std::vector<zone> zones;
+    std::vector<std::pair<uint32_t,std::vector<event>>> threads;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        zones=r.zones;
+        for(auto& b:r.buffers)
+        {
+            uint64_t end=b->written.load(std::memory_order_acquire);
+            uint64_t begin=std::max(b->cleared.load(std::memory_order_relaxed),
+                                    end>thread_buffer::capacity?end-thread_buffer::capacity:0);
+            std::vector<event> events;
+            events.reserve(size_t(end-begin));
+            for(uint64_t i=begin;i<end;i++)
+                events.push_back(b->events[i&(thread_buffer::capacity-1)]);
+            threads.emplace_back(b->thread_index,std::move(events));
+        }
+    }
+
+    uint64_t start=UINT64_MAX;
+    for(auto& t:threads)
+        if(!t.second.empty())
+            start=std::min(start,t.second.front().time_ns);
+
+    std::ostringstream ss;
+    ss.setf(std::ios::fixed);
+    ss.precision(3);
+    ss<<"{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first=true;
+    for(auto& t:threads)
+    {
+        ss<<(first?"":",")<<"\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "<<t.first
+          <<", \"args\": {\"name\": \"thread "<<t.first<<"\"}}";
+        first=false;
+        int depth=0;
+        for(const event& e:t.second)
+        {
+            // the begin of the oldest zones may have been overwritten in the ring buffer, skip their ends
+            if(e.end&&!depth)
+                continue;
+            depth+=e.end?-1:1;
+            const zone& z=zones[e.zone];
+            ss<<",\n{\"name\": \""<<json_escape(z.name)<<"\", \"cat\": \"lfgui\", \"ph\": \""<<(e.end?'E':'B')
+              <<"\", \"ts\": "<<(e.time_ns-start)/1000.0<<", \"pid\": 1, \"tid\": "<<t.first;
+            if(!e.end)
+                ss<<", \"args\": {\"file\": \""<<json_escape(z.file)<<"\", \"line\": "<<z.line<<"}";
+            ss<<"}";
+        }
+    }
+    ss<<"\n]}\n";
+    return ss.str();
+}
+
+bool write_chrome_trace(const std::string& path)
+{
+    std::ofstream file(path,std::ios::binary);
+    file<<chrome_trace();
+    return bool(file);
+}
+
+}   // namespace profiler
+}   // namespace lfgui
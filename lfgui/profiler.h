@@ -0,0 +1,134 @@
+#ifndef LFGUI_PROFILER_H
+#define LFGUI_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/// \file
+/// \brief A low-overhead profiler for hot paths like the redraw. Zones are marked with LFGUI_PROFILE_ZONE("name"),
+/// which records a begin and an end timestamp into a ring buffer of the current thread. The recorded zones can be
+/// exported as Chrome trace JSON (open with chrome://tracing or https://ui.perfetto.dev).
+///
+/// LFGUI_PROFILE_ZONE compiles to nothing unless LFGUI_PROFILER is defined (CMake option LFGUI_PROFILER), so the
+/// zones can stay in production code. When compiled in, recording can be switched off at runtime with
+/// lfgui::profiler::set_enabled(false), a disabled zone costs one relaxed atomic load.
+///
+/// Example:
+/// \code
+/// void render_frame()
+/// {
+///     LFGUI_PROFILE_ZONE("render frame");
+///     ...
+/// }
+/// ...
+/// lfgui::profiler::write_chrome_trace("trace.json");
+/// \endcode
+
+namespace lfgui
+{
+namespace profiler
+{
+
+/// \brief One recorded begin or end of a zone.
+struct event
+{
+    uint64_t time_ns;   ///< \brief steady_clock time in nanoseconds
+    uint32_t zone;      ///< \brief the id returned by register_zone()
+    uint32_t end;       ///< \brief 0 for the begin, 1 for the end of the zone
+};
+
+/// \brief The ring buffer of one thread. Only the owning thread writes, so recording needs no lock: the event is
+/// written and then published by increasing written. When the buffer is full the oldest events are overwritten.
+struct thread_buffer
+{
+    static const uint64_t capacity=1<<15;   ///< \brief number of events, has to be a power of two
+    event events[capacity];
+    std::atomic<uint64_t> written{0};       ///< \brief number of events ever written
+    std::atomic<uint64_t> cleared{0};       ///< \brief events before this index were removed with clear()
+    uint32_t thread_index=0;
+
+    void record(uint32_t zone,uint32_t end)
+    {
+        uint64_t i=written.load(std::memory_order_relaxed);
+        event& e=events[i&(capacity-1)];
+        e.time_ns=std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch()).count();
+        e.zone=zone;
+        e.end=end;
+        written.store(i+1,std::memory_order_release);
+    }
+};
+
+/// \brief Registers a zone and returns its id. Called once per LFGUI_PROFILE_ZONE by the initialization of a static
+/// variable, so the name is never looked up while recording. name and file have to be string literals (or live as
+/// long as the program).
+uint32_t register_zone(const char* name,const char* file,int line);
+
+/// \brief Creates and registers the buffer of the calling thread. Use thread_buffer_of_this_thread() instead.
+thread_buffer* _create_thread_buffer();
+
+/// \brief Returns the ring buffer of the calling thread, creates it on the first call.
+inline thread_buffer& thread_buffer_of_this_thread()
+{
+    static thread_local thread_buffer* buffer=nullptr;
+    if(!buffer)
+        buffer=_create_thread_buffer();
+    return *buffer;
+}
+
+extern std::atomic<bool> _enabled;
+
+/// \brief Returns true if zones are recorded (the default).
+inline bool enabled(){return _enabled.load(std::memory_order_relaxed);}
+/// \brief Switches recording on or off at runtime.
+inline void set_enabled(bool enabled){_enabled.store(enabled,std::memory_order_relaxed);}
+
+/// \brief Removes all recorded events of all threads. Doesn't block the recording threads.
+void clear();
+
+/// \brief Returns the recorded events of all threads as Chrome trace JSON. The events are read while the other
+/// threads may still record, so call this between frames or the newest events of busy threads may be missing.
+/// Threads that recorded more than thread_buffer::capacity events only have their newest events exported.
+std::string chrome_trace();
+
+/// \brief Writes chrome_trace() into a file. Returns false if the file could not be written.
+bool write_chrome_trace(const std::string& path);
+
+/// \brief Records the begin of a zone on construction and its end on destruction. Used by LFGUI_PROFILE_ZONE.
+class scope
+{
+    uint32_t _zone;
+    bool _active;
+public:
+    explicit scope(uint32_t zone) : _zone(zone),_active(enabled())
+    {
+        if(_active)
+            thread_buffer_of_this_thread().record(_zone,0);
+    }
+    ~scope()
+    {
+        if(_active)
+            thread_buffer_of_this_thread().record(_zone,1);
+    }
+    scope(const scope&)=delete;
+    scope& operator=(const scope&)=delete;
+};
+
+}   // namespace profiler
+}   // namespace lfgui
+
+#define LFGUI_PROFILER_CONCAT_(A,B) A##B
+#define LFGUI_PROFILER_CONCAT(A,B) LFGUI_PROFILER_CONCAT_(A,B)
+
+#ifdef LFGUI_PROFILER
+/// \brief Measures the time until the end of the current scope as a zone with the given name (a string literal).
+#define LFGUI_PROFILE_ZONE(NAME) \
+    static const uint32_t LFGUI_PROFILER_CONCAT(_lfgui_zone_,__LINE__)=lfgui::profiler::register_zone(NAME,__FILE__,__LINE__); \
+    lfgui::profiler::scope LFGUI_PROFILER_CONCAT(_lfgui_scope_,__LINE__)(LFGUI_PROFILER_CONCAT(_lfgui_zone_,__LINE__));
+#else
+#define LFGUI_PROFILE_ZONE(NAME)
+#endif
+
+#endif // LFGUI_PROFILER_H
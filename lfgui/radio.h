@@ -64,12 +64,12 @@ public:
     void set_checked()
     {
         checked_=true;
-        dirty=true;
+        set_dirty();
         for(auto&& e:*group)
             if(e!=this)
             {
                 e->checked_=false;
-                e->dirty=true;
+                e->set_dirty();
             }
     }
 
@@ -84,7 +84,7 @@ public:
         bool one_checked=false;
         for(auto&& e:*group)
         {
-            e->dirty=true;
+            e->set_dirty();
             if(e->checked_)
             {
                 one_checked=true;
@@ -99,14 +99,21 @@ public:
             checked_=true;
 
         group->insert(this);
-        dirty=true;
+        set_dirty();
     }
 
 private:
     void prepare_images()
     {
-        img_unchecked=image(ressource_path::get()+"gui_torus.png").scaled(height(),height()).multiplied(text_color());
-        img_checked  =image(ressource_path::get()+"gui_torus_dot.png").scaled(height(),height()).multiplied(text_color());
+        asset_loader& loader=asset_loader::global();
+        when_loaded(loader.load_image(ressource_path::get()+"gui_torus.png"),[this](const image& img)
+        {
+            img_unchecked=img.scaled(height(),height()).multiplied(text_color());
+        });
+        when_loaded(loader.load_image(ressource_path::get()+"gui_torus_dot.png"),[this](const image& img)
+        {
+            img_checked=img.scaled(height(),height()).multiplied(text_color());
+        });
     }
 };
 
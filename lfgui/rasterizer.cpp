@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "rasterizer.h"
+
+namespace lfgui
+{
+
+void rasterizer::add_edge(point_float a,point_float b)
+{
+    if(!(a.y!=b.y))     // horizontal edges don't cross any scanline, also skips NaN
+        return;
+    edge e;
+    e.direction=1;
+    if(a.y>b.y)
+    {
+        std::swap(a,b);
+        e.direction=-1;
+    }
+    e.x0=a.x;
+    e.y0=a.y;
+    e.x1=b.x;
+    e.y1=b.y;
+    e.dxdy=(b.x-a.x)/(b.y-a.y);
+    _edges.push_back(e);
+}
+
+void rasterizer::add_polygon(const point_float* points,size_t count)
+{
+    if(count<2)
+        return;
+    for(size_t i=0,j=count-1;i<count;j=i++)
+        add_edge(points[j],points[i]);
+}
+
+void rasterizer::add_polygon(const std::vector<point>& points)
+{
+    const size_t count=points.size();
+    if(count<2)
+        return;
+    for(size_t i=0,j=count-1;i<count;j=i++)
+        add_edge(point_float(points[j].x,points[j].y),point_float(points[i].x,points[i].y));
+}
+
+void rasterizer::_add_convex(const point_float* points,size_t count)
+{
+    float area=0;
+    for(size_t i=0,j=count-1;i<count;j=i++)
+        area+=points[j].x*points[i].y-points[i].x*points[j].y;
+    for(size_t i=0,j=count-1;i<count;j=i++)
+    {
+        if(area>=0)
+            add_edge(points[j],points[i]);
+        else
+            add_edge(points[i],points[j]);
+    }
+}
+
+/// \brief Returns the largest angle between two corners of a polygon that stays within a quarter pixel of a circle
+/// with the given radius.
+static float rasterizer_max_arc_step(float radius)
+{
+    return 2*std::acos(std::max(-1.f,1-0.25f/radius));
+}
+
+void rasterizer::add_circle(point_float center,float radius)
+{
+    if(!(radius>0))
+        return;
+    const int corners=std::max(8,std::min(256,int(std::ceil(6.2831853f/rasterizer_max_arc_step(radius)))));
+    point_float circle[256];
+    for(int i=0;i<corners;i++)
+    {
+        const float angle=6.2831853f*i/corners;
+        circle[i]=point_float(center.x+std::cos(angle)*radius,center.y+std::sin(angle)*radius);
+    }
+    _add_convex(circle,corners);
+}
+
+void rasterizer::add_stroke(const point_float* points,size_t count,const stroke_style& style,bool closed)
+{
+    const float hw=style.width/2;
+    if(!(hw>0))
+        return;
+    _points.clear();
+    for(size_t i=0;i<count;i++)
+        if(_points.empty()||points[i]!=_points.back())
+            _points.push_back(points[i]);
+    if(closed&&_points.size()>1&&!(_points.front()!=_points.back()))
+        _points.pop_back();
+    const size_t n=_points.size();
+    if(n==0)
+        return;
+    if(n==1)
+    {
+        // a single point only has its caps
+        const point_float p=_points[0];
+        if(style.cap==line_cap::round)
+            add_circle(p,hw);
+        else if(style.cap==line_cap::square)
+        {
+            const point_float square[4]={{p.x-hw,p.y-hw},{p.x+hw,p.y-hw},{p.x+hw,p.y+hw},{p.x-hw,p.y+hw}};
+            _add_convex(square,4);
+        }
+        return;
+    }
+    if(n==2)
+        closed=false;
+
+    auto direction=[](point_float a,point_float b)
+    {
+        const float dx=b.x-a.x;
+        const float dy=b.y-a.y;
+        const float l=std::sqrt(dx*dx+dy*dy);
+        return point_float(dx/l,dy/l);
+    };
+
+    const size_t segments=closed?n:n-1;
+    for(size_t i=0;i<segments;i++)
+    {
+        point_float a=_points[i];
+        point_float b=_points[(i+1)%n];
+        const point_float u=direction(a,b);
+        const point_float normal(-u.y*hw,u.x*hw);
+        if(!closed&&style.cap==line_cap::square)
+        {
+            if(i==0)
+                a-=u*hw;
+            if(i==segments-1)
+                b+=u*hw;
+        }
+        const point_float quad[4]={a+normal,b+normal,b-normal,a-normal};
+        _add_convex(quad,4);
+    }
+
+    if(!closed&&style.cap==line_cap::round)
+    {
+        add_circle(_points[0],hw);
+        add_circle(_points[n-1],hw);
+    }
+
+    // the joins, at every point between two segments
+    for(size_t i=closed?0:1;i<(closed?n:n-1);i++)
+    {
+        const point_float p=_points[i];
+        const point_float u0=direction(_points[(i+n-1)%n],p);
+        const point_float u1=direction(p,_points[(i+1)%n]);
+        const float cross=u0.x*u1.y-u0.y*u1.x;
+        const float dot=u0.x*u1.x+u0.y*u1.y;
+        if(std::abs(cross)<1e-6f&&dot>0)
+            continue;   // straight, the segments already touch
+        // the corners of the two segments on the outer side of the turn
+        const float side=cross>0?-hw:hw;
+        const point_float n0(-u0.y*side,u0.x*side);
+        const point_float n1(-u1.y*side,u1.x*side);
+        if(style.join==line_join::round)
+        {
+            // a circle sector between the two corners, just a bevel if the turn is small
+            const float angle=std::acos(std::max(-1.f,std::min(1.f,dot)));
+            const int steps=std::min(254,int(std::ceil(angle/rasterizer_max_arc_step(hw))));
+            point_float fan[256];
+            fan[0]=p;
+            const float start=std::atan2(n0.y,n0.x);
+            const float step=(cross>0?angle:-angle)/std::max(1,steps);
+            for(int s=0;s<=steps;s++)
+                fan[s+1]=point_float(p.x+std::cos(start+step*s)*hw,p.y+std::sin(start+step*s)*hw);
+            _add_convex(fan,steps+2);
+            continue;
+        }
+        // the miter is 1/cos(angle/2) times as long as half the width
+        const float cos_half=std::sqrt(std::max(0.f,(1+dot)/2));
+        if(style.join==line_join::miter&&cos_half*style.miter_limit>1)
+        {
+            const point_float m=p+(n0+n1)*(1/(1+dot));
+            const point_float miter[4]={p,p+n0,m,p+n1};
+            _add_convex(miter,4);
+        }
+        else
+        {
+            const point_float bevel[3]={p,p+n0,p+n1};
+            _add_convex(bevel,3);
+        }
+    }
+}
+
+void rasterizer::add_path(const path& p,float tolerance)
+{
+    p.flatten(tolerance,[this](const point_float* points,size_t count,bool){add_polygon(points,count);});
+}
+
+void rasterizer::add_stroke(const path& p,const stroke_style& style,float tolerance)
+{
+    p.flatten(tolerance,[&](const point_float* points,size_t count,bool closed)
+    {
+        add_stroke(points,count,style,closed);
+    });
+}
+
+lfgui::rect rasterizer::bounds()const
+{
+    if(_edges.empty())
+        return lfgui::rect();
+    float left=_edges[0].x0;
+    float right=left;
+    float top=_edges[0].y0;
+    float bottom=_edges[0].y1;
+    for(const edge& e:_edges)
+    {
+        left=std::min(left,std::min(e.x0,e.x1));
+        right=std::max(right,std::max(e.x0,e.x1));
+        top=std::min(top,e.y0);
+        bottom=std::max(bottom,e.y1);
+    }
+    const int l=int(std::floor(left));
+    const int t=int(std::floor(top));
+    return lfgui::rect(l,t,int(std::ceil(right))-l,int(std::ceil(bottom))-t);
+}
+
+void rasterizer::_accumulate(float xa,float xb,float d)
+{
+    // the parts left and right of the image are moved onto its border, where they cover all pixels right of them
+    const float w=float(_coverage.size());
+    for(float border:{0.f,w})
+        if((xa<border&&xb>border)||(xa>border&&xb<border))
+        {
+            const float t=(border-xa)/(xb-xa);
+            _accumulate(xa,border,d*t);
+            _accumulate(border,xb,d*(1-t));
+            return;
+        }
+    xa=std::min(w,std::max(0.f,xa));
+    xb=std::min(w,std::max(0.f,xb));
+    if(xa>xb)
+        std::swap(xa,xb);
+
+    // Adds the area right of the segment in each pixel it crosses to _area, the running sum over _area then gives
+    // the coverage. Based on font-rs (https://github.com/raphlinus/font-rs).
+    const int x0=int(xa);
+    const int x1=int(std::ceil(xb));
+    float* a=_area.data();
+    if(x1<=x0+1)
+    {
+        const float xm=0.5f*(xa+xb)-x0;
+        a[x0]+=d-d*xm;
+        a[x0+1]+=d*xm;
+    }
+    else
+    {
+        const float s=1/(xb-xa);
+        const float x0f=xa-x0;
+        const float a0=0.5f*s*(1-x0f)*(1-x0f);
+        const float x1f=xb-x1+1;
+        const float am=0.5f*s*x1f*x1f;
+        a[x0]+=d*a0;
+        if(x1==x0+2)
+            a[x0+1]+=d*(1-a0-am);
+        else
+        {
+            const float a1=s*(1.5f-x0f);
+            a[x0+1]+=d*(a1-a0);
+            for(int x=x0+2;x<x1-1;x++)
+                a[x]+=d*s;
+            const float a2=a1+(x1-x0-3)*s;
+            a[x1-1]+=d*(1-a2-am);
+        }
+        a[x1]+=d*am;
+    }
+    _row_begin=std::min(_row_begin,x0);
+    _row_end=std::max(_row_end,x1+2);
+}
+
+void rasterizer::fill(image& target,color c,fill_rule rule,bool antialiased)
+{
+    const int w=target.width();
+    const int h=target.height();
+    if(_edges.empty()||w<1||h<1||c.a==0)
+        return;
+
+    std::sort(_edges.begin(),_edges.end(),[](const edge& a,const edge& b){return a.y0<b.y0;});
+    float bottom=_edges[0].y1;
+    for(const edge& e:_edges)
+        bottom=std::max(bottom,e.y1);
+    const int y_end=int(std::min(float(h),std::ceil(bottom)));
+
+    if(antialiased)
+    {
+        _area.assign(w+2,0);
+        _coverage.resize(w);
+        _row_begin=w+2;
+        _row_end=0;
+    }
+    _active.clear();
+    size_t next=0;  // the first edge not yet in _active
+
+    for(int y=std::max(0,int(std::floor(_edges[0].y0)));y<y_end;y++)
+    {
+        if(_active.empty())
+        {
+            // skip the rows between separate polygons
+            if(next==_edges.size())
+                break;
+            y=std::max(y,int(std::floor(_edges[next].y0)));
+            if(y>=y_end)
+                break;
+        }
+
+        if(antialiased)
+        {
+            // every edge crossing the row adds its area, no matter in which order
+            while(next<_edges.size()&&_edges[next].y0<y+1)
+                _active.push_back({0,int(next++)});
+            size_t n=0;
+            for(size_t i=0;i<_active.size();i++)
+            {
+                const edge& e=_edges[_active[i].index];
+                if(e.y1<=y)
+                    continue;
+                _active[n++]=_active[i];
+                const float ya=std::max(e.y0,float(y));
+                const float yb=std::min(e.y1,float(y+1));
+                _accumulate(e.x0+(ya-e.y0)*e.dxdy,e.x0+(yb-e.y0)*e.dxdy,(yb-ya)*e.direction);
+            }
+            _active.resize(n);
+            if(_row_begin>=_row_end)
+                continue;
+
+            // Sum up the coverage and convert it to 0-255. The coverage only changes where _area is set, long runs
+            // between the edges are skipped if empty and filled without coverage if inside.
+            float sum=0;
+            const int x_end=std::min(_row_end,w);
+            int pending=-1;     // the start of the coverage values not drawn yet
+            for(int x=_row_begin;x<x_end;)
+            {
+                sum+=_area[x];
+                float v=std::abs(sum);
+                if(v>1&&rule==fill_rule::even_odd)
+                {
+                    v=std::fmod(v,2.f);
+                    v=v>1?2-v:v;
+                }
+                const uint8_t coverage=uint8_t(std::min(1.f,v)*255+0.5f);
+                int run=x+1;
+                while(run<x_end&&_area[run]==0)
+                    run++;
+                if(run-x>=16&&(coverage==0||coverage==255))
+                {
+                    if(pending>=0)
+                        target.blend_span(pending,y,x-pending,c,_coverage.data()+pending);
+                    pending=-1;
+                    if(coverage)
+                        target.blend_span(x,y,run-x,c);
+                }
+                else
+                {
+                    if(pending<0)
+                        pending=x;
+                    memset(_coverage.data()+x,coverage,run-x);
+                }
+                x=run;
+            }
+            if(pending>=0)
+                target.blend_span(pending,y,x_end-pending,c,_coverage.data()+pending);
+            std::fill(_area.begin()+_row_begin,_area.begin()+_row_end,0.f);
+            _row_begin=w+2;
+            _row_end=0;
+            continue;
+        }
+
+        // without antialiasing the row is sampled at the pixel centers
+        const float sy=y+0.5f;
+        while(next<_edges.size()&&_edges[next].y0<=sy)
+        {
+            if(_edges[next].y1>sy)
+                _active.push_back({0,int(next)});
+            next++;
+        }
+
+        // remove the edges ending above this scanline, update the crossings and sort them by x. The order changes
+        // only where edges cross, so the insertion sort is usually linear.
+        size_t n=0;
+        for(size_t i=0;i<_active.size();i++)
+        {
+            const edge& e=_edges[_active[i].index];
+            if(e.y1<=sy)
+                continue;
+            active_edge a={e.x0+(sy-e.y0)*e.dxdy,_active[i].index};
+            size_t j=n++;
+            for(;j>0&&_active[j-1].x>a.x;j--)
+                _active[j]=_active[j-1];
+            _active[j]=a;
+        }
+        _active.resize(n);
+
+        int winding=0;
+        for(size_t i=0;i+1<n;i++)
+        {
+            winding+=_edges[_active[i].index].direction;
+            const bool inside=rule==fill_rule::non_zero?winding!=0:(winding&1)!=0;
+            if(!inside)
+                continue;
+            // the pixels with their center inside [xa,xb)
+            const int x0=int(std::ceil(std::max(0.f,_active[i].x)-0.5f));
+            const int x1=int(std::ceil(std::min(float(w),_active[i+1].x)-0.5f));
+            if(x1>x0)
+                target.blend_span(x0,y,x1-x0,c);
+        }
+    }
+}
+
+}   // namespace lfgui
@@ -0,0 +1,92 @@
+#ifndef LFGUI_RASTERIZER_H
+#define LFGUI_RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "image.h"
+#include "path.h"
+
+namespace lfgui
+{
+
+/// \brief Fills polygons made of straight edges into an image, scanline by scanline with an active edge table.
+/// Only the rows between the top and the bottom of the edges are processed and on each row only the edges crossing
+/// it are looked at, so filling a small polygon on a large image costs about as much as the area of the polygon.
+/// Runs of pixels are drawn with image::blend_span(). Without antialiasing a pixel is inside if its center is. With
+/// antialiasing every edge adds the exact area it covers in each pixel of a row to an accumulation buffer, whose
+/// running sum is the coverage (like stb_truetype and font-rs). Only the part of the buffer touched in a row is
+/// summed up. The buffers are kept between calls, so reusing one rasterizer doesn't allocate.
+///
+/// Example:
+/// \code
+/// lfgui::rasterizer r;
+/// r.add_polygon(outer);
+/// r.add_polygon(hole);
+/// r.fill(img,lfgui::color(255,0,0),lfgui::fill_rule::even_odd);
+/// \endcode
+class rasterizer
+{
+public:
+    /// \brief Removes all edges.
+    void clear(){_edges.clear();}
+    /// \brief Returns true if there are no edges.
+    bool empty()const{return _edges.empty();}
+    /// \brief Adds an edge from a to b. The direction is used by fill_rule::non_zero. Horizontal edges are ignored.
+    void add_edge(point_float a,point_float b);
+    /// \brief Adds a closed polygon, the last point is connected with the first.
+    void add_polygon(const point_float* points,size_t count);
+    void add_polygon(const std::vector<point_float>& points){add_polygon(points.data(),points.size());}
+    void add_polygon(const std::vector<point>& points);
+    /// \brief Adds a circle approximated by a polygon fine enough to look round at its size.
+    void add_circle(point_float center,float radius);
+    /// \brief Adds the outline of a path stroked with the given style. The outline consists of a quad per segment
+    /// plus the joins and caps, all with the same orientation, so they are merged when filled with
+    /// fill_rule::non_zero.
+    void add_stroke(const point_float* points,size_t count,const stroke_style& style,bool closed=false);
+    void add_stroke(const std::vector<point_float>& points,const stroke_style& style,bool closed=false)
+    {
+        add_stroke(points.data(),points.size(),style,closed);
+    }
+    /// \brief Adds the subpaths of p as closed polygons, flattened with the given tolerance in pixels.
+    void add_path(const path& p,float tolerance=0.25f);
+    /// \brief Adds the outline of p stroked with the given style, see add_stroke() above.
+    void add_stroke(const path& p,const stroke_style& style,float tolerance=0.25f);
+    /// \brief Returns the smallest rectangle of whole pixels containing all edges.
+    lfgui::rect bounds()const;
+
+    /// \brief Fills the area enclosed by the edges with the given color.
+    void fill(image& target,color c,fill_rule rule=fill_rule::non_zero,bool antialiased=true);
+
+private:
+    struct edge
+    {
+        float x0,y0;    ///< \brief the upper end point
+        float x1,y1;    ///< \brief the lower end point, y1>y0
+        float dxdy;
+        int direction;  ///< \brief 1 if the edge pointed downwards, -1 if upwards
+    };
+    struct active_edge
+    {
+        float x;        ///< \brief where the edge crosses the current scanline
+        int index;      ///< \brief index into _edges
+    };
+
+    std::vector<edge> _edges;
+    std::vector<active_edge> _active;
+    std::vector<float> _area;       ///< \brief coverage changes of the current row, summed up from the left
+    int _row_begin=0;               ///< \brief the part of _area used in the current row
+    int _row_end=0;
+    std::vector<uint8_t> _coverage;
+    std::vector<point_float> _points;   ///< \brief the path without duplicate points, used by add_stroke()
+
+    /// \brief Adds a part of an edge within the current row, from xa at its top to xb at its bottom. d is its height
+    /// in the row, negative if the edge points upwards.
+    void _accumulate(float xa,float xb,float d);
+    /// \brief Adds a convex polygon, reversed if necessary so that all its edges wind in the same direction.
+    void _add_convex(const point_float* points,size_t count);
+};
+
+}   // namespace lfgui
+
+#endif // LFGUI_RASTERIZER_H
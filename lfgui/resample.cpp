@@ -0,0 +1,320 @@
+#include "resample.h"
+#include "parallel.h"
+
+#include <cmath>
+
+namespace lfgui
+{
+
+namespace
+{
+
+const int resample_one=1<<resample_weights::precision_bits;
+const int resample_half=resample_one/2;
+
+double filter_support(resample_filter filter)
+{
+    switch(filter)
+    {
+    case resample_filter::linear:
+        return 1;
+    case resample_filter::cubic:
+        return 2;
+    case resample_filter::lanczos:
+        return 3;
+    }
+    return 1;
+}
+
+double filter_value(resample_filter filter,double x)
+{
+    const double pi=3.14159265358979323846;
+    x=std::abs(x);
+    switch(filter)
+    {
+    case resample_filter::linear:
+        return x<1?1-x:0;
+    case resample_filter::cubic:    // Catmull-Rom (a=-0.5)
+        if(x<1)
+            return (1.5*x-2.5)*x*x+1;
+        if(x<2)
+            return ((-0.5*x+2.5)*x-4)*x+2;
+        return 0;
+    case resample_filter::lanczos:
+        if(x<1e-8)
+            return 1;
+        if(x>=3)
+            return 0;
+        return 3*std::sin(pi*x)*std::sin(pi*x/3)/(pi*pi*x*x);
+    }
+    return 0;
+}
+
+inline uint8_t clamp_to_byte(int v)
+{
+    return v<0?0:v>255?255:v;
+}
+
+/// \brief Resamples one row of packed pixels (4 bytes each) horizontally.
+void resample_row_packed(const uint8_t* source,uint8_t* target,const resample_weights& rw)
+{
+    const int target_width=int(rw.first.size());
+    for(int x=0;x<target_width;x++)
+    {
+        const uint8_t* s=source+rw.first[x]*4;
+        const int16_t* k=&rw.weights[size_t(x)*rw.taps];
+        const int n=rw.count[x];
+        int j=0;
+#ifdef LFGUI_SSE2
+        const __m128i v0=_mm_setzero_si128();
+        __m128i sum=_mm_set1_epi32(resample_half);
+        for(;j+1<n;j+=2)
+        {
+            // two pixels as 16 bit, reordered to c0 c1 pairs for the multiply-add: b0 b1 g0 g1 r0 r1 a0 a1
+            __m128i p=_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(s+j*4)),v0);
+            p=_mm_unpacklo_epi16(p,_mm_unpackhi_epi64(p,p));
+            __m128i w=_mm_set1_epi32((k[j]&0xFFFF)|(int(k[j+1])<<16));
+            sum=_mm_add_epi32(sum,_mm_madd_epi16(p,w));
+        }
+        if(j<n)
+        {
+            __m128i p=_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(s+j*4)),v0);
+            p=_mm_unpacklo_epi16(p,v0);
+            sum=_mm_add_epi32(sum,_mm_madd_epi16(p,_mm_set1_epi32(k[j]&0xFFFF)));
+        }
+        sum=_mm_srai_epi32(sum,resample_weights::precision_bits);
+        sum=_mm_packs_epi32(sum,sum);
+        *(int*)(target+x*4)=_mm_cvtsi128_si32(_mm_packus_epi16(sum,sum));
+#else
+        int c0=resample_half,c1=resample_half,c2=resample_half,c3=resample_half;
+        for(;j<n;j++)
+        {
+            c0+=s[j*4  ]*k[j];
+            c1+=s[j*4+1]*k[j];
+            c2+=s[j*4+2]*k[j];
+            c3+=s[j*4+3]*k[j];
+        }
+        target[x*4  ]=clamp_to_byte(c0>>resample_weights::precision_bits);
+        target[x*4+1]=clamp_to_byte(c1>>resample_weights::precision_bits);
+        target[x*4+2]=clamp_to_byte(c2>>resample_weights::precision_bits);
+        target[x*4+3]=clamp_to_byte(c3>>resample_weights::precision_bits);
+#endif
+    }
+}
+
+/// \brief Computes one target row of length bytes as the weighted sum of n source rows. Works on bytes, so it's the
+/// same for every pixel layout.
+void resample_rows(const uint8_t* const* rows,const int16_t* k,int n,uint8_t* target,int length)
+{
+    int i=0;
+#ifdef LFGUI_SSE2
+    const __m128i v0=_mm_setzero_si128();
+    for(;i+16<=length;i+=16)
+    {
+        __m128i sum_0=_mm_set1_epi32(resample_half);
+        __m128i sum_1=sum_0;
+        __m128i sum_2=sum_0;
+        __m128i sum_3=sum_0;
+        for(int j=0;j<n;j+=2)
+        {
+            // two rows interleaved (a0 b0 a1 b1 ...) and multiplied with their weights in one multiply-add
+            __m128i a=_mm_loadu_si128((const __m128i*)(rows[j]+i));
+            __m128i b=j+1<n?_mm_loadu_si128((const __m128i*)(rows[j+1]+i)):v0;
+            __m128i w=_mm_set1_epi32((k[j]&0xFFFF)|(j+1<n?int(k[j+1])<<16:0));
+            __m128i ab_lo=_mm_unpacklo_epi8(a,b);
+            __m128i ab_hi=_mm_unpackhi_epi8(a,b);
+            sum_0=_mm_add_epi32(sum_0,_mm_madd_epi16(_mm_unpacklo_epi8(ab_lo,v0),w));
+            sum_1=_mm_add_epi32(sum_1,_mm_madd_epi16(_mm_unpackhi_epi8(ab_lo,v0),w));
+            sum_2=_mm_add_epi32(sum_2,_mm_madd_epi16(_mm_unpacklo_epi8(ab_hi,v0),w));
+            sum_3=_mm_add_epi32(sum_3,_mm_madd_epi16(_mm_unpackhi_epi8(ab_hi,v0),w));
+        }
+        sum_0=_mm_srai_epi32(sum_0,resample_weights::precision_bits);
+        sum_1=_mm_srai_epi32(sum_1,resample_weights::precision_bits);
+        sum_2=_mm_srai_epi32(sum_2,resample_weights::precision_bits);
+        sum_3=_mm_srai_epi32(sum_3,resample_weights::precision_bits);
+        __m128i result=_mm_packus_epi16(_mm_packs_epi32(sum_0,sum_1),_mm_packs_epi32(sum_2,sum_3));
+        _mm_storeu_si128((__m128i*)(target+i),result);
+    }
+#endif
+    for(;i<length;i++)
+    {
+        int sum=resample_half;
+        for(int j=0;j<n;j++)
+            sum+=rows[j][i]*k[j];
+        target[i]=clamp_to_byte(sum>>resample_weights::precision_bits);
+    }
+}
+
+/// \brief Resamples the rows [begin,end) of source horizontally into target, which has the same height.
+void resample_horizontal(const image_view& source,image& target,const resample_weights& rw,int begin,int end)
+{
+    const int target_width=target.width();
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    // the planes of a row are interleaved so that all four channels use the packed kernel
+    const int source_width=source.width();
+    const uint8_t* s=source.data();
+    uint8_t* t=target.data();
+    const int source_plane=source.plane_stride();
+    const int target_plane=target.plane_stride();
+    std::vector<uint8_t> packed_source(size_t(source_width)*4);
+    std::vector<uint8_t> packed_target(size_t(target_width)*4);
+    for(int y=begin;y<end;y++)
+    {
+        const uint8_t* s_row=s+size_t(y)*source.stride();
+        for(int x=0;x<source_width;x++)
+            for(int c=0;c<4;c++)
+                packed_source[x*4+c]=s_row[x+c*source_plane];
+        resample_row_packed(packed_source.data(),packed_target.data(),rw);
+        uint8_t* t_row=t+size_t(y)*target.stride();
+        for(int x=0;x<target_width;x++)
+            for(int c=0;c<4;c++)
+                t_row[x+c*target_plane]=packed_target[x*4+c];
+    }
+#else
+    const uint8_t* s=(const uint8_t*)source.data();
+    uint8_t* t=(uint8_t*)target.data();
+    for(int y=begin;y<end;y++)
+        resample_row_packed(s+size_t(y)*source.stride()*4,t+size_t(y)*target.stride()*4,rw);
+#endif
+}
+
+/// \brief Resamples source vertically into the rows [begin,end) of target, which has the same width.
+void resample_vertical(const image_view& source,image& target,const resample_weights& rw,int begin,int end)
+{
+    std::vector<const uint8_t*> rows(rw.taps);
+#ifdef LFGUI_SEPARATE_COLOR_CHANNELS
+    const int row_length=target.width();
+    const int target_row_length=target.stride();
+    const int source_row_length=source.stride();
+    const int planes=4;
+#else
+    const int row_length=target.width()*4;
+    const int target_row_length=target.stride()*4;
+    const int source_row_length=source.stride()*4;
+    const int planes=1;
+#endif
+    const uint8_t* s=(const uint8_t*)source.data();
+    uint8_t* t=(uint8_t*)target.data();
+    for(int plane=0;plane<planes;plane++)
+    {
+        const uint8_t* s_plane=s+size_t(plane)*source.plane_stride();
+        uint8_t* t_plane=t+size_t(plane)*target.plane_stride();
+        for(int y=begin;y<end;y++)
+        {
+            const int n=rw.count[y];
+            for(int j=0;j<n;j++)
+                rows[j]=s_plane+size_t(rw.first[y]+j)*source_row_length;
+            resample_rows(rows.data(),&rw.weights[size_t(y)*rw.taps],n,t_plane+size_t(y)*target_row_length,row_length);
+        }
+    }
+}
+
+}   // namespace
+
+resample_weights::resample_weights(int source_size,int target_size,resample_filter filter)
+{
+    if(source_size<1||target_size<1)
+        return;
+    const double scale=double(source_size)/target_size;
+    const double filter_scale=std::max(1.0,scale);
+    const double support=filter_support(filter)*filter_scale;
+    taps=std::min(source_size,int(std::ceil(support))*2+1);
+    first.resize(target_size);
+    count.resize(target_size);
+    weights.assign(size_t(target_size)*taps,0);
+
+    std::vector<double> w(taps);
+    for(int i=0;i<target_size;i++)
+    {
+        const double center=(i+0.5)*scale;
+        int begin=std::max(0,int(center-support+0.5));
+        int end=std::min(std::min(source_size,int(center+support+0.5)),begin+taps);
+        double sum=0;
+        for(int j=begin;j<end;j++)
+        {
+            w[j-begin]=filter_value(filter,(j-center+0.5)/filter_scale);
+            sum+=w[j-begin];
+        }
+
+        // round to fixed point, the rounding error is added to the largest weight so that the sum is exact
+        int16_t* k=&weights[size_t(i)*taps];
+        int total=0;
+        int largest=0;
+        for(int j=0;j<end-begin;j++)
+        {
+            k[j]=int16_t(std::lround(w[j]/sum*resample_one));
+            total+=k[j];
+            if(std::abs(k[j])>std::abs(k[largest]))
+                largest=j;
+        }
+        k[largest]+=resample_one-total;
+
+        // drop weights that became 0
+        int skip=0;
+        while(skip<end-begin-1&&!k[skip])
+            skip++;
+        if(skip)
+        {
+            std::copy(k+skip,k+(end-begin),k);
+            std::fill(k+(end-begin-skip),k+(end-begin),0);
+            begin+=skip;
+        }
+        while(end-begin>1&&!k[end-begin-1])
+            end--;
+        first[i]=begin;
+        count[i]=end-begin;
+    }
+}
+
+void resample(const image_view& source,image& target,resample_filter filter)
+{
+    const int source_width=source.width();
+    const int source_height=source.height();
+    const int target_width=target.width();
+    const int target_height=target.height();
+    if(target_width<1||target_height<1)
+        return;
+    if(source_width<1||source_height<1)
+    {
+        target.clear();
+        return;
+    }
+    if(target_width==source_width&&target_height==source_height)
+    {
+        target.draw_image_solid(0,0,source);
+        return;
+    }
+
+    const resample_weights rw_x(source_width,target_width,filter);
+    const resample_weights rw_y(source_height,target_height,filter);
+    // threads are only worth it for large images, each one should get at least 64K pixels
+    auto rows_per_thread=[](const image& t){return std::max(1,(1<<16)/t.width());};
+    auto horizontal=[&](const image_view& s,image& t)
+    {
+        parallel_for(0,t.height(),rows_per_thread(t),[&](int begin,int end){resample_horizontal(s,t,rw_x,begin,end);});
+    };
+    auto vertical=[&](const image_view& s,image& t)
+    {
+        parallel_for(0,t.height(),rows_per_thread(t),[&](int begin,int end){resample_vertical(s,t,rw_y,begin,end);});
+    };
+
+    if(target_width==source_width)
+        vertical(source,target);
+    else if(target_height==source_height)
+        horizontal(source,target);
+    else if(target_height<source_height)
+    {
+        // shrinking vertically first leaves fewer rows for the horizontal pass
+        image intermediate(source_width,target_height);
+        vertical(source,intermediate);
+        horizontal(intermediate,target);
+    }
+    else
+    {
+        image intermediate(target_width,source_height);
+        horizontal(source,intermediate);
+        vertical(intermediate,target);
+    }
+}
+
+}   // namespace lfgui
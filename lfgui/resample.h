@@ -0,0 +1,48 @@
+#ifndef LFGUI_RESAMPLE_H
+#define LFGUI_RESAMPLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "image.h"
+
+namespace lfgui
+{
+
+/// \brief The reconstruction filters resample() can use.
+enum class resample_filter
+{
+    linear,     ///< \brief bilinear (triangle filter), one source pixel on each side
+    cubic,      ///< \brief bicubic (Catmull-Rom), sharper, two source pixels on each side
+    lanczos     ///< \brief Lanczos with three lobes, the sharpest, three source pixels on each side
+};
+
+/// \brief The precomputed fixed point weights of a resampling filter along one axis. Target pixel i is the sum of the
+/// source pixels first[i] to first[i]+count[i]-1 multiplied with weights[i*taps+0] to weights[i*taps+count[i]-1].
+/// The weights of one target pixel add up to exactly 1<<precision_bits, so flat areas stay unchanged.
+/// When shrinking, the filter is widened by the scale factor, so every source pixel contributes and downscaled images
+/// don't alias.
+struct resample_weights
+{
+    static const int precision_bits=14;
+
+    int taps=0;                     ///< \brief the maximum number of source pixels of one target pixel
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int16_t> weights;
+
+    resample_weights(int source_size,int target_size,resample_filter filter);
+};
+
+/// \brief Scales source to the size of target with the given filter and writes the result into target. The filter
+/// is applied separably, one pass per axis with integer arithmetic, precomputed weights and SIMD if available. The
+/// pass that shrinks the image runs first and a pass is skipped if its axis keeps its size. Large images are split
+/// into rows that are processed on multiple threads (see parallel_for()).
+/// source can be a view of a part of an image, so crops are scaled without copying them first.
+/// Works in the pixel layout the library was compiled for. With straight alpha the colors of transparent pixels
+/// bleed into their neighbours, with LFGUI_PREMULTIPLIED_ALPHA they don't.
+void resample(const image_view& source,image& target,resample_filter filter);
+
+}   // namespace lfgui
+
+#endif // LFGUI_RESAMPLE_H
@@ -22,23 +22,38 @@ slider::slider(int x,int y,int width,int height,float min_value,float max_value,
         not_handle_size=width;
     }
 
-    img_background.resize_linear(handle_size_,handle_size_);
+    asset_loader& loader=asset_loader::global();
+    when_loaded(loader.load_image(ressource_path::get()+"gui_slider_background.png"),
+                [this,not_handle_size](const image& img)
     {
+        image background=img.resized_linear(handle_size_,handle_size_);
         image temp(not_handle_size,handle_size_);
         temp.clear();
-        temp.draw_image(0,0,img_background.cropped(0,0,handle_size_/2,handle_size_));
+        temp.draw_image(0,0,background.view(lfgui::rect(0,0,handle_size_/2,handle_size_)));
         // TODO: something here is fishy. This top line should yield a correct result but there's a weird offset and a too small size.
-        //temp.draw_image(handle_size_/2,0,img_background.cropped(handle_size_/2,0,1,handle_size_).resize_linear(not_handle_size-handle_size_/*-(handle_size_%2?0:1)*/,handle_size_+1));
-        temp.draw_image(handle_size_/2,-1,img_background.cropped(handle_size_/2,0,1,handle_size_).resize_linear(not_handle_size-handle_size_-(handle_size_%2?0:1)+1,handle_size_+1));
-        temp.draw_image(not_handle_size-handle_size_/2,0,img_background.cropped(handle_size_/2,0,handle_size_/2,handle_size_));
-        img_handle_normal.resize_linear(handle_size_,handle_size_);
-        img_handle_hover.resize_linear(handle_size_,handle_size_);
-        img_handle_pressed.resize_linear(handle_size_,handle_size_);
+        //temp.draw_image(handle_size_/2,0,background.cropped(handle_size_/2,0,1,handle_size_).resize_linear(not_handle_size-handle_size_/*-(handle_size_%2?0:1)*/,handle_size_+1));
+        temp.draw_image(handle_size_/2,-1,background.view(lfgui::rect(handle_size_/2,0,1,handle_size_)).scaled(not_handle_size-handle_size_-(handle_size_%2?0:1)+1,handle_size_+1));
+        temp.draw_image(not_handle_size-handle_size_/2,0,background.view(lfgui::rect(handle_size_/2,0,handle_size_/2,handle_size_)));
+        if(vertical_)
+            temp.rotate90();
+        _colored(temp);
         img_background=std::move(temp);
-    }
-
-    if(vertical_)
-        img_background.rotate90();
+    });
+    when_loaded(loader.load_image(ressource_path::get()+"gui_ball.png"),[this](const image& img)
+    {
+        img_handle_normal=img.resized_linear(handle_size_,handle_size_);
+        _colored(img_handle_normal);
+    });
+    when_loaded(loader.load_image(ressource_path::get()+"gui_ball_dent_half.png"),[this](const image& img)
+    {
+        img_handle_hover=img.resized_linear(handle_size_,handle_size_);
+        _colored(img_handle_hover);
+    });
+    when_loaded(loader.load_image(ressource_path::get()+"gui_ball_dent.png"),[this](const image& img)
+    {
+        img_handle_pressed=img.resized_linear(handle_size_,handle_size_);
+        _colored(img_handle_pressed);
+    });
 
     handle=add_child(new widget(0,0,handle_size_,handle_size_));
 
@@ -111,4 +126,13 @@ slider::slider(int x,int y,int width,int height,float min_value,float max_value,
     set_value(value);
 }
 
+void slider::multiply_images(color c)
+{
+    _image_color=color(_image_color.r*c.r/255,_image_color.g*c.g/255,_image_color.b*c.b/255,_image_color.a*c.a/255);
+    for(image* img:{&img_background,&img_handle_normal,&img_handle_hover,&img_handle_pressed})
+        if(img->count())
+            img->multiply(c);
+    set_dirty();
+}
+
 }
@@ -22,13 +22,14 @@ class slider : public widget
     int handle_size_;
     bool vertical_=false;
     float handle_thickness_=0;
+    color _image_color=color(255,255,255);  ///< \brief See multiply_images().
 public:
-    image img_background=image(ressource_path::get()+"gui_slider_background.png");
+    image img_background;           ///< \brief empty until the image has been loaded
     image* img_handle=0;
     image* img_handle_old=0;
-    image img_handle_normal =image(ressource_path::get()+"gui_ball.png");
-    image img_handle_hover  =image(ressource_path::get()+"gui_ball_dent_half.png");
-    image img_handle_pressed=image(ressource_path::get()+"gui_ball_dent.png");
+    image img_handle_normal;
+    image img_handle_hover;
+    image img_handle_pressed;
     widget* handle;
     signal<float> on_value_change;
 
@@ -53,12 +54,25 @@ public:
             handle->geometry.pos_absolute.y=v/(value_max()-value_min())*(height()-width());
         else
             handle->geometry.pos_absolute.x=v/(value_max()-value_min())*(width()-height());
+        handle->set_dirty();
         if(emit_event)
             on_value_change.call(this->value());
     }
 
     float value_min()const{return value_min_;}
     float value_max()const{return value_max_;}
+
+    /// \brief Multiplies the background and handle images with c, also the ones that are still being loaded (see
+    /// asset_loader) once they arrive.
+    void multiply_images(color c);
+
+private:
+    /// \brief Applies the color set with multiply_images() to a freshly loaded image.
+    void _colored(image& img)const
+    {
+        if(_image_color.r!=255||_image_color.g!=255||_image_color.b!=255||_image_color.a!=255)
+            img.multiply(_image_color);
+    }
 };
 
 }   // namespace lfgui
@@ -141,6 +141,8 @@ void window::prepare_images()
         img_highlighted.draw_image(0, 0,img_titlebar);
         img_highlighted.draw_image(0,25,img_content);
     }
+    // lets widgets behind the window skip painting
+    set_opaque_rect(img_normal.opaque_rect().intersected(img_highlighted.opaque_rect()));
 }
 
 }
@@ -198,9 +198,11 @@ struct stacktrace
         exit(-1);
     };
 
+    /// \brief Returns the stacktrace of the calling thread. Each thread has its own, functions running on several
+    /// threads at once (like image loading in the background) would mix up their entries otherwise.
     static stacktrace& instance()
     {
-        static stacktrace st;
+        static thread_local stacktrace st;
         return st;
     }
 